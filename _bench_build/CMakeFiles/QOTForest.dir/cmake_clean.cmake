@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/QOTForest.dir/src/internal/BitVector.cpp.o"
+  "CMakeFiles/QOTForest.dir/src/internal/BitVector.cpp.o.d"
+  "libQOTForest.a"
+  "libQOTForest.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/QOTForest.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
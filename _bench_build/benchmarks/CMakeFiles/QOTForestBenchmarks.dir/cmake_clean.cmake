@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/QOTForestBenchmarks.dir/src/AllBenchmarks.cpp.o"
+  "CMakeFiles/QOTForestBenchmarks.dir/src/AllBenchmarks.cpp.o.d"
+  "QOTForestBenchmarks"
+  "QOTForestBenchmarks.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/QOTForestBenchmarks.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/QOTForestTests.dir/src/AllTests.cpp.o"
+  "CMakeFiles/QOTForestTests.dir/src/AllTests.cpp.o.d"
+  "QOTForestTests"
+  "QOTForestTests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/QOTForestTests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,715 @@
+#pragma once
+
+#include <QotBenchmarks/Benchmark.hpp>
+
+#include <qotf/binary/BinNTree.hpp>
+#include <qotf/binary/BinNTreeBuilder.hpp>
+#include <qotf/binary/BinNTreeExpression.hpp>
+#include <qotf/morton/CompactMortonCode.hpp>
+#include <qotf/morton/MortonBatch.hpp>
+#include <qotf/morton/MortonBox.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace qotf::bench
+{
+
+/**
+ * Generate [count] random codes of a tree of depth [depth], sorted in Morton order
+ */
+inline std::vector<CompactMortonCode<3>> generateSortedCodes(uint depth, uint count, uint seed)
+{
+	std::mt19937							random(seed);
+	std::uniform_int_distribution<uint32_t> coord(0, (1u << (depth - 1)) - 1);
+
+	std::vector<CompactMortonCode<3>> codes;
+	codes.reserve(count);
+	for(uint i = 0; i < count; ++i)
+		codes.emplace_back(CompactMortonCode<3>::Point{coord(random), coord(random), coord(random)});
+
+	std::sort(codes.begin(), codes.end(), [depth](const CompactMortonCode<3>& a, const CompactMortonCode<3>& b) {
+		for(uint level = depth - 1; level-- > 0;)
+			if(a.decode(level) != b.decode(level))
+				return a.decode(level) < b.decode(level);
+		return false;
+	});
+	return codes;
+}
+
+inline void benchBinNTreeInsertion()
+{
+	constexpr uint kDepth	   = 9;
+	constexpr uint kBatchCount = 4;
+	constexpr uint kBatchSize  = 20000;
+
+	std::vector<std::vector<CompactMortonCode<3>>> batches;
+	for(uint i = 0; i < kBatchCount; ++i)
+		batches.push_back(generateSortedCodes(kDepth, kBatchSize, i));
+
+	std::printf("BinNTree<3> : %u batches of %u voxels at depth %u\n", kBatchCount, kBatchSize, kDepth);
+
+	uint nodeCount = 0;
+
+	const double oneByOne = measure(
+		[&]() {
+			BinNTree<3> tree(kDepth);
+			for(const auto& batch : batches)
+				for(const CompactMortonCode<3>& code : batch)
+					tree.setNode(code, kDepth);
+			nodeCount = tree.getNodeCount();
+		},
+		1);
+
+	const double batched = measure(
+		[&]() {
+			BinNTree<3> tree(kDepth);
+			for(const auto& batch : batches)
+				tree.setNodes(batch.begin(), batch.end(), kDepth);
+			keep(tree.getNodeCount());
+		},
+		1);
+
+	std::printf("  resulting tree of %u nodes\n", nodeCount);
+	report("  setNode", oneByOne, oneByOne);
+	report("  setNodes", batched, oneByOne);
+}
+
+inline void benchBinNTreeBuild()
+{
+	constexpr uint kDepth	  = 10;
+	constexpr uint kCodeCount = 2000000;
+
+	const std::vector<CompactMortonCode<3>> codes = generateSortedCodes(kDepth, kCodeCount, 0);
+
+	std::printf("BinNTree<3> : build from %u sorted voxels at depth %u\n", kCodeCount, kDepth);
+
+	const double batched = measure(
+		[&]() {
+			BinNTree<3> tree(kDepth);
+			tree.setNodes(codes.begin(), codes.end(), kDepth);
+			keep(tree.getNodeCount());
+		},
+		1);
+
+	const double built = measure(
+		[&]() {
+			BinNTreeBuilder<3> builder(kDepth);
+			for(const CompactMortonCode<3>& code : codes)
+				builder.add(code);
+			keep(builder.build().getNodeCount());
+		},
+		1);
+
+	report("  setNodes on an empty tree", batched, batched);
+	report("  BinNTreeBuilder", built, batched);
+}
+
+inline void benchBinNTreeEdits()
+{
+	constexpr uint kDepth	  = 10;
+	constexpr uint kCodeCount = 2000000;
+	constexpr uint kEditCount = 2000;
+
+	BinNTreeBuilder<3> builder(kDepth);
+	for(const CompactMortonCode<3>& code : generateSortedCodes(kDepth, kCodeCount, 0))
+		builder.add(code);
+
+	BinNTree<3>								   plainTree = builder.build();
+	BinNTree<3, internal::ChunkedBitVector<>> chunkedTree(kDepth);
+
+	// The builder is reset by build, so the chunked tree is built again
+	for(const CompactMortonCode<3>& code : generateSortedCodes(kDepth, kCodeCount, 0))
+		builder.add(code);
+	chunkedTree = builder.build<internal::ChunkedBitVector<>>();
+
+	const std::vector<CompactMortonCode<3>> edits = generateSortedCodes(kDepth, kEditCount, 1);
+
+	std::printf("BinNTree<3> : %u random edits on a tree of %u nodes\n", kEditCount, plainTree.getNodeCount());
+
+	// Each run edits its own copy, so that every storage and index setting starts from the same tree
+	auto runEdits = [&](auto tree, bool indexEnabled) {
+		tree.setSubtreeIndexEnabled(indexEnabled);
+		return measure(
+			[&]() {
+				for(uint i = 0; i < kEditCount; ++i)
+				{
+					// Random order, so that edits are spread over the whole tree
+					const CompactMortonCode<3>& code = edits[(i * 7919) % kEditCount];
+					if(i % 2)
+						tree.setNode(code, kDepth);
+					else
+						tree.removeNode(code, kDepth);
+				}
+				keep(tree.getNodeCount());
+			},
+			1);
+	};
+
+	const double plain			= runEdits(plainTree, false);
+	const double plainIndexed	= runEdits(plainTree, true);
+	const double chunked		= runEdits(chunkedTree, false);
+	const double chunkedIndexed = runEdits(chunkedTree, true);
+
+	report("  setNode/removeNode, BitVector", plain, plain);
+	report("  setNode/removeNode, BitVector, index", plainIndexed, plain);
+	report("  setNode/removeNode, ChunkedBitVector", chunked, plain);
+	report("  setNode/removeNode, ChunkedBitVector, index", chunkedIndexed, plain);
+}
+
+inline void benchBinNTreeCodePaths()
+{
+	constexpr uint kDepth	   = 8;
+	constexpr uint kQueryCount = 10000000;
+
+	BinNTreeBuilder<3> builder(kDepth);
+	for(const CompactMortonCode<3>& code : generateSortedCodes(kDepth, 2000, 0))
+		builder.add(code);
+	BinNTree<3> tree = builder.build();
+	tree.setSubtreeIndexEnabled(true);
+
+	const std::vector<CompactMortonCode<3>> queries = generateSortedCodes(kDepth, kQueryCount, 1);
+
+	std::printf("BinNTree<3> : %u sorted queries on a tree of %u nodes\n", kQueryCount, tree.getNodeCount());
+
+	const NTree<3>& virtualTree = tree;
+
+	const double virtualCalls = measure(
+		[&]() {
+			for(const CompactMortonCode<3>& query : queries)
+				keep(virtualTree.getNodeState(static_cast<const MortonCode<3>&>(query), kDepth));
+		},
+		1);
+	const double staticCalls = measure(
+		[&]() {
+			for(const CompactMortonCode<3>& query : queries)
+				keep(tree.getNodeState(query, kDepth));
+		},
+		1);
+
+	report("  getNodeState, MortonCode<3>", virtualCalls, virtualCalls);
+	report("  getNodeState, CompactMortonCode<3>", staticCalls, virtualCalls);
+}
+
+inline void benchBinNTreeBatchQueries()
+{
+	constexpr uint kDepth	   = 9;
+	constexpr uint kQueryCount = 1000000;
+
+	BinNTreeBuilder<3> builder(kDepth);
+	for(const CompactMortonCode<3>& code : generateSortedCodes(kDepth, 60000, 2))
+		builder.add(code);
+	BinNTree<3> tree = builder.build();
+	tree.setSubtreeIndexEnabled(true);
+
+	std::mt19937							random(3);
+	std::uniform_int_distribution<uint32_t> coord(0, (1u << (kDepth - 1)) - 1);
+
+	MortonBatch<3> queries(kDepth - 1);
+	for(uint i = 0; i < kQueryCount; ++i)
+		queries.add({coord(random), coord(random), coord(random)});
+
+	MortonBatch<3> sortedQueries = queries;
+	sortedQueries.sort();
+
+	std::printf("BinNTree<3> : %u queries on a tree of %u nodes\n", kQueryCount, tree.getNodeCount());
+
+	std::vector<NodeState> states(kQueryCount);
+
+	const double descents = measure(
+		[&]() {
+			for(uint i = 0; i < kQueryCount; ++i)
+				states[i] = tree.getNodeState(CompactMortonCode<3>::fromCode(queries[i]), kDepth);
+			keep(states);
+		},
+		1);
+	const double sortedDescents = measure(
+		[&]() {
+			for(uint i = 0; i < kQueryCount; ++i)
+				states[i] = tree.getNodeState(CompactMortonCode<3>::fromCode(sortedQueries[i]), kDepth);
+			keep(states);
+		},
+		1);
+	const double sortedBatch = measure(
+		[&]() {
+			tree.getNodeStates(sortedQueries.codesBegin(), sortedQueries.codesEnd(), kDepth, states.data());
+			keep(states);
+		},
+		1);
+	const double unsortedBatch = measure(
+		[&]() {
+			tree.getNodeStates(queries, kDepth, states.data());
+			keep(states);
+		},
+		1);
+
+	ThreadPool	 pool;
+	const double parallelBatch = measure(
+		[&]() {
+			tree.getNodeStates(sortedQueries.codesBegin(), sortedQueries.codesEnd(), kDepth, states.data(), pool);
+			keep(states);
+		},
+		1);
+
+	report("  getNodeState, random order", descents, descents);
+	report("  getNodeState, sorted", sortedDescents, descents);
+	report("  getNodeStates, sorted", sortedBatch, descents);
+	report("  getNodeStates, random order", unsortedBatch, descents);
+
+	char name[64];
+	std::snprintf(name, sizeof(name), "  getNodeStates, sorted, %u threads", pool.getThreadCount());
+	report(name, parallelBatch, descents);
+}
+
+inline void benchBinNTreeCursor()
+{
+	constexpr uint	   kDepth	   = 9;
+	constexpr uint32_t kCoordCount = 1u << (kDepth - 1);
+
+	BinNTreeBuilder<3> builder(kDepth);
+	for(const CompactMortonCode<3>& code : generateSortedCodes(kDepth, 60000, 2))
+		builder.add(code);
+	BinNTree<3> tree = builder.build();
+	tree.setSubtreeIndexEnabled(true);
+
+	std::printf("BinNTree<3> : scan lines and traversal of a tree of %u nodes\n", tree.getNodeCount());
+
+	// Scan lines along x, over a slab of the tree
+	auto scanLines = [&](auto&& query) {
+		uint filled = 0;
+		for(uint32_t z = 0; z < 16; ++z)
+			for(uint32_t y = 0; y < kCoordCount; ++y)
+				for(uint32_t x = 0; x < kCoordCount; ++x)
+					filled += query(CompactMortonCode<3>({x, y, z})) == NodeState::LeafFilled;
+		keep(filled);
+	};
+
+	const double descents = measure(
+		[&]() { scanLines([&](const CompactMortonCode<3>& code) { return tree.getNodeState(code, kDepth); }); }, 1);
+
+	BinNTree<3>::Cursor cursor(tree);
+	const double		seeks = measure(
+		   [&]() { scanLines([&](const CompactMortonCode<3>& code) { return cursor.seek(code, kDepth); }); }, 1);
+
+	const double traversal = measure(
+		[&]() {
+			BinNTree<3>::Cursor walker(tree);
+			uint				leafCount = 0;
+			while(true)
+			{
+				if(walker.firstChild())
+					continue;
+				++leafCount;
+
+				while(!walker.nextSibling() && walker.parent())
+					;
+				if(walker.getDepth() == 1)
+					break;
+			}
+			keep(leafCount);
+		},
+		1);
+
+	report("  scan lines, getNodeState", descents, descents);
+	report("  scan lines, Cursor::seek", seeks, descents);
+	std::printf("  depth-first traversal with a Cursor : %.3f ms, %.1f ns per node\n", traversal, traversal * 1e6 / tree.getNodeCount());
+}
+
+inline void benchBinNTreeDeferredCollapse()
+{
+	constexpr uint kDepth	   = 10;
+	constexpr uint kCodeCount  = 200000;
+	constexpr uint kFrameCount = 20;
+	constexpr uint kBlockSide  = 4;
+
+	BinNTreeBuilder<3> builder(kDepth);
+	for(const CompactMortonCode<3>& code : generateSortedCodes(kDepth, kCodeCount, 0))
+		builder.add(code);
+	const BinNTree<3> tree = builder.build();
+
+	// Each frame fills then empties blocks of cells one by one, so that their parents
+	// collapse and expand again at each edit in the immediate mode
+	std::vector<CompactMortonCode<3>> edits;
+	for(uint block = 0; block < 8; ++block)
+		for(uint x = 0; x < kBlockSide; ++x)
+			for(uint y = 0; y < kBlockSide; ++y)
+				for(uint z = 0; z < kBlockSide; ++z)
+					edits.emplace_back(CompactMortonCode<3>::Point{64 * block + x, 128 + y, 256 + z});
+
+	std::printf("BinNTree<3> : %u frames of %zu edits on a tree of %u nodes\n", kFrameCount, 2 * edits.size(), tree.getNodeCount());
+
+	auto runFrames = [&](bool deferred) {
+		BinNTree<3> frameTree = tree;
+		frameTree.setSubtreeIndexEnabled(true);
+		frameTree.setCollapseDeferred(deferred);
+		return measure(
+			[&]() {
+				for(uint frame = 0; frame < kFrameCount; ++frame)
+				{
+					for(const CompactMortonCode<3>& code : edits)
+						frameTree.setNode(code, kDepth);
+					for(const CompactMortonCode<3>& code : edits)
+						frameTree.removeNode(code, kDepth);
+					frameTree.compact();
+				}
+				keep(frameTree.getNodeCount());
+			},
+			1);
+	};
+
+	const double immediate = runFrames(false);
+	const double deferred  = runFrames(true);
+
+	report("  immediate collapse", immediate, immediate);
+	report("  deferred collapse, compact per frame", deferred, immediate);
+}
+
+inline void benchBinNTreeSetOperations()
+{
+	constexpr uint kDepth	  = 9;
+	constexpr uint kCodeCount = 20000;
+
+	auto buildTree = [&](uint seed) {
+		BinNTreeBuilder<3> builder(kDepth);
+		for(const CompactMortonCode<3>& code : generateSortedCodes(kDepth, kCodeCount, seed))
+			builder.add(code);
+		return builder.build();
+	};
+
+	const BinNTree<3> a = buildTree(3);
+	const BinNTree<3> b = buildTree(4);
+
+	std::printf("BinNTree<3> : union of two trees of %u and %u nodes\n", a.getNodeCount(), b.getNodeCount());
+
+	// Filled leaves of b, as the code of their first cell and their depth
+	std::vector<std::pair<CompactMortonCode<3>, uint>> leaves;
+	BinNTree<3>::Cursor								   walker(b);
+	while(true)
+	{
+		if(walker.firstChild())
+			continue;
+		if(walker.getState() == NodeState::LeafFilled)
+			leaves.emplace_back(CompactMortonCode<3>(walker.getCorner()), walker.getDepth());
+
+		while(!walker.nextSibling() && walker.parent())
+			;
+		if(walker.getDepth() == 1)
+			break;
+	}
+
+	const double perLeaf = measure(
+		[&]() {
+			BinNTree<3> result = a;
+			result.setSubtreeIndexEnabled(true);
+			for(const auto& [code, depth] : leaves)
+				result.setNode(code, depth);
+			keep(result.getNodeCount());
+		},
+		1);
+
+	const double united = measure([&]() {
+		BinNTree<3> result = a;
+		result.unite(b);
+		keep(result.getNodeCount());
+	});
+
+	report("  setNode per filled leaf", perLeaf, perLeaf);
+	report("  unite", united, perLeaf);
+}
+
+inline void benchBinNTreeExpression()
+{
+	constexpr uint kDepth	  = 9;
+	constexpr uint kCodeCount = 20000;
+	constexpr uint kTreeCount = 12;
+
+	std::vector<BinNTree<3>> trees;
+	for(uint i = 0; i < kTreeCount; ++i)
+	{
+		BinNTreeBuilder<3> builder(kDepth);
+		for(const CompactMortonCode<3>& code : generateSortedCodes(kDepth, kCodeCount, 10 + i))
+			builder.add(code);
+		trees.push_back(builder.build());
+	}
+
+	std::printf("BinNTree<3> : union of %u trees minus another one\n", kTreeCount - 1);
+
+	const double pairwise = measure([&]() {
+		BinNTree<3> result = trees[0];
+		for(uint i = 1; i + 1 < kTreeCount; ++i)
+			result.unite(trees[i]);
+		result.subtract(trees.back());
+		keep(result.getNodeCount());
+	});
+
+	const double fused = measure([&]() {
+		BinNTreeExpression<3> expression(trees[0]);
+		for(uint i = 1; i + 1 < kTreeCount; ++i)
+			expression = expression | BinNTreeExpression<3>(trees[i]);
+		expression = expression - BinNTreeExpression<3>(trees.back());
+
+		const BinNTree<3> result = expression.evaluate();
+		keep(result.getNodeCount());
+	});
+
+	report("  pairwise unite and subtract", pairwise, pairwise);
+	report("  BinNTreeExpression::evaluate", fused, pairwise);
+}
+
+inline void benchBinNTreeBoxQueries()
+{
+	constexpr uint	   kDepth	   = 9;
+	constexpr uint32_t kCoordCount = 1u << (kDepth - 1);
+	constexpr uint32_t kBoxSide	   = 16;
+	constexpr uint	   kBoxCount   = 100;
+
+	BinNTreeBuilder<3> builder(kDepth);
+	for(const CompactMortonCode<3>& code : generateSortedCodes(kDepth, 200000, 5))
+		builder.add(code);
+	BinNTree<3> tree = builder.build();
+	tree.setSubtreeIndexEnabled(true);
+
+	std::mt19937							random(6);
+	std::uniform_int_distribution<uint32_t> coord(0, kCoordCount - kBoxSide);
+
+	std::vector<CompactMortonCode<3>::Point> corners;
+	for(uint i = 0; i < kBoxCount; ++i)
+		corners.push_back({coord(random), coord(random), coord(random)});
+
+	std::printf("BinNTree<3> : %u boxes of %u^3 cells in a tree of %u nodes\n", kBoxCount, kBoxSide, tree.getNodeCount());
+
+	const double cells = measure(
+		[&]() {
+			uint filled = 0;
+			for(const CompactMortonCode<3>::Point& corner : corners)
+				for(uint32_t x = corner[0]; x < corner[0] + kBoxSide; ++x)
+					for(uint32_t y = corner[1]; y < corner[1] + kBoxSide; ++y)
+						for(uint32_t z = corner[2]; z < corner[2] + kBoxSide; ++z)
+							filled += tree.getNodeState(CompactMortonCode<3>({x, y, z}), kDepth) == NodeState::LeafFilled;
+			keep(filled);
+		},
+		1);
+
+	const double leaves = measure([&]() {
+		uint filled = 0;
+		for(const CompactMortonCode<3>::Point& corner : corners)
+		{
+			const MortonBox<3> box(corner, {corner[0] + kBoxSide - 1, corner[1] + kBoxSide - 1, corner[2] + kBoxSide - 1});
+			tree.visitFilledLeaves(box, [&](const CompactMortonCode<3>&, uint) { ++filled; });
+		}
+		keep(filled);
+	});
+
+	const double any = measure([&]() {
+		uint filled = 0;
+		for(const CompactMortonCode<3>::Point& corner : corners)
+			filled += tree.anyFilled(MortonBox<3>(corner, {corner[0] + kBoxSide - 1, corner[1] + kBoxSide - 1, corner[2] + kBoxSide - 1}));
+		keep(filled);
+	});
+
+	report("  getNodeState per cell", cells, cells);
+	report("  visitFilledLeaves", leaves, cells);
+	report("  anyFilled", any, cells);
+}
+
+inline void benchBinNTreeVolume()
+{
+	constexpr uint	   kDepth	   = 9;
+	constexpr uint32_t kCoordCount = 1u << (kDepth - 1);
+	constexpr uint32_t kBoxSide	   = 128;
+	constexpr uint	   kBoxCount   = 100;
+	constexpr uint	   kTickCount  = 100;
+
+	BinNTreeBuilder<3> builder(kDepth);
+	for(const CompactMortonCode<3>& code : generateSortedCodes(kDepth, 200000, 7))
+		builder.add(code);
+	BinNTree<3> plainTree = builder.build();
+	plainTree.setSubtreeIndexEnabled(true);
+
+	BinNTree<3> summaryTree = plainTree;
+	summaryTree.setVolumeSummaryEnabled(true);
+
+	const std::vector<CompactMortonCode<3>> edits = generateSortedCodes(kDepth, 10 * kTickCount, 8);
+
+	std::mt19937							random(9);
+	std::uniform_int_distribution<uint32_t> coord(0, kCoordCount - kBoxSide);
+
+	std::vector<MortonBox<3>> boxes;
+	for(uint i = 0; i < kBoxCount; ++i)
+	{
+		const CompactMortonCode<3>::Point corner{coord(random), coord(random), coord(random)};
+		boxes.emplace_back(corner, CompactMortonCode<3>::Point{corner[0] + kBoxSide - 1, corner[1] + kBoxSide - 1, corner[2] + kBoxSide - 1});
+	}
+
+	std::printf("BinNTree<3> : filled volume of a tree of %u nodes\n", plainTree.getNodeCount());
+
+	// Each tick edits the tree, then reads its filled volume
+	auto runTicks = [&](BinNTree<3>& tree) {
+		uint64_t volume = 0;
+		for(uint tick = 0; tick < kTickCount; ++tick)
+		{
+			for(uint i = 0; i < 10; ++i)
+			{
+				const CompactMortonCode<3>& code = edits[(tick * 10 + i) * 7919 % edits.size()];
+				if(i % 2)
+					tree.setNode(code, kDepth);
+				else
+					tree.removeNode(code, kDepth);
+			}
+			volume += tree.filledVolume();
+		}
+		keep(volume);
+	};
+
+	const double plainTicks	  = measure([&]() { runTicks(plainTree); }, 1);
+	const double summaryTicks = measure([&]() { runTicks(summaryTree); }, 1);
+
+	report("  ticks of 10 edits, filledVolume by traversal", plainTicks, plainTicks);
+	report("  ticks of 10 edits, filledVolume with summary", summaryTicks, plainTicks);
+
+	std::printf("BinNTree<3> : filled cells of %u boxes of %u^3 cells\n", kBoxCount, kBoxSide);
+
+	const double leaves = measure([&]() {
+		uint64_t volume = 0;
+		for(const MortonBox<3>& box : boxes)
+			plainTree.visitFilledLeaves(box, [&](const CompactMortonCode<3>&, uint depth) {
+				// Leaves crossing the border of the box are counted whole, the volume is not exact
+				volume += uint64_t{1} << (3 * (kDepth - depth));
+			});
+		keep(volume);
+	});
+
+	const double plainCount = measure([&]() {
+		uint64_t volume = 0;
+		for(const MortonBox<3>& box : boxes)
+			volume += plainTree.countFilled(box);
+		keep(volume);
+	});
+
+	const double summaryCount = measure([&]() {
+		uint64_t volume = 0;
+		for(const MortonBox<3>& box : boxes)
+			volume += summaryTree.countFilled(box);
+		keep(volume);
+	});
+
+	report("  visitFilledLeaves and leaf volumes", leaves, leaves);
+	report("  countFilled", plainCount, leaves);
+	report("  countFilled with summary", summaryCount, leaves);
+
+	// Each tick edits the tree, then counts the filled cells of a few boxes
+	auto runBoxTicks = [&](BinNTree<3>& tree) {
+		uint64_t volume = 0;
+		for(uint tick = 0; tick < kTickCount; ++tick)
+		{
+			for(uint i = 0; i < 10; ++i)
+			{
+				const CompactMortonCode<3>& code = edits[(tick * 10 + i) * 7919 % edits.size()];
+				if(i % 2)
+					tree.setNode(code, kDepth);
+				else
+					tree.removeNode(code, kDepth);
+			}
+			for(uint i = 0; i < 10; ++i)
+				volume += tree.countFilled(boxes[(tick * 10 + i) % kBoxCount]);
+		}
+		keep(volume);
+	};
+
+	const double plainBoxTicks	 = measure([&]() { runBoxTicks(plainTree); }, 1);
+	const double summaryBoxTicks = measure([&]() { runBoxTicks(summaryTree); }, 1);
+
+	report("  ticks of edits and countFilled", plainBoxTicks, plainBoxTicks);
+	report("  ticks of edits and countFilled with summary", summaryBoxTicks, plainBoxTicks);
+}
+
+inline void benchBinNTreeRays()
+{
+	constexpr uint	 kDepth	   = 9;
+	constexpr double kTreeSide = 1u << (kDepth - 1);
+	constexpr uint	 kRayCount = 20000;
+
+	BinNTreeBuilder<3> builder(kDepth);
+	for(const CompactMortonCode<3>& code : generateSortedCodes(kDepth, 20000, 10))
+		builder.add(code);
+	BinNTree<3> tree = builder.build();
+	tree.setSubtreeIndexEnabled(true);
+
+	std::mt19937						   random(11);
+	std::uniform_real_distribution<double> position(0.0, kTreeSide);
+	std::uniform_real_distribution<double> direction(-1.0, 1.0);
+
+	std::vector<Ray<3>> rays(kRayCount);
+	for(Ray<3>& ray : rays)
+		ray = {{position(random), position(random), position(random)}, {direction(random), direction(random), direction(random)}, kTreeSide};
+
+	std::printf("BinNTree<3> : %u rays through a tree of %u nodes\n", kRayCount, tree.getNodeCount());
+
+	// Voxel DDA of Amanatides and Woo, reading the state of each cell crossed
+	const double cells = measure(
+		[&]() {
+			uint hitCount = 0;
+			for(const Ray<3>& ray : rays)
+			{
+				const double norm = std::sqrt(ray.direction[0] * ray.direction[0] + ray.direction[1] * ray.direction[1] + ray.direction[2] * ray.direction[2]);
+
+				std::array<int64_t, 3> cell;
+				std::array<int64_t, 3> step;
+				std::array<double, 3>  tNext;
+				std::array<double, 3>  tDelta;
+				for(uint axis = 0; axis < 3; ++axis)
+				{
+					const double d = ray.direction[axis] / norm;
+					cell[axis]	   = static_cast<int64_t>(ray.origin[axis]);
+					step[axis]	   = d < 0 ? -1 : 1;
+					tDelta[axis]   = d == 0 ? std::numeric_limits<double>::infinity() : std::abs(1 / d);
+					tNext[axis]	   = d == 0 ? std::numeric_limits<double>::infinity() : ((d < 0 ? cell[axis] : cell[axis] + 1) - ray.origin[axis]) / d;
+				}
+
+				double t = 0;
+				while(t < ray.maxDistance && cell[0] >= 0 && cell[1] >= 0 && cell[2] >= 0 && cell[0] < kTreeSide && cell[1] < kTreeSide && cell[2] < kTreeSide)
+				{
+					const CompactMortonCode<3> code({static_cast<uint32_t>(cell[0]), static_cast<uint32_t>(cell[1]), static_cast<uint32_t>(cell[2])});
+					if(tree.getNodeState(code, kDepth) == NodeState::LeafFilled)
+					{
+						++hitCount;
+						break;
+					}
+
+					const uint axis = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+					t				= tNext[axis];
+					tNext[axis] += tDelta[axis];
+					cell[axis] += step[axis];
+				}
+			}
+			keep(hitCount);
+		},
+		1);
+
+	std::vector<RayHit<3>> hits(kRayCount);
+
+	const double single = measure([&]() {
+		uint hitCount = 0;
+		for(size_t i = 0; i < rays.size(); ++i)
+			hitCount += tree.castRay(rays[i].origin, rays[i].direction, rays[i].maxDistance, hits[i]);
+		keep(hitCount);
+	});
+
+	ThreadPool	 pool;
+	const double batch = measure([&]() {
+		tree.castRays(rays.data(), rays.size(), hits.data(), pool);
+		keep(hits);
+	});
+
+	report("  voxel DDA, getNodeState per cell", cells, cells);
+	report("  castRay", single, cells);
+
+	char name[64];
+	std::snprintf(name, sizeof(name), "  castRays, %u threads", pool.getThreadCount());
+	report(name, batch, cells);
+}
+
+} // namespace qotf::bench
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QotBenchmarks/Benchmark.hpp>
+
+#include <qotf/internal/ByteHelper.hpp>
+
+#include <random>
+#include <vector>
+
+namespace qotf::bench
+{
+
+inline void benchByteHelper()
+{
+	using namespace internal;
+
+	constexpr size_t kByteCount = 8 << 20;
+
+	std::mt19937	  random(4);
+	std::vector<byte> bytes(kByteCount + 1);
+	for(byte& b : bytes)
+		b = static_cast<byte>(random());
+
+	ByteHelper helper(bytes);
+
+	std::printf("ByteHelper : unaligned copy of %zu bytes, one node to the right\n", kByteCount);
+
+	// Shift every byte by two bits, like a node inserted at the front of a BinNTree
+	const double byByte = measure([&]() { helper.copyBytesByByte<Direction::ToRight>(2, 0, kByteCount); });
+	const double byWord = measure([&]() { helper.copyBytes<Direction::ToRight>(2, 0, kByteCount); });
+
+	report("  copyBytes, byte by byte", byByte, byByte);
+	report("  copyBytes, word by word", byWord, byByte);
+}
+
+} // namespace qotf::bench
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <QotBenchmarks/Benchmark.hpp>
+
+#include <qotf/binary/BinNTree.hpp>
+#include <qotf/internal/ExcessScanner.hpp>
+#include <qotf/morton/CompactMortonCode.hpp>
+
+#include <random>
+#include <vector>
+
+namespace qotf::bench
+{
+
+/**
+ * Generate the preorder stream of a random octree, where the first three levels
+ * are Composite, and each node above [depth] is Composite with a probability of [compositeRatio]
+ */
+inline void generateOctreeStream(std::vector<byte>& data, size_t& nodeCount, uint depth, double compositeRatio)
+{
+	std::mt19937					   random(1);
+	std::bernoulli_distribution		   isComposite(compositeRatio);
+	std::vector<std::pair<uint, uint>> stack{{1, 1}};
+
+	nodeCount = 0;
+	data.clear();
+
+	while(!stack.empty())
+	{
+		auto& [nodeDepth, remaining] = stack.back();
+		const uint currentDepth		 = nodeDepth;
+		if(--remaining == 0)
+			stack.pop_back();
+
+		if(nodeCount % 4 == 0)
+			data.push_back(byte{0});
+
+		const bool composite = currentDepth < depth && (currentDepth <= 3 || isComposite(random));
+		if(composite)
+		{
+			data.back() |= byte{0b10} << (6 - 2 * (nodeCount % 4));
+			stack.push_back({currentDepth + 1, 8});
+		}
+		++nodeCount;
+	}
+}
+
+inline void benchExcessScanner()
+{
+	using Scanner = internal::ExcessScanner<8>;
+
+	std::vector<byte> data;
+	size_t			  nodeCount;
+	generateOctreeStream(data, nodeCount, 12, 0.35);
+
+	std::printf("ExcessScanner : octree stream of %zu nodes\n", nodeCount);
+
+	// Skip the whole tree from its first child, like getParentEndIndex on the root
+	const double byNode = measure([&]() {
+		internal::Excess excess = 0;
+		keep(Scanner::forwardByNode(data.data(), 1, nodeCount, excess, -8));
+	});
+	const double byByte = measure([&]() {
+		internal::Excess excess = 0;
+		keep(Scanner::forwardByByte(data.data(), 1, nodeCount, excess, -8));
+	});
+	const double byPortableWord = measure([&]() {
+		internal::Excess excess = 0;
+		keep(Scanner::forwardByWord(data.data(), 1, nodeCount, excess, -8));
+	});
+	const double byWord = measure([&]() {
+		internal::Excess excess = 0;
+		keep(Scanner::forward(data.data(), 1, nodeCount, excess, -8));
+	});
+
+	report("  skip root children, node by node", byNode, byNode);
+	report("  skip root children, byte table", byByte, byNode);
+	report("  skip root children, portable words", byPortableWord, byNode);
+	report("  skip root children, dispatched words", byWord, byNode);
+}
+
+inline void benchBinNTreeQueries()
+{
+	constexpr uint kDepth		= 9;
+	constexpr uint kCoordCount	= 1 << (kDepth - 1);
+	constexpr uint kQueryCount	= 20000;
+	constexpr uint kVoxelCount	= 60000;
+
+	std::mt19937 random(2);
+	auto		 randomPoint = [&]() {
+		std::uniform_int_distribution<uint32_t> coord(0, kCoordCount - 1);
+		return CompactMortonCode<3>::Point{coord(random), coord(random), coord(random)};
+	};
+
+	BinNTree<3> tree(kDepth);
+	for(uint i = 0; i < kVoxelCount; ++i)
+		tree.setNode(CompactMortonCode<3>(randomPoint()), kDepth);
+
+	std::vector<CompactMortonCode<3>> queries;
+	queries.reserve(kQueryCount);
+	for(uint i = 0; i < kQueryCount; ++i)
+		queries.emplace_back(randomPoint());
+
+	std::printf("BinNTree<3> : %u nodes, %u queries at depth %u\n", tree.getNodeCount(), kQueryCount, kDepth);
+
+	auto runQueries = [&]() {
+		for(const CompactMortonCode<3>& query : queries)
+			keep(tree.getNodeState(query, kDepth));
+	};
+
+	const double scanned = measure(runQueries, 1);
+	tree.setSubtreeIndexEnabled(true);
+	runQueries();
+	const double indexed = measure(runQueries, 1);
+
+	report("  getNodeState, word scan", scanned, scanned);
+	report("  getNodeState, subtree index", indexed, scanned);
+}
+
+} // namespace qotf::bench
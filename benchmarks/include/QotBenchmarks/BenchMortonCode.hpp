@@ -0,0 +1,349 @@
+#pragma once
+
+#include <QotBenchmarks/Benchmark.hpp>
+
+#include <qotf/morton/CompactMortonCode.hpp>
+#include <qotf/morton/HilbertCode.hpp>
+#include <qotf/morton/MortonBatch.hpp>
+#include <qotf/morton/MortonBox.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace qotf::bench
+{
+
+inline void benchMortonCode()
+{
+	using Code = CompactMortonCode<3>;
+
+	constexpr size_t kPointCount = 1 << 22;
+
+	std::mt19937							random(9);
+	std::uniform_int_distribution<uint32_t> coord(0, 0x1FFFFF);
+
+	std::vector<Code::Point> points(kPointCount);
+	for(Code::Point& p : points)
+		p = {coord(random), coord(random), coord(random)};
+
+	std::vector<uint64_t> codes(kPointCount);
+
+	std::printf("CompactMortonCode<3> : %zu points\n", kPointCount);
+
+	const double encodeByMasks = measure([&]() {
+		for(size_t i = 0; i < kPointCount; ++i)
+			codes[i] = Code::encodeByMasks(points[i]);
+		keep(codes);
+	});
+	const double encode = measure([&]() {
+		for(size_t i = 0; i < kPointCount; ++i)
+			codes[i] = Code(points[i]).getCode();
+		keep(codes);
+	});
+
+	const double decodeByMasks = measure([&]() {
+		for(size_t i = 0; i < kPointCount; ++i)
+			points[i] = Code::decodeByMasks(codes[i]);
+		keep(points);
+	});
+
+	std::vector<Code> mortonCodes;
+	mortonCodes.reserve(kPointCount);
+	for(const Code::Point& p : points)
+		mortonCodes.emplace_back(p);
+
+	const double decode = measure([&]() {
+		for(size_t i = 0; i < kPointCount; ++i)
+			points[i] = mortonCodes[i].toPoint();
+		keep(points);
+	});
+
+	report("  encode, magic masks", encodeByMasks, encodeByMasks);
+	report("  encode, dispatched", encode, encodeByMasks);
+	report("  decode, magic masks", decodeByMasks, decodeByMasks);
+	report("  decode, dispatched", decode, decodeByMasks);
+
+	// Batch encoding of coordinate arrays
+	std::array<std::vector<uint32_t>, 3> coords;
+	for(std::vector<uint32_t>& axis : coords)
+		for(size_t i = 0; i < kPointCount; ++i)
+			axis.push_back(coord(random));
+
+	const mortonkernels::PointArrays<3> arrays = {coords[0].data(), coords[1].data(), coords[2].data()};
+
+	const double batchByMasks = measure([&]() {
+		Code::encodeBatchByMasks(arrays, kPointCount, codes.data());
+		keep(codes);
+	});
+	const double batch = measure([&]() {
+		Code::encodeBatch(arrays, kPointCount, codes.data());
+		keep(codes);
+	});
+
+	// Face neighbours of every point
+	const double neighboursByPoint = measure([&]() {
+		for(size_t i = 0; i < kPointCount; ++i)
+			for(uint axis = 0; axis < 3; ++axis)
+			{
+				Code::Point p = mortonCodes[i].toPoint();
+				++p[axis];
+				keep(Code(p).getCode());
+				p[axis] -= 2;
+				keep(Code(p).getCode());
+			}
+	});
+	const double neighboursDilated = measure([&]() {
+		for(size_t i = 0; i < kPointCount; ++i)
+			for(uint axis = 0; axis < 3; ++axis)
+			{
+				keep(mortonCodes[i].increment(axis).getCode());
+				keep(mortonCodes[i].decrement(axis).getCode());
+			}
+	});
+
+	report("  face neighbours, through the point", neighboursByPoint, neighboursByPoint);
+	report("  face neighbours, dilated arithmetic", neighboursDilated, neighboursByPoint);
+
+	report("  batch encode, magic masks", batchByMasks, batchByMasks);
+	report("  batch encode, dispatched", batch, batchByMasks);
+
+#if QOTF_X86_KERNELS
+	if(__builtin_cpu_supports("bmi2"))
+	{
+		const double batchBmi2 = measure([&]() {
+			mortonkernels::encodeBatchBmi2<3>(Code::getSplitMasks(), arrays, kPointCount, codes.data());
+			keep(codes);
+		});
+		report("  batch encode, BMI2", batchBmi2, batchByMasks);
+	}
+	if(__builtin_cpu_supports("avx2"))
+	{
+		const double batchAvx2 = measure([&]() {
+			mortonkernels::encodeBatchAvx2<3>(Code::getSplitMasks(), arrays, kPointCount, codes.data());
+			keep(codes);
+		});
+		report("  batch encode, AVX2", batchAvx2, batchByMasks);
+	}
+	if(__builtin_cpu_supports("avx512f"))
+	{
+		const double batchAvx512 = measure([&]() {
+			mortonkernels::encodeBatchAvx512<3>(Code::getSplitMasks(), arrays, kPointCount, codes.data());
+			keep(codes);
+		});
+		report("  batch encode, AVX-512", batchAvx512, batchByMasks);
+	}
+#endif
+}
+
+inline void benchHilbertCode()
+{
+	using Point = CompactMortonCode<3>::Point;
+
+	constexpr size_t   kPointCount = 1 << 20;
+	constexpr uint32_t kCoordCount = 1 << 16;
+
+	std::mt19937							random(12);
+	std::uniform_int_distribution<uint32_t> coord(0, kCoordCount - 1);
+
+	std::vector<Point> points(kPointCount);
+	for(Point& p : points)
+		p = {coord(random), coord(random), coord(random)};
+
+	std::vector<uint64_t> mortonCodes(kPointCount);
+	std::vector<uint64_t> hilbertCodes(kPointCount);
+
+	std::printf("HilbertCode<3> : %zu points\n", kPointCount);
+
+	const double mortonEncode = measure([&]() {
+		for(size_t i = 0; i < kPointCount; ++i)
+			mortonCodes[i] = CompactMortonCode<3>(points[i]).getCode();
+		keep(mortonCodes);
+	});
+	const double hilbertEncode = measure([&]() {
+		for(size_t i = 0; i < kPointCount; ++i)
+			hilbertCodes[i] = HilbertCode<3>(points[i]).getCode();
+		keep(hilbertCodes);
+	});
+
+	std::vector<uint64_t> sorted;
+	auto sortCodes = [&](const std::vector<uint64_t>& codes) {
+		return measure([&]() {
+			sorted = codes;
+			std::sort(sorted.begin(), sorted.end());
+			keep(sorted);
+		});
+	};
+
+	// Mean distance between consecutive points along the curve
+	auto meanDistance = [&](auto toMorton) {
+		double total = 0;
+		Point  previous = CompactMortonCode<3>::decodeByMasks(toMorton(sorted.front()));
+		for(size_t i = 1; i < kPointCount; ++i)
+		{
+			const Point point = CompactMortonCode<3>::decodeByMasks(toMorton(sorted[i]));
+			for(uint axis = 0; axis < 3; ++axis)
+				total += std::abs(static_cast<double>(point[axis]) - static_cast<double>(previous[axis]));
+			previous = point;
+		}
+		return total / (kPointCount - 1);
+	};
+
+	const double mortonSort	 = sortCodes(mortonCodes);
+	const double mortonStep	 = meanDistance([](uint64_t code) { return code; });
+	const double hilbertSort = sortCodes(hilbertCodes);
+	const double hilbertStep = meanDistance([](uint64_t code) { return HilbertCode<3>::toMorton(code); });
+
+	report("  encode, Morton", mortonEncode, mortonEncode);
+	report("  encode, Hilbert", hilbertEncode, mortonEncode);
+	report("  sort, Morton", mortonSort, mortonSort);
+	report("  sort, Hilbert", hilbertSort, mortonSort);
+	std::printf("  mean distance between consecutive points : Morton %.1f, Hilbert %.1f\n", mortonStep, hilbertStep);
+}
+
+inline void benchMortonBox()
+{
+	using Box  = MortonBox<3>;
+	using Code = Box::Code;
+
+	constexpr size_t   kPointCount = 1 << 20;
+	constexpr uint32_t kCoordCount = 1 << 10;
+	constexpr uint32_t kBoxSize	   = 48;
+	constexpr size_t   kBoxCount   = 32;
+
+	std::mt19937							random(14);
+	std::uniform_int_distribution<uint32_t> coord(0, kCoordCount - 1);
+	std::uniform_int_distribution<uint32_t> corner(0, kCoordCount - kBoxSize);
+
+	std::vector<uint64_t> codes(kPointCount);
+	for(uint64_t& code : codes)
+		code = Code({coord(random), coord(random), coord(random)}).getCode();
+	std::sort(codes.begin(), codes.end());
+
+	std::vector<Code::Point> mins(kBoxCount);
+	for(Code::Point& min : mins)
+		min = {corner(random), corner(random), corner(random)};
+
+	auto maxOf = [](const Code::Point& min) {
+		return Code::Point{min[0] + kBoxSize - 1, min[1] + kBoxSize - 1, min[2] + kBoxSize - 1};
+	};
+
+	std::printf("MortonBox<3> : %zu sorted codes, %zu boxes of %u^3 cells\n", kPointCount, kBoxCount, kBoxSize);
+
+	size_t count = 0;
+
+	const double perCell = measure([&]() {
+		count = 0;
+		for(const Code::Point& min : mins)
+			for(uint32_t x = min[0]; x < min[0] + kBoxSize; ++x)
+				for(uint32_t y = min[1]; y < min[1] + kBoxSize; ++y)
+					for(uint32_t z = min[2]; z < min[2] + kBoxSize; ++z)
+					{
+						const uint64_t code	 = Code({x, y, z}).getCode();
+						const auto	   range = std::equal_range(codes.begin(), codes.end(), code);
+						count += range.second - range.first;
+					}
+		keep(count);
+	});
+	const size_t expected = count;
+
+	const double scan = measure([&]() {
+		count = 0;
+		for(const Code::Point& min : mins)
+		{
+			const Box box(min, maxOf(min));
+			for(auto it = std::lower_bound(codes.begin(), codes.end(), box.getMinCode());
+				it != codes.end() && *it <= box.getMaxCode(); ++it)
+				count += box.contains(*it);
+		}
+		keep(count);
+	});
+	const bool scanMatches = count == expected;
+
+	const double bigMin = measure([&]() {
+		count = 0;
+		for(const Code::Point& min : mins)
+			Box(min, maxOf(min)).visitSorted(codes.begin(), codes.end(), [&](std::vector<uint64_t>::const_iterator) { ++count; });
+		keep(count);
+	});
+	const bool bigMinMatches = count == expected;
+
+	const double intervals = measure([&]() {
+		count = 0;
+		for(const Code::Point& min : mins)
+		{
+			const Box box(min, maxOf(min));
+			for(const Box::Interval& interval : box.decompose(64))
+				for(auto it = std::lower_bound(codes.begin(), codes.end(), interval.first);
+					it != codes.end() && *it <= interval.last; ++it)
+					count += box.contains(*it);
+		}
+		keep(count);
+	});
+	const bool intervalsMatch = count == expected;
+
+	report("  per cell lookups", perCell, perCell);
+	report("  scan between the corner codes", scan, perCell);
+	report("  BIGMIN jumps", bigMin, perCell);
+	report("  64 intervals", intervals, perCell);
+	std::printf("  %zu codes found, same counts : %d %d %d\n", expected, scanMatches, bigMinMatches, intervalsMatch);
+}
+
+inline void benchMortonBatch()
+{
+	using Batch = MortonBatch<3>;
+
+	constexpr size_t   kPointCount = 1 << 23;
+	constexpr uint	   kLevelCount = 16;
+	constexpr uint32_t kCoordCount = 1 << kLevelCount;
+
+	std::mt19937							random(15);
+	std::uniform_int_distribution<uint32_t> coord(0, kCoordCount - 1);
+
+	Batch points(kLevelCount);
+	points.reserve(kPointCount);
+	for(size_t i = 0; i < kPointCount; ++i)
+		points.add({coord(random), coord(random), coord(random)});
+
+	ThreadPool pool;
+
+	std::printf("MortonBatch<3> : %zu codes of %u levels, %u threads\n", kPointCount, kLevelCount, pool.getThreadCount());
+
+	std::vector<uint64_t> codes;
+	const double		  stdSort = measure([&]() {
+		 codes.assign(points.begin(), points.end());
+		 std::sort(codes.begin(), codes.end());
+		 codes.erase(std::unique(codes.begin(), codes.end()), codes.end());
+		 keep(codes);
+	 });
+
+	Batch		 batch = points;
+	const double radix = measure([&]() {
+		batch = points;
+		batch.sort();
+		batch.unique();
+		keep(batch);
+	});
+	const double parallelRadix = measure([&]() {
+		batch = points;
+		batch.sort(pool);
+		batch.unique();
+		keep(batch);
+	});
+	const bool matches = std::equal(batch.begin(), batch.end(), codes.begin(), codes.end());
+
+	const double copy = measure([&]() {
+		batch = points;
+		keep(batch);
+	});
+
+	report("  copy, for reference", copy, stdSort);
+	report("  std::sort + std::unique", stdSort, stdSort);
+	report("  radix sort + unique", radix, stdSort);
+	report("  parallel radix sort + unique", parallelRadix, stdSort);
+	std::printf("  same codes : %d\n", matches);
+}
+
+} // namespace qotf::bench
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <qotf/utils/Type.hpp>
+
+#include <chrono>
+#include <cstdio>
+
+namespace qotf::bench
+{
+
+/**
+ * Run [function] [repeat] times and return the mean duration of a run in milliseconds
+ */
+template<class Function>
+double measure(Function&& function, uint repeat = 5)
+{
+	using Clock = std::chrono::steady_clock;
+
+	const Clock::time_point start = Clock::now();
+	for(uint i = 0; i < repeat; ++i)
+		function();
+	const Clock::time_point end = Clock::now();
+
+	return std::chrono::duration<double, std::milli>(end - start).count() / repeat;
+}
+
+inline void report(const char* name, double milliseconds, double referenceMilliseconds)
+{
+	std::printf("%-48s %10.3f ms  (x%.2f)\n", name, milliseconds, referenceMilliseconds / milliseconds);
+}
+
+/**
+ * Prevent the compiler from optimizing away [value]
+ */
+template<class T>
+void keep(const T& value)
+{
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+} // namespace qotf::bench
@@ -0,0 +1,29 @@
+#include <QotBenchmarks/BenchBinNTree.hpp>
+#include <QotBenchmarks/BenchByteHelper.hpp>
+#include <QotBenchmarks/BenchExcessScanner.hpp>
+#include <QotBenchmarks/BenchMortonCode.hpp>
+
+int main()
+{
+	qotf::bench::benchByteHelper();
+	qotf::bench::benchExcessScanner();
+	qotf::bench::benchBinNTreeQueries();
+	qotf::bench::benchBinNTreeInsertion();
+	qotf::bench::benchBinNTreeBuild();
+	qotf::bench::benchBinNTreeEdits();
+	qotf::bench::benchBinNTreeCodePaths();
+	qotf::bench::benchBinNTreeBatchQueries();
+	qotf::bench::benchBinNTreeCursor();
+	qotf::bench::benchBinNTreeDeferredCollapse();
+	qotf::bench::benchBinNTreeSetOperations();
+	qotf::bench::benchBinNTreeExpression();
+	qotf::bench::benchBinNTreeBoxQueries();
+	qotf::bench::benchBinNTreeVolume();
+	qotf::bench::benchBinNTreeRays();
+	qotf::bench::benchMortonCode();
+	qotf::bench::benchHilbertCode();
+	qotf::bench::benchMortonBox();
+	qotf::bench::benchMortonBatch();
+
+	return 0;
+}
@@ -1,19 +1,51 @@
 #pragma once
 
 #include <qotf/NTree.hpp>
+#include <qotf/internal/BitUtils.hpp>
 #include <qotf/internal/BitVector.hpp>
+#include <qotf/internal/ChunkedBitVector.hpp>
+#include <qotf/internal/ExcessScanner.hpp>
+#include <qotf/internal/FenwickTree.hpp>
+#include <qotf/internal/InlineStack.hpp>
+#include <qotf/internal/SubtreeIndex.hpp>
+#include <qotf/morton/MortonBatch.hpp>
+#include <qotf/morton/MortonBox.hpp>
+#include <qotf/utils/Ray.hpp>
+#include <qotf/utils/ThreadPool.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace qotf
 {
 
+template<uint D>
+class BinNTreeBuilder;
+
+template<uint D, class BitArray>
+class BinNTreeExpression;
+
 /**
  * A structure for compact trees with no label
  * It has 3 types of nodes :
  *  - Composite  (NodeState::CompositeEmpty)
  *  - Leaf empty (NodeState::LeafEmpty)
  *  - Leaf full  (NodeState::LeafFilled)
+ *
+ * BitArray stores the nodes, it is either a BitVector, or a ChunkedBitVector
+ * for trees edited far from their end, since its insertions and removals
+ * only shift the bits of a block
+ *
+ * The subtree index and the volume summary are kept up to date by the edits, so the const functions
+ * only read the tree : they can be called from several threads at once, as long as no thread edits the tree.
  */
-template<uint D>
+template<uint D, class BitArray = internal::BitVector>
 class BinNTree final : public NTree<D>
 {
 	static_assert(D < 8);
@@ -22,37 +54,59 @@ class BinNTree final : public NTree<D>
 	static constexpr ushort kNodeSize		  = 2;
 	static constexpr ushort kByteSize		  = 8;
 	static constexpr byte	kNodeMask		  = byte{0b11};
+	static constexpr byte	kCompositeMask	  = byte{0b10};
 
+	using ExcessScanner = internal::ExcessScanner<powerOfTwo(D)>;
+	using SubtreeIndex	= internal::SubtreeIndex<powerOfTwo(D)>;
+
+	friend class BinNTreeBuilder<D>;
+	friend class BinNTreeExpression<D, BitArray>;
+
+	/**
+	 * Position of a node, packed in the index of its first bit (8 bytes, to keep path stacks small)
+	 */
 	class NodeIndex
 	{
-		static constexpr byte kByteMask = 0b111;
-
 		// There are four nodes per bytes
 		// The first node of a byte is on the two leftmost bits
 		// In order to read it, we need to shift the byte to the right by six bits
-		static constexpr uint kFirstNodeShift  = 6u;
-		static constexpr uint kFourthNodeShift = 0u;
+		static constexpr uint kFirstNodeShift = 6u;
 
 	public:
-		size_t byteIndex;
-		uint   bitShift;
-
-		NodeIndex();
-		explicit NodeIndex(size_t bitIndex);
+		NodeIndex() :
+			m_bitIndex(0) {}
+		explicit NodeIndex(size_t bitIndex) :
+			m_bitIndex(bitIndex) {}
 		NodeIndex(const NodeIndex&) = default;
 
 		NodeIndex& operator=(const NodeIndex&) = default;
 
-		size_t toBitIndex() const;
+		size_t byteIndex() const { return internal::bitutils::byteIndex(m_bitIndex); }
+		uint   bitShift() const { return kFirstNodeShift - internal::bitutils::bitIndexInsideByte(m_bitIndex); }
+
+		size_t toBitIndex() const { return m_bitIndex; }
+		size_t toNodePosition() const { return m_bitIndex / kNodeSize; }
 
 		NodeIndex& operator++();
 		NodeIndex  operator++(int);
 
 		NodeIndex& operator--();
 		NodeIndex  operator--(int);
+
+	private:
+		size_t m_bitIndex;
 	};
 
 public:
+	/**
+	 * Deepest tree : the Morton codes hold at most 64 levels under the root
+	 */
+	static constexpr uint kMaxDepth = 65;
+
+	/**
+	 * Requires :
+	 *   - maxDepth <= kMaxDepth
+	 */
 	BinNTree(uint maxDepth, uint initNodeCount = 0);
 
 	uint getDepth() const override { return m_depth; }
@@ -64,20 +118,378 @@ public:
 	 */
 	NodeState getNodeState(const MortonCode<D>&, uint nodeDepth) const override;
 
-	void setNode(const MortonCode<D>&, uint nodeDepth);
+	/**
+	 * Same as getNodeState, without virtual calls if Code is a final class
+	 */
+	template<class Code, class = EnableIfMortonCode<Code, D>>
+	NodeState getNodeState(const Code&, uint nodeDepth) const;
+
+	/**
+	 * Same as calling getNodeState for every code in [first, last), writing the states to [states]
+	 * A Cursor keeps the path from the root to the last node, and each query only goes back
+	 * to the common ancestor of its node and the previous one, so the tree is walked once
+	 * instead of a root descent per code
+	 * Requires :
+	 *   - the codes are sorted in Morton order (duplicates are allowed)
+	 *   - Iterator dereferences to a MortonCode<D>
+	 */
+	template<class Iterator>
+	void getNodeStates(Iterator first, Iterator last, uint nodeDepth, NodeState states[]) const;
+
+	/**
+	 * Same as above, for codes in any order : [states] follows the order of [codes]
+	 */
+	template<class Word>
+	void getNodeStates(const MortonBatch<D, Word>& codes, uint nodeDepth, NodeState states[]) const;
+
+	/**
+	 * Same as getNodeStates, on the threads of [pool]
+	 * The sorted codes are cut in contiguous ranges, one per thread, and each thread walks the tree
+	 * for its range with its own path, writing its part of [states]
+	 * Requires :
+	 *   - the tree is not modified during the call
+	 *   - Iterator is a random access iterator
+	 */
+	template<class Iterator>
+	void getNodeStates(Iterator first, Iterator last, uint nodeDepth, NodeState states[], ThreadPool& pool) const;
+
+	template<class Word>
+	void getNodeStates(const MortonBatch<D, Word>& codes, uint nodeDepth, NodeState states[], ThreadPool& pool) const;
+
+	/**
+	 * Call [visitor](code, depth) for each Filled leaf overlapping [box], in Morton order,
+	 * with the CompactMortonCode<D> of the first cell of the leaf and its depth
+	 * The cells of the box are the deepest nodes of the tree. The subtrees out of the box are skipped
+	 * without being read, and the box is not checked again under a node inside it.
+	 * Requires :
+	 *   - maxDepth - 1 <= CompactMortonCode<D>::kLevelCount, otherwise std::invalid_argument is thrown
+	 */
+	template<class Visitor>
+	void visitFilledLeaves(const MortonBox<D>& box, Visitor&& visitor) const;
+
+	/**
+	 * Return whether or not a cell of [box] is filled, stopping at the first Filled leaf found
+	 * Without pending collapse, a Composite node inside the box always has a Filled leaf,
+	 * so its subtree is not read
+	 * Requires :
+	 *   - maxDepth - 1 <= CompactMortonCode<D>::kLevelCount, otherwise std::invalid_argument is thrown
+	 */
+	bool anyFilled(const MortonBox<D>& box) const;
+
+	/**
+	 * Return the number of filled cells, the cells being the deepest nodes
+	 * With the volume summary, it is maintained by the edits and costs O(1)
+	 * Requires :
+	 *   - D * (maxDepth - 1) < 64, otherwise std::invalid_argument is thrown
+	 */
+	uint64_t filledVolume() const;
+
+	/**
+	 * Return the number of filled cells of [box]
+	 * The subtrees inside the box are counted without enumerating their leaves : with the volume summary,
+	 * the large ones are counted in O(log(summary size)), and in the others the children
+	 * which are all leaves are counted at once
+	 * Requires :
+	 *   - D * (maxDepth - 1) < 64, otherwise std::invalid_argument is thrown
+	 */
+	uint64_t countFilled(const MortonBox<D>& box) const;
+
+	/**
+	 * Find the first Filled leaf crossed by the ray from [origin] along [direction], within [maxDistance],
+	 * in the space of Ray, and set [hit] to it. Return false if there is none
+	 * The nodes are crossed as a hierarchical DDA : the children of a Composite node are visited
+	 * in the order of the ray, and an Empty leaf is crossed in a single step whatever its size.
+	 * A Filled leaf only touched by the ray, on its border, is not hit.
+	 * Requires :
+	 *   - direction is not null, otherwise std::invalid_argument is thrown
+	 *   - maxDepth - 1 <= CompactMortonCode<D>::kLevelCount, otherwise std::invalid_argument is thrown
+	 */
+	bool castRay(const std::array<double, D>& origin, const std::array<double, D>& direction, double maxDistance, RayHit<D>& hit) const;
+
+	/**
+	 * Return whether or not the segment between [a] and [b] crosses no Filled leaf, as castRay
+	 */
+	bool lineOfSight(const std::array<double, D>& a, const std::array<double, D>& b) const;
+
+	/**
+	 * Cast the [count] rays of [rays], and write their hits to [hits], with a depth of 0 for a miss
+	 * With a pool, the rays are split in ranges of at least kMinQueriesPerTask rays
+	 */
+	void castRays(const Ray<D> rays[], size_t count, RayHit<D> hits[]) const;
+	void castRays(const Ray<D> rays[], size_t count, RayHit<D> hits[], ThreadPool& pool) const;
+
+	template<class Code, class = EnableIfMortonCode<Code, D>>
+	void setNode(const Code&, uint nodeDepth);
+
+	template<class Code, class = EnableIfMortonCode<Code, D>>
+	void removeNode(const Code&, uint nodeDepth);
+
+	/**
+	 * Same as calling setNode for every code in [first, last), in a single pass
+	 * The whole tree is rewritten once, so it costs O(node count + code count)
+	 * instead of a root descent and a shift of the array per code
+	 * Requires :
+	 *   - the codes are sorted in Morton order (duplicates are allowed)
+	 *   - Iterator dereferences to a MortonCode<D>
+	 */
+	template<class Iterator>
+	void setNodes(Iterator first, Iterator last, uint nodeDepth);
+
+	/**
+	 * Enable or disable the subtree index
+	 * When enabled, child and subtree end lookups skip whole blocks of nodes
+	 * instead of reading every node of the skipped subtrees.
+	 * The edits update the blocks they touch, in O(log(node count)).
+	 * It costs about a third of the memory of the nodes.
+	 */
+	void setSubtreeIndexEnabled(bool enabled);
+	bool isSubtreeIndexEnabled() const { return m_subtreeIndexEnabled; }
+
+	/**
+	 * Enable or disable the deferred collapse of the nodes
+	 * When deferred, setNode and removeNode do not merge uniform children into their parent :
+	 * a node whose children are all the same leaf stays Composite until compact is called.
+	 * The cells keep the same state, but a query on such a node at its own depth
+	 * returns CompositeEmpty instead of the leaf state.
+	 * Disabling the deferred collapse compacts the tree.
+	 */
+	void setCollapseDeferred(bool deferred);
+	bool isCollapseDeferred() const { return m_collapseDeferred; }
+
+	/**
+	 * Enable or disable the volume summary
+	 * When enabled, the filled volume of the tree is kept, and the filled volume of the subtrees
+	 * of at least kMinSummarizedNodeCount nodes, with the size of the subtree.
+	 * setNode and removeNode update the volumes and the sizes of the ancestors of the edited node, and move
+	 * the following entries of its block of the summary when they add or remove nodes.
+	 * The summary is rebuilt, in a single pass, when it is enabled, by setNodes, compact and the set operations,
+	 * and by the first edit once the previous ones have added more nodes than half the tree,
+	 * since the subtrees they grow have no entry.
+	 * Requires :
+	 *   - D * (maxDepth - 1) < 64, otherwise std::invalid_argument is thrown
+	 */
+	void setVolumeSummaryEnabled(bool enabled);
+	bool isVolumeSummaryEnabled() const { return m_volumeSummaryEnabled; }
+
+	/**
+	 * Return whether or not some uniform children may still have to be merged into their parent
+	 */
+	bool hasPendingCollapse() const { return m_hasPendingCollapse; }
+
+	/**
+	 * Merge every group of uniform children into their parent, in a single pass over the nodes
+	 */
+	void compact();
+
+	/**
+	 * Replace the tree by its union (resp. intersection, difference and symmetric difference) with [other]
+	 * Both preorder streams are read together, once : a subtree facing a leaf of the other tree
+	 * is copied, complemented or skipped as a whole, and uniform children are merged on output,
+	 * so it costs O(node count of both trees)
+	 * Requires :
+	 *   - other has the same depth, otherwise std::invalid_argument is thrown
+	 */
+	void unite(const BinNTree& other);
+	void intersect(const BinNTree& other);
+	void subtract(const BinNTree& other);
+	void symmetricDifference(const BinNTree& other);
 
-	void removeNode(const MortonCode<D>&, uint nodeDepth);
+	class Cursor;
 
 private:
-	internal::BitVector m_bitArray;
+	/**
+	 * Path from the root to a node, on the stack of the editing function
+	 */
+	using PathStack = internal::InlineStack<NodeIndex, kMaxDepth>;
+
+	BitArray	 m_bitArray;
+	SubtreeIndex m_subtreeIndex;
+
+	/**
+	 * Output buffer of setNodes, kept to reuse its capacity
+	 */
+	internal::BitVector m_scratch;
 
 	uint m_depth;
 	uint m_nodeCount;
+	bool m_subtreeIndexEnabled;
+	bool m_collapseDeferred	  = false;
+	bool m_hasPendingCollapse = false;
+
+	/**
+	 * Filled volume of a subtree of [nodeCount] nodes, whose root is [offset] nodes after the first node of its block
+	 */
+	struct VolumeEntry
+	{
+		size_t	 offset;
+		size_t	 nodeCount;
+		uint64_t volume;
+	};
+
+	/**
+	 * Smallest subtree whose volume is kept by the volume summary
+	 */
+	static constexpr size_t kMinSummarizedNodeCount = 256;
+
+	/**
+	 * Number of nodes of a block of the volume summary when it is built
+	 */
+	static constexpr size_t kVolumeBlockNodeCount = 4096;
+
+	// Volume summary : the entries are sorted by position and cut into blocks of nodes, whose node counts
+	// give the first position of each block, so an edit only moves the entries of its own block
+	std::vector<std::vector<VolumeEntry>> m_volumeBlocks;
+	internal::FenwickTree<size_t>		  m_volumeBlockNodeCounts;
+	uint64_t							  m_filledVolume		 = 0;
+	bool								  m_volumeSummaryEnabled = false;
+
+	/**
+	 * Number of nodes added by the edits since the volume summary was built
+	 */
+	size_t m_unsummarizedNodeCount = 0;
+
+	/**
+	 * Build a tree from its preorder stream of nodes
+	 */
+	BinNTree(uint maxDepth, internal::BitVector&& bitArray);
+
+	/**
+	 * Minimum number of queries answered by a thread of a parallel query
+	 */
+	static constexpr size_t kMinQueriesPerTask = 1024;
+
+	/**
+	 * Call [answer] with sorted codes equal to [codes], and write the states it gives
+	 * to [states] in the order of [codes]
+	 */
+	template<class Word, class Answer>
+	static void answerInMortonOrder(const MortonBatch<D, Word>& codes, NodeState states[], Answer&& answer);
+
+	/**
+	 * Throw std::invalid_argument if the codes of a MortonBox cannot hold the cells of the tree
+	 */
+	void checkBoxDepth() const;
+
+	/**
+	 * Throw std::invalid_argument if the volume of the tree does not fit in 64 bits
+	 */
+	void checkVolumeDepth() const;
+
+	/**
+	 * Return the number of cells of a node with [level] levels under it
+	 */
+	static uint64_t cellVolume(uint level) { return uint64_t{1} << (D * level); }
+
+	/**
+	 * Return the filled volume of the subtree at [index], which has [level] levels under it,
+	 * then move [index] to the end of this subtree
+	 */
+	uint64_t subtreeVolume(NodeIndex& index, uint level) const;
+
+	/**
+	 * Same as subtreeVolume, from the entry of the subtree in the volume summary if it has one
+	 */
+	uint64_t summarizedVolume(NodeIndex index, uint level) const;
+
+	/**
+	 * Rebuild the volume summary, in a single pass over the nodes
+	 */
+	void refreshVolumeSummary();
+
+	/**
+	 * Rebuild the volume summary if the subtrees grown by the edits, which have no entry,
+	 * hold more than half of the nodes
+	 */
+	void refreshGrownVolumeSummary();
+
+	/**
+	 * Update the volume summary after an edit replacing [previousVolume] filled cells by [volume] filled cells
+	 * in the last node of [path], which holds the nodes from the root
+	 */
+	void updateFilledVolume(uint64_t previousVolume, uint64_t volume, const PathStack& path);
+
+	/**
+	 * Move the entries of the volume summary after [count] nodes were added at [position],
+	 * as the children of the node before them, and grow the entries of [path], which holds this node
+	 */
+	void insertVolumeNodes(size_t position, size_t count, const PathStack& path);
+
+	/**
+	 * Move the entries of the volume summary after the [count] children of the node at [parentPosition]
+	 * were removed, remove the entries of this node and of its descendants, and shrink the entries
+	 * of [path] before this node
+	 */
+	void removeVolumeNodes(size_t parentPosition, size_t count, const PathStack& path);
+
+	/**
+	 * Return the block of the volume summary holding the node at [position],
+	 * and set [offset] to the position of the node inside it
+	 * Requires :
+	 *   - position < node count
+	 */
+	size_t findVolumeBlock(size_t position, size_t& offset) const;
+
+	/**
+	 * Return the index in [block] of the entry of the subtree at [position],
+	 * or the size of [block] if it has none
+	 */
+	size_t findVolumeEntry(size_t position, size_t& block) const;
+
+	/**
+	 * Call [update] with the entry of each node of [path] before [position] which has one
+	 */
+	template<class Update>
+	void updatePathEntries(const PathStack& path, size_t position, Update&& update);
+
+	/**
+	 * Return the number of filled cells of [box] in the subtree at [index], as visitBoxNodes
+	 * [min] and [max] are the corners of the box
+	 */
+	uint64_t countFilledNodes(NodeIndex& index, uint64_t prefix, uint level, bool isInside, const MortonBox<D>& box,
+							  const std::array<uint32_t, D>& min, const std::array<uint32_t, D>& max) const;
+
+	/**
+	 * Ray of castRay, with a normalized direction
+	 */
+	struct RayTraversal
+	{
+		std::array<double, D> origin;
+		std::array<double, D> direction;
+		std::array<double, D> inverseDirection;
+	};
+
+	/**
+	 * Find the first Filled leaf crossed by [ray] in the subtree at [index], whose first cell is [prefix]
+	 * and whose corner is [corner], and which has [level] levels under it
+	 * The ray crosses the subtree between the distances [tEnter] and [tExit]
+	 */
+	bool castRayNodes(NodeIndex index, uint64_t prefix, const std::array<double, D>& corner, uint level, double tEnter, double tExit,
+					  const RayTraversal& ray, RayHit<D>& hit) const;
+
+	/**
+	 * Call [visitor] for the Filled leaves overlapping [box] in the subtree at [index],
+	 * whose first cell is [prefix] and which has [level] levels under it,
+	 * then move [index] to the end of this subtree
+	 * If [isInside] is true, the subtree is inside the box
+	 */
+	template<class Visitor>
+	void visitBoxNodes(NodeIndex& index, uint64_t prefix, uint level, bool isInside, const MortonBox<D>& box, Visitor& visitor) const;
+
+	/**
+	 * Return whether or not a cell of [box] is filled in the subtree at [index], as visitBoxNodes
+	 * [index] is only moved to the end of the subtree if it returns false
+	 */
+	bool anyFilledNodes(NodeIndex& index, uint64_t prefix, uint level, const MortonBox<D>& box) const;
 
 	NodeState getNodeState(NodeIndex index) const;
 	void	  setNodeState(NodeIndex index, NodeState node);
 	void	  cleanNode(NodeIndex index);
 
+	/**
+	 * Get the index of the node following the [subtreeCount] subtrees beginning at [index]
+	 */
+	NodeIndex skipSubtrees(NodeIndex index, uint subtreeCount) const;
+
 	/**
 	 * Get the index of the child at [childPos], of the node at [index]
 	 * Requires :
@@ -93,194 +505,1118 @@ private:
 	NodeIndex getParentEndIndex(NodeIndex index) const;
 
 	/**
-	 * Add [filled] children to the parent node at [index]
+	 * Add [child] children at [index], right after their parent node, whose ancestors are in [path]
 	 */
-	void addChildren(NodeIndex index, NodeState child);
+	void addChildren(NodeIndex index, NodeState child, const PathStack& path);
 
 	/**
-	 * Remove the children of the parent node at [index]
+	 * Remove the children of the parent node at [index], whose ancestors are in [path]
 	 * Requires :
 	 *   - the node at [index] must be Composed
 	 */
-	void removeChildren(NodeIndex index);
+	void removeChildren(NodeIndex index, const PathStack& path);
 
 	/**
 	 * Return whether or not the node at [index] has been optimized
 	 * If the node is Composite and its children are all Full (resp. Empty)
 	 * then this node become Full (resp. Empty) and its children are removed
 	 */
-	bool optimizeNode(NodeIndex index);
+	bool optimizeNode(NodeIndex index, const PathStack& path);
+
+	/**
+	 * Append to [output] the subtree at [index], where the nodes at [nodeLevel]
+	 * of the codes in [first, last) are filled, then move [index] to the end of this subtree
+	 * Uniform children are merged into their parent on the fly
+	 * If [isVirtual] is true, the subtree is an Empty leaf missing from m_bitArray,
+	 * and [index] is left untouched
+	 */
+	template<class Iterator>
+	void mergeNodes(NodeIndex& index, bool isVirtual, Iterator first, Iterator last, uint level, uint nodeLevel, internal::BitVector& output) const;
+
+	/**
+	 * Append [node] at the end of [bits]
+	 */
+	static void appendNode(internal::BitVector& bits, NodeState node);
+
+	/**
+	 * Replace the node at [parentPosition], the last Composite node of [bits],
+	 * by its children if they are all the same leaf
+	 */
+	static void mergeLastChildren(internal::BitVector& bits, size_t parentPosition);
+
+	/**
+	 * Replace the nodes by the ones written in m_scratch
+	 */
+	void swapScratch();
+
+	/**
+	 * Truth tables of the set operations : the bit (a << 1 | b) is the state of a cell
+	 * filled (a) in this tree and (b) in the other one
+	 */
+	static constexpr uint8_t kUnionTable			   = 0b1110;
+	static constexpr uint8_t kIntersectionTable		   = 0b1000;
+	static constexpr uint8_t kDifferenceTable		   = 0b0100;
+	static constexpr uint8_t kSymmetricDifferenceTable = 0b0110;
+
+	/**
+	 * Replace the tree by the cells whose states in this tree and in [other] give a set bit of [truthTable]
+	 */
+	void combine(const BinNTree& other, uint8_t truthTable);
+
+	/**
+	 * Append to [output] the combination of the subtrees at [index] and at [otherIndex] in [other],
+	 * then move both indices to the end of their subtree
+	 */
+	void combineNodes(NodeIndex& index, const BinNTree& other, NodeIndex& otherIndex, uint8_t truthTable, internal::BitVector& output) const;
+
+	/**
+	 * Append to [output] the subtree of [tree] at [index] combined with a leaf : as the result
+	 * only depends on the subtree, it is a leaf, or the subtree copied or complemented.
+	 * [emptyResult] and [filledResult] are the results of an Empty and a Filled cell of the subtree
+	 */
+	static void appendCombinedSubtree(const BinNTree& tree, NodeIndex& index, bool emptyResult, bool filledResult, internal::BitVector& output);
+
+	/**
+	 * Append to [output] the subtree of [tree] at [index], then move [index] to the end of this subtree
+	 */
+	static void appendSubtree(const BinNTree& tree, NodeIndex& index, internal::BitVector& output);
+
+	/**
+	 * Swap the Empty and Filled leaves of [bits] from the node at [firstBitIndex] to the end
+	 */
+	static void complementLeaves(internal::BitVector& bits, size_t firstBitIndex);
+};
+
+/**
+ * Position in a BinNTree, keeping the path of node indices from the root to its node
+ * and the child taken at each depth (the Morton prefix of the node)
+ *
+ * seek only climbs to the common ancestor of the current node and the target, so close
+ * queries share most of their path. firstChild, nextSibling and parent move in O(1) amortized
+ * over a depth-first traversal : the end of a subtree is kept once its last child is left,
+ * so going to the next sibling of a visited subtree does not scan it again.
+ * The tree must not be modified while the cursor is used.
+ */
+template<uint D, class BitArray>
+class BinNTree<D, BitArray>::Cursor
+{
+public:
+	using Point = std::array<uint32_t, D>;
+
+	/**
+	 * Cursor on the root of [tree]
+	 */
+	explicit Cursor(const BinNTree& tree);
+
+	/**
+	 * Return the depth of the node, 1 for the root
+	 */
+	uint getDepth() const { return static_cast<uint>(m_path.size()); }
+
+	NodeState getState() const { return m_tree->getNodeState(m_path.back().index); }
+
+	/**
+	 * Return the position of the node among its siblings, 0 for the root
+	 */
+	uint getChildPosition() const { return m_path.back().childPos; }
+
+	/**
+	 * Return the coordinates of the first deepest cell of the node
+	 * Requires :
+	 *   - maxDepth - 1 <= 32, the width of the coordinates, otherwise std::invalid_argument is thrown
+	 */
+	Point getCorner() const;
+
+	/**
+	 * Move to the node of [mortonCode] at [nodeDepth], or to the leaf containing it,
+	 * and return its state, as getNodeState
+	 */
+	template<class Code, class = EnableIfMortonCode<Code, D>>
+	NodeState seek(const Code& mortonCode, uint nodeDepth);
+
+	/**
+	 * Move to the first child of the node
+	 * Return false, without moving, if the node is a leaf
+	 */
+	bool firstChild();
+
+	/**
+	 * Move to the next sibling of the node
+	 * Return false, without moving, if the node is the root or the last child of its parent
+	 */
+	bool nextSibling();
+
+	/**
+	 * Move to the parent of the node
+	 * Return false, without moving, if the node is the root
+	 */
+	bool parent();
+
+private:
+	struct PathNode
+	{
+		NodeIndex index;
+		NodeIndex end;
+		uint	  childPos;
+		bool	  hasEnd;
+	};
+
+	const BinNTree*		  m_tree;
+	std::vector<PathNode> m_path;
+
+	/**
+	 * Return the index following the subtree of [node]
+	 */
+	NodeIndex getEnd(const PathNode& node) const;
+
+	/**
+	 * Return the end of [node] if it is known without reading its subtree
+	 */
+	bool findEnd(const PathNode& node, NodeIndex& end) const;
 };
 
 /***************************
  * BinNTree implementation *
  ***************************/
 
-template<uint D>
-inline NodeState BinNTree<D>::getNodeState(NodeIndex index) const
+template<uint D, class BitArray>
+inline NodeState BinNTree<D, BitArray>::getNodeState(NodeIndex index) const
 {
-	const byte& bytes = m_bitArray.getData()[index.byteIndex];
-	return static_cast<NodeState>((bytes >> index.bitShift) & kNodeMask);
+	const byte bytes = m_bitArray.byteAt(index.byteIndex());
+	return static_cast<NodeState>((bytes >> index.bitShift()) & kNodeMask);
 }
 
-template<uint D>
-inline void BinNTree<D>::cleanNode(NodeIndex index)
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::cleanNode(NodeIndex index)
 {
-	byte& bytes = m_bitArray.getData()[index.byteIndex];
-	bytes &= ~(kNodeMask << index.bitShift);
+	byte& bytes = m_bitArray.byteAt(index.byteIndex());
+	bytes &= ~(kNodeMask << index.bitShift());
 }
 
-template<uint D>
-inline void BinNTree<D>::setNodeState(NodeIndex index, NodeState node)
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::setNodeState(NodeIndex index, NodeState node)
 {
-	m_bitArray.setBit();
-	byte& bytes = m_bitArray.getData()[index.byteIndex];
+	byte&	   bytes	 = m_bitArray.byteAt(index.byteIndex());
+	const byte nodeBits = static_cast<byte>(node) << index.bitShift();
+
+	// Only a Composite bit change modifies the shape of the tree
+	const bool isShapeChanged = ((bytes ^ nodeBits) & (kCompositeMask << index.bitShift())) != byte{0};
+
 	cleanNode(index);
-	bytes |= static_cast<byte>(node) << index.bitShift;
+	bytes |= nodeBits;
+
+	if(m_subtreeIndexEnabled && isShapeChanged)
+		m_subtreeIndex.update(m_bitArray, index.toNodePosition());
+}
+
+template<uint D, class BitArray>
+inline BinNTree<D, BitArray>::BinNTree(uint maxDepth, uint initNodeCount) :
+	m_bitArray(kDefaultNodeCount * kNodeSize),
+	m_depth(maxDepth),
+	m_nodeCount(kDefaultNodeCount),
+	m_subtreeIndexEnabled(false)
+{
+	if(maxDepth > kMaxDepth)
+		throw std::invalid_argument("BinNTree : the depth is above kMaxDepth");
+
+	// The initial node count is only a capacity hint
+	m_bitArray.reserve(initNodeCount * kNodeSize);
+}
+
+template<uint D, class BitArray>
+inline BinNTree<D, BitArray>::BinNTree(uint maxDepth, internal::BitVector&& bitArray) :
+	m_bitArray(std::move(bitArray)),
+	m_depth(maxDepth),
+	m_nodeCount(m_bitArray.size() / kNodeSize),
+	m_subtreeIndexEnabled(false)
+{
+	if(maxDepth > kMaxDepth)
+		throw std::invalid_argument("BinNTree : the depth is above kMaxDepth");
+}
+
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::setSubtreeIndexEnabled(bool enabled)
+{
+	m_subtreeIndexEnabled = enabled;
+	if(enabled)
+		m_subtreeIndex.build(m_bitArray, m_nodeCount);
+	else
+		m_subtreeIndex.clear();
+}
+
+template<uint D, class BitArray>
+inline typename BinNTree<D, BitArray>::NodeIndex BinNTree<D, BitArray>::skipSubtrees(NodeIndex index, uint subtreeCount) const
+{
+	const size_t nodePosition = index.toNodePosition();
+
+	if(m_subtreeIndexEnabled)
+	{
+		const size_t endPosition = m_subtreeIndex.forwardSearch(m_bitArray, nodePosition, subtreeCount);
+		return NodeIndex(endPosition * kNodeSize);
+	}
+
+	internal::Excess	   excess = 0;
+	const internal::Excess target = -static_cast<internal::Excess>(subtreeCount);
+
+	const size_t endPosition = ExcessScanner::forwardIn(m_bitArray, nodePosition, m_nodeCount, excess, target);
+	return NodeIndex(endPosition * kNodeSize);
+}
+
+template<uint D, class BitArray>
+inline typename BinNTree<D, BitArray>::NodeIndex BinNTree<D, BitArray>::getChildIndex(NodeIndex index, uint childPos) const
+{
+	NodeIndex& childIndex = ++index;
+
+	if(!childPos)
+		return childIndex;
+
+	// Skip the subtrees of the previous children
+	return skipSubtrees(childIndex, childPos);
+}
+
+template<uint D, class BitArray>
+inline typename BinNTree<D, BitArray>::NodeIndex BinNTree<D, BitArray>::getParentEndIndex(NodeIndex index) const
+{
+	// Skip the subtrees of all the children
+	return skipSubtrees(++index, BinNTree<D, BitArray>::kChildrenCount);
+}
+
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::addChildren(NodeIndex index, NodeState child, const PathStack& path)
+{
+	m_bitArray.insert(index.toBitIndex(), BinNTree<D, BitArray>::kChildrenCount * kNodeSize);
+	if(m_subtreeIndexEnabled)
+		m_subtreeIndex.insert(m_bitArray, index.toNodePosition(), BinNTree<D, BitArray>::kChildrenCount);
+	insertVolumeNodes(index.toNodePosition(), BinNTree<D, BitArray>::kChildrenCount, path);
+
+	for(uint i = 0; i < BinNTree<D, BitArray>::kChildrenCount; i++)
+		setNodeState(index++, child);
+
+	m_nodeCount += BinNTree<D, BitArray>::kChildrenCount;
+}
+
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::removeChildren(NodeIndex index, const PathStack& path)
+{
+	const NodeIndex nodeEndIndex = getParentEndIndex(index);
+
+	const size_t firstChildBitIndex = index.toBitIndex() + kNodeSize;
+	const size_t numberBitsToRemove = nodeEndIndex.toBitIndex() - firstChildBitIndex;
+
+	m_bitArray.remove(firstChildBitIndex, numberBitsToRemove);
+	if(m_subtreeIndexEnabled)
+		m_subtreeIndex.remove(m_bitArray, firstChildBitIndex / kNodeSize, numberBitsToRemove / kNodeSize);
+	m_nodeCount -= numberBitsToRemove / kNodeSize;
+	removeVolumeNodes(index.toNodePosition(), numberBitsToRemove / kNodeSize, path);
+}
+
+template<uint D, class BitArray>
+inline bool BinNTree<D, BitArray>::optimizeNode(NodeIndex parentIndex, const PathStack& path)
+{
+	NodeIndex childIndex = parentIndex;
+	++childIndex;
+
+	const NodeState firstChild = getNodeState(childIndex);
+	if(firstChild == NodeState::CompositeEmpty)
+		return false;
+
+	const byte childBits = static_cast<byte>(firstChild);
+	if(!ExcessScanner::allNodesEqualIn(m_bitArray, childIndex.toNodePosition(), BinNTree<D, BitArray>::kChildrenCount, childBits))
+		return false;
+
+	removeChildren(parentIndex, path);
+	setNodeState(parentIndex, firstChild);
+
+	return true;
+}
+
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::appendNode(internal::BitVector& bits, NodeState node)
+{
+	const NodeIndex index(bits.size());
+
+	bits.append(kNodeSize);
+	bits.data()[index.byteIndex()] |= static_cast<byte>(node) << index.bitShift();
+}
+
+template<uint D, class BitArray>
+template<class Iterator>
+void BinNTree<D, BitArray>::mergeNodes(NodeIndex& index, bool isVirtual, Iterator first, Iterator last, uint level, uint nodeLevel, internal::BitVector& output) const
+{
+	const NodeState state = isVirtual ? NodeState::LeafEmpty : getNodeState(index);
+	if(state == NodeState::CompositeFilled)
+		// TODO throw custom exception
+		throw std::logic_error("BitOctree::setNodes : Error while reading nodes");
+
+	// Nothing to fill, keep the subtree as it is
+	if(first == last)
+	{
+		if(isVirtual)
+		{
+			appendNode(output, NodeState::LeafEmpty);
+			return;
+		}
+
+		appendSubtree(*this, index, output);
+		return;
+	}
+
+	// The whole subtree is filled
+	if(level == nodeLevel || state == NodeState::LeafFilled)
+	{
+		appendNode(output, NodeState::LeafFilled);
+		if(!isVirtual)
+			index = skipSubtrees(index, 1);
+		return;
+	}
+
+	const size_t parentPosition = output.size() / kNodeSize;
+	appendNode(output, NodeState::CompositeEmpty);
+
+	// The children of an Empty leaf do not exist yet
+	const bool childrenAreVirtual = state == NodeState::LeafEmpty;
+	if(!isVirtual)
+		++index;
+
+	--level;
+	for(uint childPos = 0; childPos < BinNTree<D, BitArray>::kChildrenCount; ++childPos)
+	{
+		// The codes of this child are the next ones, as they are sorted
+		Iterator childLast = first;
+		while(childLast != last && (*childLast).decode(level) == childPos)
+			++childLast;
+
+		mergeNodes(index, childrenAreVirtual, first, childLast, level, nodeLevel, output);
+		first = childLast;
+	}
+
+	mergeLastChildren(output, parentPosition);
+}
+
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::appendSubtree(const BinNTree& tree, NodeIndex& index, internal::BitVector& output)
+{
+	const NodeIndex endIndex	  = tree.skipSubtrees(index, 1);
+	const size_t	firstBitIndex = index.toBitIndex();
+	const size_t	endBitIndex	  = endIndex.toBitIndex();
+
+	tree.m_bitArray.visitSegments(firstBitIndex, [&](const byte data[], size_t offset, size_t size) {
+		const size_t first = std::max(firstBitIndex, offset);
+		const size_t last  = std::min(endBitIndex, offset + size);
+
+		output.append(data, first - offset, last - first);
+		return last < endBitIndex;
+	});
+	index = endIndex;
+}
+
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::mergeLastChildren(internal::BitVector& bits, size_t parentPosition)
+{
+	// Merge the children if they are all the same leaf
+	// (if they are exactly kChildrenCount nodes, none of them is Composite)
+	const size_t childrenPosition = parentPosition + 1;
+	if(bits.size() / kNodeSize - childrenPosition != BinNTree<D, BitArray>::kChildrenCount)
+		return;
+
+	const NodeIndex childIndex(childrenPosition * kNodeSize);
+	const byte		childBits  = (bits.data()[childIndex.byteIndex()] >> childIndex.bitShift()) & kNodeMask;
+	const NodeState firstChild = static_cast<NodeState>(childBits);
+	if(!ExcessScanner::allNodesEqual(bits.data(), childrenPosition, BinNTree<D, BitArray>::kChildrenCount, childBits))
+		return;
+
+	bits.resize(parentPosition * kNodeSize);
+	appendNode(bits, firstChild);
+}
+
+template<uint D, class BitArray>
+NodeState BinNTree<D, BitArray>::getNodeState(const MortonCode<D>& mortonCode, uint nodeDepth) const
+{
+	return getNodeState<MortonCode<D>>(mortonCode, nodeDepth);
+}
+
+template<uint D, class BitArray>
+template<class Code, class>
+NodeState BinNTree<D, BitArray>::getNodeState(const Code& mortonCode, uint nodeDepth) const
+{
+	uint	  level		= m_depth - 1;
+	uint	  nodeLevel = m_depth - nodeDepth;
+	NodeIndex index;
+
+	// Road to the node
+	while(level > nodeLevel)
+	{
+		// Check the current node state
+		switch(getNodeState(index))
+		{
+		case NodeState::LeafEmpty:
+			return NodeState::LeafEmpty;
+		case NodeState::LeafFilled:
+			return NodeState::LeafFilled;
+		case NodeState::CompositeEmpty:
+			index = getChildIndex(index, mortonCode.decode(--level));
+			break;
+		case NodeState::CompositeFilled:
+			// TODO throw custom exception
+			throw std::logic_error("BitOctree::getNodeState : Error while reading nodes");
+		}
+	}
+
+	const NodeState state = getNodeState(index);
+	if(state == NodeState::CompositeFilled)
+		// TODO throw custom exception
+		throw std::logic_error("BitOctree::getNodeState : Error while reading nodes");
+
+	return state;
+}
+
+template<uint D, class BitArray>
+template<class Iterator>
+void BinNTree<D, BitArray>::getNodeStates(Iterator first, Iterator last, uint nodeDepth, NodeState states[]) const
+{
+	Cursor cursor(*this);
+	for(; first != last; ++first, ++states)
+		*states = cursor.seek(*first, nodeDepth);
+}
+
+template<uint D, class BitArray>
+template<class Word>
+void BinNTree<D, BitArray>::getNodeStates(const MortonBatch<D, Word>& codes, uint nodeDepth, NodeState states[]) const
+{
+	answerInMortonOrder(codes, states, [&](auto first, auto last, NodeState sortedStates[]) {
+		getNodeStates(first, last, nodeDepth, sortedStates);
+	});
+}
+
+template<uint D, class BitArray>
+template<class Iterator>
+void BinNTree<D, BitArray>::getNodeStates(Iterator first, Iterator last, uint nodeDepth, NodeState states[], ThreadPool& pool) const
+{
+	const size_t count	   = static_cast<size_t>(last - first);
+	const uint	 taskCount = static_cast<uint>(std::clamp<size_t>(count / kMinQueriesPerTask, 1, pool.getThreadCount()));
+	if(taskCount == 1)
+	{
+		getNodeStates(first, last, nodeDepth, states);
+		return;
+	}
+
+	pool.run(taskCount, [&](uint task) {
+		const size_t rangeFirst = count * task / taskCount;
+		const size_t rangeLast	= count * (task + 1) / taskCount;
+
+		getNodeStates(first + rangeFirst, first + rangeLast, nodeDepth, states + rangeFirst);
+	});
+}
+
+template<uint D, class BitArray>
+template<class Word>
+void BinNTree<D, BitArray>::getNodeStates(const MortonBatch<D, Word>& codes, uint nodeDepth, NodeState states[], ThreadPool& pool) const
+{
+	answerInMortonOrder(codes, states, [&](auto first, auto last, NodeState sortedStates[]) {
+		getNodeStates(first, last, nodeDepth, sortedStates, pool);
+	});
+}
+
+template<uint D, class BitArray>
+template<class Word, class Answer>
+void BinNTree<D, BitArray>::answerInMortonOrder(const MortonBatch<D, Word>& codes, NodeState states[], Answer&& answer)
+{
+	if(std::is_sorted(codes.begin(), codes.end()))
+	{
+		answer(codes.codesBegin(), codes.codesEnd(), states);
+		return;
+	}
+
+	// Sort the positions of the codes, and answer in the sorted order
+	std::vector<std::pair<Word, size_t>> sorted(codes.size());
+	for(size_t i = 0; i < codes.size(); ++i)
+		sorted[i] = {codes[i], i};
+	std::sort(sorted.begin(), sorted.end());
+
+	std::vector<CompactMortonCode<D, Word>> sortedCodes;
+	sortedCodes.reserve(sorted.size());
+	for(const std::pair<Word, size_t>& code : sorted)
+		sortedCodes.push_back(CompactMortonCode<D, Word>::fromCode(code.first));
+
+	std::vector<NodeState> sortedStates(sorted.size());
+	answer(sortedCodes.cbegin(), sortedCodes.cend(), sortedStates.data());
+
+	for(size_t i = 0; i < sorted.size(); ++i)
+		states[sorted[i].second] = sortedStates[i];
+}
+
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::checkBoxDepth() const
+{
+	if(m_depth - 1 > CompactMortonCode<D>::kLevelCount)
+		throw std::invalid_argument("BinNTree : the tree is too deep for a MortonBox");
+}
+
+template<uint D, class BitArray>
+template<class Visitor>
+void BinNTree<D, BitArray>::visitFilledLeaves(const MortonBox<D>& box, Visitor&& visitor) const
+{
+	checkBoxDepth();
+
+	NodeIndex index;
+	visitBoxNodes(index, 0, m_depth - 1, false, box, visitor);
+}
+
+template<uint D, class BitArray>
+template<class Visitor>
+void BinNTree<D, BitArray>::visitBoxNodes(NodeIndex& index, uint64_t prefix, uint level, bool isInside, const MortonBox<D>& box, Visitor& visitor) const
+{
+	using Overlap = typename MortonBox<D>::Overlap;
+
+	if(!isInside)
+	{
+		const Overlap overlap = box.overlap(prefix, level);
+		if(overlap == Overlap::Outside)
+		{
+			index = skipSubtrees(index, 1);
+			return;
+		}
+		isInside = overlap == Overlap::Inside;
+	}
+
+	const NodeState state = getNodeState(index);
+	++index;
+
+	if(state == NodeState::LeafFilled)
+		visitor(CompactMortonCode<D>::fromCode(prefix), m_depth - level);
+	if(state != NodeState::CompositeEmpty)
+		return;
+
+	--level;
+	for(uint childPos = 0; childPos < BinNTree<D, BitArray>::kChildrenCount; ++childPos)
+		visitBoxNodes(index, prefix | uint64_t{childPos} << (D * level), level, isInside, box, visitor);
+}
+
+template<uint D, class BitArray>
+bool BinNTree<D, BitArray>::anyFilled(const MortonBox<D>& box) const
+{
+	checkBoxDepth();
+
+	NodeIndex index;
+	return anyFilledNodes(index, 0, m_depth - 1, box);
+}
+
+template<uint D, class BitArray>
+bool BinNTree<D, BitArray>::anyFilledNodes(NodeIndex& index, uint64_t prefix, uint level, const MortonBox<D>& box) const
+{
+	using Overlap = typename MortonBox<D>::Overlap;
+
+	const Overlap	overlap = box.overlap(prefix, level);
+	const NodeState state	= getNodeState(index);
+	if(overlap == Overlap::Outside)
+	{
+		index = skipSubtrees(index, 1);
+		return false;
+	}
+
+	if(state != NodeState::CompositeEmpty)
+	{
+		++index;
+		return state == NodeState::LeafFilled;
+	}
+	if(overlap == Overlap::Inside && !m_hasPendingCollapse)
+		return true;
+
+	++index;
+	--level;
+	for(uint childPos = 0; childPos < BinNTree<D, BitArray>::kChildrenCount; ++childPos)
+		if(anyFilledNodes(index, prefix | uint64_t{childPos} << (D * level), level, box))
+			return true;
+	return false;
+}
+
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::checkVolumeDepth() const
+{
+	if(D * (m_depth - 1) >= 64)
+		throw std::invalid_argument("BinNTree : the volume of the tree does not fit in 64 bits");
+}
+
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::setVolumeSummaryEnabled(bool enabled)
+{
+	if(enabled)
+		checkVolumeDepth();
+
+	m_volumeSummaryEnabled = enabled;
+	m_volumeBlocks.clear();
+	m_volumeBlocks.shrink_to_fit();
+	m_volumeBlockNodeCounts.assign({});
+	if(enabled)
+		refreshVolumeSummary();
+}
+
+template<uint D, class BitArray>
+inline size_t BinNTree<D, BitArray>::findVolumeBlock(size_t position, size_t& offset) const
+{
+	offset = position;
+	return m_volumeBlockNodeCounts.find(offset);
+}
+
+template<uint D, class BitArray>
+inline size_t BinNTree<D, BitArray>::findVolumeEntry(size_t position, size_t& block) const
+{
+	size_t offset;
+	block = findVolumeBlock(position, offset);
+
+	const std::vector<VolumeEntry>& entries = m_volumeBlocks[block];
+	const auto entry = std::lower_bound(entries.begin(), entries.end(), offset, [](const VolumeEntry& e, size_t o) { return e.offset < o; });
+	return entry != entries.end() && entry->offset == offset ? static_cast<size_t>(entry - entries.begin()) : entries.size();
+}
+
+template<uint D, class BitArray>
+template<class Update>
+inline void BinNTree<D, BitArray>::updatePathEntries(const PathStack& path, size_t position, Update&& update)
+{
+	// The positions of the path increase
+	for(size_t i = 0; i < path.size() && path[i].toNodePosition() < position; ++i)
+	{
+		size_t		 block;
+		const size_t entry = findVolumeEntry(path[i].toNodePosition(), block);
+		if(entry != m_volumeBlocks[block].size())
+			update(m_volumeBlocks[block][entry]);
+	}
+}
+
+template<uint D, class BitArray>
+void BinNTree<D, BitArray>::updateFilledVolume(uint64_t previousVolume, uint64_t volume, const PathStack& path)
+{
+	if(!m_volumeSummaryEnabled)
+		return;
+
+	// Unsigned arithmetic, the difference wraps back
+	const uint64_t difference = volume - previousVolume;
+	m_filledVolume += difference;
+
+	updatePathEntries(path, std::numeric_limits<size_t>::max(), [difference](VolumeEntry& entry) { entry.volume += difference; });
+}
+
+template<uint D, class BitArray>
+void BinNTree<D, BitArray>::insertVolumeNodes(size_t position, size_t count, const PathStack& path)
+{
+	if(!m_volumeSummaryEnabled)
+		return;
+
+	// The subtrees holding the node before the new ones grow
+	updatePathEntries(path, position, [count](VolumeEntry& entry) { entry.nodeCount += count; });
+
+	// The new nodes join the block of the node before them, where the following entries move
+	size_t		 offset;
+	const size_t block = findVolumeBlock(position - 1, offset);
+
+	std::vector<VolumeEntry>& entries = m_volumeBlocks[block];
+	for(auto entry = std::upper_bound(entries.begin(), entries.end(), offset, [](size_t o, const VolumeEntry& e) { return o < e.offset; });
+		entry != entries.end(); ++entry)
+		entry->offset += count;
+
+	m_volumeBlockNodeCounts.add(block, count);
+	m_unsummarizedNodeCount += count;
+}
+
+template<uint D, class BitArray>
+void BinNTree<D, BitArray>::removeVolumeNodes(size_t parentPosition, size_t count, const PathStack& path)
+{
+	if(!m_volumeSummaryEnabled)
+		return;
+
+	// The subtrees holding the parent shrink, and the parent has no entry anymore
+	updatePathEntries(path, parentPosition, [count](VolumeEntry& entry) { entry.nodeCount -= count; });
+
+	size_t		 parentBlock;
+	const size_t parentEntry = findVolumeEntry(parentPosition, parentBlock);
+	if(parentEntry != m_volumeBlocks[parentBlock].size())
+		m_volumeBlocks[parentBlock].erase(m_volumeBlocks[parentBlock].begin() + parentEntry);
+
+	// The children may span several blocks : their entries are removed, and the following ones of the last block move
+	const auto compare = [](const VolumeEntry& e, size_t o) { return e.offset < o; };
+
+	size_t offset;
+	for(size_t block = findVolumeBlock(parentPosition + 1, offset), left = count; left != 0; ++block, offset = 0)
+	{
+		const size_t removed = std::min(left, m_volumeBlockNodeCounts.at(block) - offset);
+
+		std::vector<VolumeEntry>& entries = m_volumeBlocks[block];
+		const auto				  first	  = std::lower_bound(entries.begin(), entries.end(), offset, compare);
+		const auto				  last	  = std::lower_bound(first, entries.end(), offset + removed, compare);
+		for(auto entry = last; entry != entries.end(); ++entry)
+			entry->offset -= removed;
+		entries.erase(first, last);
+
+		// Unsigned arithmetic, the difference wraps back
+		m_volumeBlockNodeCounts.add(block, 0 - removed);
+		left -= removed;
+	}
+}
+
+template<uint D, class BitArray>
+uint64_t BinNTree<D, BitArray>::subtreeVolume(NodeIndex& index, uint level) const
+{
+	const NodeState state = getNodeState(index);
+	++index;
+
+	if(state == NodeState::LeafFilled)
+		return cellVolume(level);
+	if(state != NodeState::CompositeEmpty)
+		return 0;
+
+	// Children which are all leaves are counted at once
+	const size_t childPosition = index.toNodePosition();
+	if(ExcessScanner::countNodesIn(m_bitArray, childPosition, BinNTree<D, BitArray>::kChildrenCount, static_cast<byte>(NodeState::CompositeEmpty)) == 0)
+	{
+		index = NodeIndex((childPosition + BinNTree<D, BitArray>::kChildrenCount) * kNodeSize);
+		return ExcessScanner::countNodesIn(m_bitArray, childPosition, BinNTree<D, BitArray>::kChildrenCount, static_cast<byte>(NodeState::LeafFilled)) *
+			   cellVolume(level - 1);
+	}
+
+	uint64_t volume = 0;
+	for(uint childPos = 0; childPos < BinNTree<D, BitArray>::kChildrenCount; ++childPos)
+		volume += subtreeVolume(index, level - 1);
+	return volume;
+}
+
+template<uint D, class BitArray>
+uint64_t BinNTree<D, BitArray>::summarizedVolume(NodeIndex index, uint level) const
+{
+	size_t		 block;
+	const size_t entry = findVolumeEntry(index.toNodePosition(), block);
+	if(entry != m_volumeBlocks[block].size())
+		return m_volumeBlocks[block][entry].volume;
+	return subtreeVolume(index, level);
+}
+
+template<uint D, class BitArray>
+void BinNTree<D, BitArray>::refreshVolumeSummary()
+{
+	struct OpenNode
+	{
+		size_t	 position;
+		uint64_t volume;
+		uint	 childCount;
+	};
+
+	// The entries hold their position until they are cut into blocks
+	std::vector<VolumeEntry> entries;
+
+	// The volume of a node is added to its parent once its last child is read
+	internal::InlineStack<OpenNode, kMaxDepth> openNodes;
+	uint64_t								   volume = 0;
+	for(NodeIndex index; index.toNodePosition() < m_nodeCount; ++index)
+	{
+		const NodeState state = getNodeState(index);
+		if(state == NodeState::CompositeEmpty)
+		{
+			openNodes.push_back({index.toNodePosition(), 0, BinNTree<D, BitArray>::kChildrenCount});
+			continue;
+		}
+
+		volume = state == NodeState::LeafFilled ? cellVolume(m_depth - 1 - static_cast<uint>(openNodes.size())) : 0;
+		while(!openNodes.empty())
+		{
+			OpenNode& parent = openNodes.back();
+			parent.volume += volume;
+			if(--parent.childCount != 0)
+				break;
+
+			const size_t nodeCount = index.toNodePosition() + 1 - parent.position;
+			if(nodeCount >= kMinSummarizedNodeCount)
+				entries.push_back({parent.position, nodeCount, parent.volume});
+
+			volume = parent.volume;
+			openNodes.pop_back();
+		}
+	}
+
+	// The subtrees are closed in postorder
+	std::sort(entries.begin(), entries.end(), [](const VolumeEntry& a, const VolumeEntry& b) { return a.offset < b.offset; });
+
+	const size_t		blockCount = m_nodeCount / kVolumeBlockNodeCount + 1;
+	std::vector<size_t> nodeCounts(blockCount, kVolumeBlockNodeCount);
+	nodeCounts.back() = m_nodeCount % kVolumeBlockNodeCount;
+
+	m_volumeBlocks.assign(blockCount, {});
+	for(const VolumeEntry& entry : entries)
+		m_volumeBlocks[entry.offset / kVolumeBlockNodeCount].push_back({entry.offset % kVolumeBlockNodeCount, entry.nodeCount, entry.volume});
+	m_volumeBlockNodeCounts.assign(std::move(nodeCounts));
+
+	m_filledVolume			= volume;
+	m_unsummarizedNodeCount = 0;
+}
+
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::refreshGrownVolumeSummary()
+{
+	if(m_volumeSummaryEnabled && 2 * m_unsummarizedNodeCount > m_nodeCount)
+		refreshVolumeSummary();
+}
+
+template<uint D, class BitArray>
+uint64_t BinNTree<D, BitArray>::filledVolume() const
+{
+	checkVolumeDepth();
+
+	if(!m_volumeSummaryEnabled)
+	{
+		NodeIndex index;
+		return subtreeVolume(index, m_depth - 1);
+	}
+	return m_filledVolume;
 }
 
-template<uint D>
-inline BinNTree<D>::BinNTree(uint maxDepth, uint initNodeNumber) :
-	m_bitArray(initNodeNumber ?
-				initNodeNumber * kNodeSizeInBits :
-				kDefaultNodeCount * kNodeSizeInBits),
-	m_depth(maxDepth),
-	m_nodeCount(initNodeNumber ? initNodeNumber : kDefaultNodeCount)
+template<uint D, class BitArray>
+uint64_t BinNTree<D, BitArray>::countFilled(const MortonBox<D>& box) const
 {
+	checkBoxDepth();
+	checkVolumeDepth();
+
+	const std::array<uint32_t, D> min = CompactMortonCode<D>::fromCode(box.getMinCode()).toPoint();
+	const std::array<uint32_t, D> max = CompactMortonCode<D>::fromCode(box.getMaxCode()).toPoint();
+
+	NodeIndex index;
+	return countFilledNodes(index, 0, m_depth - 1, false, box, min, max);
 }
 
-template<uint D>
-inline typename BinNTree<D>::NodeIndex BinNTree<D>::getChildIndex(NodeIndex index, uint childPos) const
+template<uint D, class BitArray>
+uint64_t BinNTree<D, BitArray>::countFilledNodes(NodeIndex& index, uint64_t prefix, uint level, bool isInside, const MortonBox<D>& box,
+												 const std::array<uint32_t, D>& min, const std::array<uint32_t, D>& max) const
 {
-	NodeIndex& childIndex = ++index;
+	using Overlap = typename MortonBox<D>::Overlap;
 
-	while(childPos)
+	if(!isInside)
 	{
-		if(getNodeState(childIndex) == NodeState::CompositeEmpty)
-			// Prepare to skip the children of the composite node
-			childPos += BinNTree<D>::kChildrenCount;
-
-		// Skip the current node
-		--childPos;
-		++childIndex;
+		const Overlap overlap = box.overlap(prefix, level);
+		if(overlap == Overlap::Outside)
+		{
+			index = skipSubtrees(index, 1);
+			return 0;
+		}
+		isInside = overlap == Overlap::Inside;
 	}
-	return childIndex;
-}
 
-template<uint D>
-inline typename BinNTree<D>::NodeIndex BinNTree<D>::getParentEndIndex(NodeIndex index) const
-{
-	NodeIndex endIndex = ++index;
+	const NodeState state = getNodeState(index);
+	if(state == NodeState::CompositeEmpty && isInside)
+	{
+		if(!m_volumeSummaryEnabled)
+			return subtreeVolume(index, level);
+
+		size_t		 block;
+		const size_t position = index.toNodePosition();
+		const size_t entry	  = findVolumeEntry(position, block);
+		if(entry == m_volumeBlocks[block].size())
+			return subtreeVolume(index, level);
+
+		index = NodeIndex((position + m_volumeBlocks[block][entry].nodeCount) * kNodeSize);
+		return m_volumeBlocks[block][entry].volume;
+	}
 
-	uint remainingNode = BinNTree<D>::kChildrenCount;
-	while(remainingNode)
+	++index;
+	if(state == NodeState::LeafFilled)
 	{
-		if(getNodeState(endIndex) == NodeState::CompositeEmpty)
-			// Prepare to skip the children of the composite node
-			remainingNode += BinNTree<D>::kChildrenCount;
+		if(isInside)
+			return cellVolume(level);
+
+		// The part of the leaf in the box
+		const std::array<uint32_t, D> corner = CompactMortonCode<D>::fromCode(prefix).toPoint();
+		const uint64_t				  side	 = uint64_t{1} << level;
 
-		// Skip the current node
-		--remainingNode;
-		++endIndex;
+		uint64_t volume = 1;
+		for(uint axis = 0; axis < D; ++axis)
+		{
+			const uint64_t first = std::max<uint64_t>(corner[axis], min[axis]);
+			const uint64_t last	 = std::min<uint64_t>(corner[axis] + side - 1, max[axis]);
+			volume *= last - first + 1;
+		}
+		return volume;
 	}
-	return endIndex;
+	if(state != NodeState::CompositeEmpty)
+		return 0;
+
+	uint64_t volume = 0;
+	--level;
+	for(uint childPos = 0; childPos < BinNTree<D, BitArray>::kChildrenCount; ++childPos)
+		volume += countFilledNodes(index, prefix | uint64_t{childPos} << (D * level), level, isInside, box, min, max);
+	return volume;
 }
 
-template<uint D>
-inline void BinNTree<D>::addChildren(NodeIndex index, NodeState child)
+template<uint D, class BitArray>
+bool BinNTree<D, BitArray>::castRay(const std::array<double, D>& origin, const std::array<double, D>& direction, double maxDistance, RayHit<D>& hit) const
 {
-	m_bitArray.insert(index.toBitIndex(), BinNTree<D>::kChildrenCount * kNodeSizeInBits);
+	checkBoxDepth();
+
+	double norm = 0;
+	for(uint axis = 0; axis < D; ++axis)
+		norm += direction[axis] * direction[axis];
+	norm = std::sqrt(norm);
+	if(norm == 0)
+		throw std::invalid_argument("BinNTree : the direction of a ray must not be null");
+
+	RayTraversal ray;
+	ray.origin = origin;
+
+	// Clip the ray to the root, one slab per axis
+	const double side	= static_cast<double>(uint64_t{1} << (m_depth - 1));
+	double		 tEnter = 0;
+	double		 tExit	= maxDistance;
+	for(uint axis = 0; axis < D; ++axis)
+	{
+		ray.direction[axis] = direction[axis] / norm;
+		if(ray.direction[axis] == 0)
+		{
+			ray.inverseDirection[axis] = std::numeric_limits<double>::infinity();
+			if(origin[axis] < 0 || origin[axis] >= side)
+				return false;
+			continue;
+		}
 
-	for(uint i = 0; i < D; i++)
-		setNodeState(index++, child);
+		ray.inverseDirection[axis] = 1 / ray.direction[axis];
+
+		double t0 = -origin[axis] * ray.inverseDirection[axis];
+		double t1 = (side - origin[axis]) * ray.inverseDirection[axis];
+		if(t0 > t1)
+			std::swap(t0, t1);
+		tEnter = std::max(tEnter, t0);
+		tExit  = std::min(tExit, t1);
+	}
+	if(!(tEnter < tExit))
+		return false;
 
-	m_nodeCount += BinNTree<D>::kChildrenCount;
+	return castRayNodes(NodeIndex(), 0, std::array<double, D>{}, m_depth - 1, tEnter, tExit, ray, hit);
 }
 
-template<uint D>
-inline void BinNTree<D>::removeChildren(NodeIndex index)
+template<uint D, class BitArray>
+bool BinNTree<D, BitArray>::castRayNodes(NodeIndex index, uint64_t prefix, const std::array<double, D>& corner, uint level, double tEnter, double tExit,
+										 const RayTraversal& ray, RayHit<D>& hit) const
 {
-	const NodeIndex nodeEndIndex = getParentEndIndex(index);
+	const NodeState state = getNodeState(index);
+	if(state == NodeState::LeafFilled)
+	{
+		hit = {prefix, m_depth - level, tEnter};
+		return true;
+	}
+	// An Empty leaf is crossed at once
+	if(state != NodeState::CompositeEmpty)
+		return false;
 
-	const size_t numberBitsToRemove = nodeEndIndex.toBitIndex() - index.toBitIndex() - 2;
+	--level;
+	const double half = static_cast<double>(uint64_t{1} << level);
 
-	m_bitArray.remove(index.toBitIndex(), numberBitsToRemove);
-	m_nodeCount -= numberBitsToRemove / kNodeSizeInBits;
-}
+	// Distance to the middle plane of each axis, and first child crossed
+	std::array<double, D> tMiddle;
+	uint				  childPos = 0;
+	for(uint axis = 0; axis < D; ++axis)
+	{
+		const double middle = corner[axis] + half;
 
-template<uint D>
-inline bool BinNTree<D>::optimizeNode(NodeIndex parentIndex)
-{
-	++parentIndex;
-	NodeIndex&		childIndex		= parentIndex;
-	const NodeIndex firstChildIndex = parentIndex;
+		bool isUpper;
+		if(ray.direction[axis] == 0)
+		{
+			tMiddle[axis] = std::numeric_limits<double>::infinity();
+			isUpper		  = ray.origin[axis] >= middle;
+		}
+		else
+		{
+			tMiddle[axis] = (middle - ray.origin[axis]) * ray.inverseDirection[axis];
+			isUpper		  = (tMiddle[axis] <= tEnter) != (ray.direction[axis] < 0);
+		}
+		childPos |= uint{isUpper} << (D - 1 - axis);
+	}
 
-	const NodeState firstChild = getNodeState(childIndex);
-	if(firstChild == NodeState::CompositeEmpty)
-		return false;
+	// The children are found in the stream on demand, as the ray may cross only the first ones
+	std::array<NodeIndex, BinNTree<D, BitArray>::kChildrenCount> children;
+	children[0] = index;
+	++children[0];
+	uint knownChildren = 1;
 
-	for(uint i = 1; i < BinNTree<D>::kChildrenCount; ++i)
+	double t = tEnter;
+	while(true)
 	{
-		++childIndex;
-		if(firstChild != getNodeState(childIndex))
+		// The ray leaves the child at the next middle plane, or at the end of the node
+		double tNext = tExit;
+		for(uint axis = 0; axis < D; ++axis)
+			if(tMiddle[axis] > t && tMiddle[axis] < tNext)
+				tNext = tMiddle[axis];
+
+		if(t < tNext)
+		{
+			for(; knownChildren <= childPos; ++knownChildren)
+				children[knownChildren] = skipSubtrees(children[knownChildren - 1], 1);
+
+			std::array<double, D> childCorner = corner;
+			for(uint axis = 0; axis < D; ++axis)
+				if(childPos >> (D - 1 - axis) & 1)
+					childCorner[axis] += half;
+
+			if(castRayNodes(children[childPos], prefix | uint64_t{childPos} << (D * level), childCorner, level, t, tNext, ray, hit))
+				return true;
+		}
+		if(tNext >= tExit)
 			return false;
+
+		for(uint axis = 0; axis < D; ++axis)
+			if(tMiddle[axis] == tNext)
+				childPos ^= 1U << (D - 1 - axis);
+		t = tNext;
 	}
+}
 
-	removeChildren(firstChildIndex);
-	setNodeState(parentIndex, firstChild);
+template<uint D, class BitArray>
+bool BinNTree<D, BitArray>::lineOfSight(const std::array<double, D>& a, const std::array<double, D>& b) const
+{
+	std::array<double, D> direction;
+	double				  distance = 0;
+	for(uint axis = 0; axis < D; ++axis)
+	{
+		direction[axis] = b[axis] - a[axis];
+		distance += direction[axis] * direction[axis];
+	}
+	if(distance == 0)
+		return true;
 
-	return true;
+	RayHit<D> hit;
+	return !castRay(a, direction, std::sqrt(distance), hit);
 }
 
-template<uint D>
-NodeState BinNTree<D>::getNodeState(const MortonCode<D>& mortonCode, uint nodeDepth) const
+template<uint D, class BitArray>
+void BinNTree<D, BitArray>::castRays(const Ray<D> rays[], size_t count, RayHit<D> hits[]) const
 {
-	uint	  level		= m_depth - 1;
-	uint	  nodeLevel = m_depth - nodeDepth;
-	NodeIndex index;
+	for(size_t i = 0; i < count; ++i)
+		if(!castRay(rays[i].origin, rays[i].direction, rays[i].maxDistance, hits[i]))
+			hits[i] = {0, 0, rays[i].maxDistance};
+}
 
-	// Road to the node
-	while(level > nodeLevel)
+template<uint D, class BitArray>
+void BinNTree<D, BitArray>::castRays(const Ray<D> rays[], size_t count, RayHit<D> hits[], ThreadPool& pool) const
+{
+	const uint taskCount = static_cast<uint>(std::clamp<size_t>(count / kMinQueriesPerTask, 1, pool.getThreadCount()));
+	if(taskCount == 1)
 	{
-		// Check the current node state
-		switch(getNodeState(index))
-		{
-		case NodeState::LeafEmpty:
-			return NodeState::LeafEmpty;
-		case NodeState::LeafFilled:
-			return NodeState::LeafFilled;
-		case NodeState::CompositeEmpty:
-			index = getChildIndex(index, mortonCode.decode(--level));
-			break;
-		case NodeState::CompositeFilled:
-			// TODO throw custom exception
-			throw std::logic_error("BitOctree::getNodeState : Error while reading nodes");
-		}
+		castRays(rays, count, hits);
+		return;
 	}
 
-	switch(getNodeState(index))
-	{
-	case NodeState::LeafEmpty:
-		return NodeState::LeafEmpty;
-	case NodeState::LeafFilled:
-		return NodeState::LeafFilled;
-	case NodeState::CompositeEmpty:
-		return NodeState::CompositeEmpty;
-	case NodeState::CompositeFilled:
-		// TODO throw custom exception
-		throw std::logic_error("BitOctree::getNodeState : Error while reading nodes");
-	};
+	pool.run(taskCount, [&](uint task) {
+		const size_t rangeFirst = count * task / taskCount;
+		const size_t rangeLast	= count * (task + 1) / taskCount;
+
+		castRays(rays + rangeFirst, rangeLast - rangeFirst, hits + rangeFirst);
+	});
 }
 
-template<uint D>
-void BinNTree<D>::setNode(const MortonCode<D>& mortonCode, uint nodeDepth)
+template<uint D, class BitArray>
+template<class Code, class>
+void BinNTree<D, BitArray>::setNode(const Code& mortonCode, uint nodeDepth)
 {
+	refreshGrownVolumeSummary();
+
 	uint	  level		= m_depth - 1;
 	uint	  nodeLevel = m_depth - nodeDepth;
 	NodeIndex index;
 
-	std::vector<NodeIndex> nodeIndexStack;
-	nodeIndexStack.reserve(m_depth);
+	PathStack nodeIndexStack;
 	nodeIndexStack.push_back(index);
 
 	// Road to the node
@@ -306,22 +1642,34 @@ void BinNTree<D>::setNode(const MortonCode<D>& mortonCode, uint nodeDepth)
 	switch(getNodeState(index))
 	{
 	case NodeState::LeafEmpty:
+		updateFilledVolume(0, cellVolume(nodeLevel), nodeIndexStack);
 		setNodeState(index, NodeState::LeafFilled);
 		nodeIndexStack.pop_back();
 		break;
 	case NodeState::LeafFilled:
 		return;
 	case NodeState::CompositeEmpty:
-		removeChildren(index);
+		if(m_volumeSummaryEnabled)
+			updateFilledVolume(summarizedVolume(index, nodeLevel), cellVolume(nodeLevel), nodeIndexStack);
+		removeChildren(index, nodeIndexStack);
+		setNodeState(index, NodeState::LeafFilled);
+		nodeIndexStack.pop_back();
+		break;
 	case NodeState::CompositeFilled:
 		// TODO throw custom exception
 		throw std::logic_error("BitOctree::getNodeState : Error while reading nodes");
 	}
 
+	if(m_collapseDeferred)
+	{
+		m_hasPendingCollapse = true;
+		return;
+	}
+
 	// While optimization is possible
 	while(!nodeIndexStack.empty())
 	{
-		if(!optimizeNode(nodeIndexStack.back()))
+		if(!optimizeNode(nodeIndexStack.back(), nodeIndexStack))
 			return;
 		nodeIndexStack.pop_back();
 	}
@@ -337,23 +1685,26 @@ leaf_empty:
 		setNodeState(index, NodeState::CompositeEmpty);
 
 		// Add empty children to this node
-		addChildren(childrenIndex, NodeState::LeafEmpty);
+		addChildren(childrenIndex, NodeState::LeafEmpty, nodeIndexStack);
 
 		// Go to the target child of this node
 		index = getChildIndex(index, mortonCode.decode(--level));
 	}
 	setNodeState(index, NodeState::LeafFilled);
+	updateFilledVolume(0, cellVolume(nodeLevel), nodeIndexStack);
 }
 
-template<uint D>
-void BinNTree<D>::removeNode(const MortonCode<D>& mortonCode, uint nodeDepth)
+template<uint D, class BitArray>
+template<class Code, class>
+void BinNTree<D, BitArray>::removeNode(const Code& mortonCode, uint nodeDepth)
 {
+	refreshGrownVolumeSummary();
+
 	uint	  level		= m_depth - 1;
 	uint	  nodeLevel = m_depth - nodeDepth;
 	NodeIndex index;
 
-	std::vector<NodeIndex> nodeIndexStack;
-	nodeIndexStack.reserve(m_depth);
+	PathStack nodeIndexStack;
 	nodeIndexStack.push_back(index);
 
 	// Road to the node
@@ -361,7 +1712,6 @@ void BinNTree<D>::removeNode(const MortonCode<D>& mortonCode, uint nodeDepth)
 	while(level > nodeLevel)
 	{
 		// Check the current node state
-		uint childBitPos;
 		switch(getNodeState(index))
 		{
 		case NodeState::LeafEmpty:
@@ -384,20 +1734,32 @@ void BinNTree<D>::removeNode(const MortonCode<D>& mortonCode, uint nodeDepth)
 	case NodeState::LeafEmpty:
 		return;
 	case NodeState::LeafFilled:
+		updateFilledVolume(cellVolume(nodeLevel), 0, nodeIndexStack);
 		cleanNode(index);
 		nodeIndexStack.pop_back();
 		break;
 	case NodeState::CompositeEmpty:
-		removeChildren(index);
+		if(m_volumeSummaryEnabled)
+			updateFilledVolume(summarizedVolume(index, nodeLevel), 0, nodeIndexStack);
+		removeChildren(index, nodeIndexStack);
+		setNodeState(index, NodeState::LeafEmpty);
+		nodeIndexStack.pop_back();
+		break;
 	case NodeState::CompositeFilled:
 		// TODO throw custom exception
 		throw std::logic_error("BitOctree::getNodeState : Error while reading nodes");
 	}
 
+	if(m_collapseDeferred)
+	{
+		m_hasPendingCollapse = true;
+		return;
+	}
+
 	// While optimization possible
 	while(!nodeIndexStack.empty())
 	{
-		if(!optimizeNode(nodeIndexStack.back()))
+		if(!optimizeNode(nodeIndexStack.back(), nodeIndexStack))
 			break;
 		nodeIndexStack.pop_back();
 	}
@@ -411,75 +1773,399 @@ leaf_filled:
 		++index;
 
 		// Add filled children to this node
-		addChildren(index, NodeState::LeafFilled);
+		addChildren(index, NodeState::LeafFilled, nodeIndexStack);
 		--index;
 
 		// Go to the target child of this node
 		index = getChildIndex(index, mortonCode.decode(--level));
 	}
 	cleanNode(index);
+	updateFilledVolume(cellVolume(nodeLevel), 0, nodeIndexStack);
 }
 
-/*****************************
- * Node Index implementation *
- *****************************/
+template<uint D, class BitArray>
+template<class Iterator>
+void BinNTree<D, BitArray>::setNodes(Iterator first, Iterator last, uint nodeDepth)
+{
+	if(first == last)
+		return;
 
-template<uint D>
-inline BinNTree<D>::NodeIndex::NodeIndex() :
-	byteIndex(0),
-	bitShift(kFirstNodeShift)
+	m_scratch.resize(0);
+	m_scratch.reserve(m_bitArray.size());
+
+	NodeIndex index;
+	mergeNodes(index, false, first, last, m_depth - 1, m_depth - nodeDepth, m_scratch);
+
+	swapScratch();
+}
+
+template<uint D, class BitArray>
+void BinNTree<D, BitArray>::swapScratch()
 {
+	// The previous nodes become the next scratch buffer
+	if constexpr(std::is_same_v<BitArray, internal::BitVector>)
+		std::swap(m_bitArray, m_scratch);
+	else
+		m_bitArray = BitArray(std::exchange(m_scratch, internal::BitVector()));
+	m_nodeCount = m_bitArray.size() / kNodeSize;
+
+	if(m_subtreeIndexEnabled)
+		m_subtreeIndex.build(m_bitArray, m_nodeCount);
+
+	if(m_volumeSummaryEnabled)
+		refreshVolumeSummary();
 }
 
-template<uint D>
-inline BinNTree<D>::NodeIndex::NodeIndex(size_t bitIndex) :
-	byteIndex(bitIndex >> kNodeSizeInBits),
-	bitShift(kFirstNodeShift - (bitIndex & kByteMask))
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::setCollapseDeferred(bool deferred)
 {
+	m_collapseDeferred = deferred;
+	if(!deferred)
+		compact();
 }
 
-template<uint D>
-inline size_t BinNTree<D>::NodeIndex::toBitIndex() const
+template<uint D, class BitArray>
+void BinNTree<D, BitArray>::compact()
+{
+	if(!m_hasPendingCollapse)
+		return;
+
+	struct OpenNode
+	{
+		size_t position;
+		uint   childCount;
+	};
+
+	m_scratch.resize(0);
+	m_scratch.reserve(m_bitArray.size());
+
+	// Copy the nodes, merging the children of a node as soon as its last child is written
+	internal::InlineStack<OpenNode, kMaxDepth> openNodes;
+	for(NodeIndex index; index.toNodePosition() < m_nodeCount; ++index)
+	{
+		const NodeState state = getNodeState(index);
+		if(state == NodeState::CompositeFilled)
+			// TODO throw custom exception
+			throw std::logic_error("BitOctree::compact : Error while reading nodes");
+
+		const size_t position = m_scratch.size() / kNodeSize;
+		appendNode(m_scratch, state);
+
+		if(state == NodeState::CompositeEmpty)
+		{
+			openNodes.push_back({position, BinNTree<D, BitArray>::kChildrenCount});
+			continue;
+		}
+
+		// A leaf completes its parent, and maybe the ancestors whose last child it ends
+		while(!openNodes.empty() && --openNodes.back().childCount == 0)
+		{
+			mergeLastChildren(m_scratch, openNodes.back().position);
+			openNodes.pop_back();
+		}
+	}
+
+	swapScratch();
+	m_hasPendingCollapse = false;
+}
+
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::unite(const BinNTree& other)
 {
-	return (byteIndex << kNodeSizeInBits) + kFirstNodeShift - bitShift;
+	combine(other, kUnionTable);
 }
 
-template<uint D>
-inline typename BinNTree<D>::NodeIndex& BinNTree<D>::NodeIndex::operator++()
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::intersect(const BinNTree& other)
+{
+	combine(other, kIntersectionTable);
+}
+
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::subtract(const BinNTree& other)
+{
+	combine(other, kDifferenceTable);
+}
+
+template<uint D, class BitArray>
+inline void BinNTree<D, BitArray>::symmetricDifference(const BinNTree& other)
+{
+	combine(other, kSymmetricDifferenceTable);
+}
+
+template<uint D, class BitArray>
+void BinNTree<D, BitArray>::combine(const BinNTree& other, uint8_t truthTable)
+{
+	if(other.m_depth != m_depth)
+		throw std::invalid_argument("BinNTree : the trees have different depths");
+
+	m_scratch.resize(0);
+	m_scratch.reserve(std::max(m_bitArray.size(), other.m_bitArray.size()));
+
+	NodeIndex index;
+	NodeIndex otherIndex;
+	combineNodes(index, other, otherIndex, truthTable, m_scratch);
+
+	// The subtrees copied from the inputs keep their pending collapses
+	m_hasPendingCollapse = m_hasPendingCollapse || other.m_hasPendingCollapse;
+	swapScratch();
+}
+
+template<uint D, class BitArray>
+void BinNTree<D, BitArray>::combineNodes(NodeIndex& index, const BinNTree& other, NodeIndex& otherIndex, uint8_t truthTable, internal::BitVector& output) const
+{
+	const NodeState state	   = getNodeState(index);
+	const NodeState otherState = other.getNodeState(otherIndex);
+	if(state == NodeState::CompositeFilled || otherState == NodeState::CompositeFilled)
+		// TODO throw custom exception
+		throw std::logic_error("BitOctree::combine : Error while reading nodes");
+
+	const bool isLeaf	   = state != NodeState::CompositeEmpty;
+	const bool otherIsLeaf = otherState != NodeState::CompositeEmpty;
+
+	if(isLeaf && otherIsLeaf)
+	{
+		const uint cell = (state == NodeState::LeafFilled) << 1 | (otherState == NodeState::LeafFilled);
+		appendNode(output, (truthTable >> cell) & 1 ? NodeState::LeafFilled : NodeState::LeafEmpty);
+		++index;
+		++otherIndex;
+		return;
+	}
+
+	// A leaf facing a subtree, the leaf covers the whole subtree
+	if(isLeaf)
+	{
+		const uint row = (state == NodeState::LeafFilled) << 1;
+		appendCombinedSubtree(other, otherIndex, (truthTable >> row) & 1, (truthTable >> (row | 1)) & 1, output);
+		++index;
+		return;
+	}
+	if(otherIsLeaf)
+	{
+		const uint column = otherState == NodeState::LeafFilled;
+		appendCombinedSubtree(*this, index, (truthTable >> column) & 1, (truthTable >> (0b10 | column)) & 1, output);
+		++otherIndex;
+		return;
+	}
+
+	const size_t parentPosition = output.size() / kNodeSize;
+	appendNode(output, NodeState::CompositeEmpty);
+	++index;
+	++otherIndex;
+
+	for(uint childPos = 0; childPos < BinNTree<D, BitArray>::kChildrenCount; ++childPos)
+		combineNodes(index, other, otherIndex, truthTable, output);
+
+	mergeLastChildren(output, parentPosition);
+}
+
+template<uint D, class BitArray>
+void BinNTree<D, BitArray>::appendCombinedSubtree(const BinNTree& tree, NodeIndex& index, bool emptyResult, bool filledResult, internal::BitVector& output)
+{
+	if(emptyResult == filledResult)
+	{
+		appendNode(output, filledResult ? NodeState::LeafFilled : NodeState::LeafEmpty);
+		index = tree.skipSubtrees(index, 1);
+		return;
+	}
+
+	const size_t firstBitIndex = output.size();
+	appendSubtree(tree, index, output);
+	if(emptyResult)
+		complementLeaves(output, firstBitIndex);
+}
+
+template<uint D, class BitArray>
+void BinNTree<D, BitArray>::complementLeaves(internal::BitVector& bits, size_t firstBitIndex)
+{
+	byte* const	 data		= bits.data();
+	const size_t firstByte	= internal::bitutils::byteIndex(firstBitIndex);
+	const size_t byteCount	= internal::bitutils::byteCount(bits.size());
+	const ushort firstShift = internal::bitutils::bitIndexInsideByte(firstBitIndex);
+	const ushort endShift	= internal::bitutils::bitIndexInsideByte(bits.size());
+
+	// The right bit of a node flips when its left (Composite) bit is clear
+	for(size_t i = firstByte; i < byteCount; ++i)
+	{
+		byte flips = ~data[i] >> 1 & byte{0b01010101};
+		if(i == firstByte)
+			flips &= internal::kByteMask >> firstShift;
+		if(i + 1 == byteCount && endShift != 0)
+			flips &= internal::bitutils::maskFirstBits(endShift);
+
+		data[i] ^= flips;
+	}
+}
+
+/*************************
+ * Cursor implementation *
+ *************************/
+
+template<uint D, class BitArray>
+inline BinNTree<D, BitArray>::Cursor::Cursor(const BinNTree& tree) :
+	m_tree(&tree)
+{
+	m_path.reserve(tree.m_depth);
+	m_path.push_back({NodeIndex(), NodeIndex(), 0, false});
+}
+
+template<uint D, class BitArray>
+inline typename BinNTree<D, BitArray>::Cursor::Point BinNTree<D, BitArray>::Cursor::getCorner() const
+{
+	using Coordinate = typename Point::value_type;
+
+	if(m_tree->m_depth - 1 > 8 * sizeof(Coordinate))
+		throw std::invalid_argument("BinNTree::Cursor : the tree is too deep for the coordinates of a Point");
+
+	Point corner{};
+	for(size_t depth = 1; depth < m_path.size(); ++depth)
+	{
+		const uint level = m_tree->m_depth - 1 - static_cast<uint>(depth);
+		for(uint axis = 0; axis < D; ++axis)
+			corner[axis] |= static_cast<Coordinate>((m_path[depth].childPos >> (D - 1 - axis)) & 1) << level;
+	}
+	return corner;
+}
+
+template<uint D, class BitArray>
+inline bool BinNTree<D, BitArray>::Cursor::findEnd(const PathNode& node, NodeIndex& end) const
+{
+	if(node.hasEnd)
+	{
+		end = node.end;
+		return true;
+	}
+	if(m_tree->getNodeState(node.index) != NodeState::CompositeEmpty)
+	{
+		end = node.index;
+		++end;
+		return true;
+	}
+	return false;
+}
+
+template<uint D, class BitArray>
+inline typename BinNTree<D, BitArray>::NodeIndex BinNTree<D, BitArray>::Cursor::getEnd(const PathNode& node) const
 {
-	if(bitShift == kFourthNodeShift)
+	NodeIndex end;
+	if(!findEnd(node, end))
+		end = m_tree->skipSubtrees(node.index, 1);
+	return end;
+}
+
+template<uint D, class BitArray>
+template<class Code, class>
+NodeState BinNTree<D, BitArray>::Cursor::seek(const Code& mortonCode, uint nodeDepth)
+{
+	const uint treeDepth = m_tree->m_depth;
+
+	// Climb to the common ancestor
+	size_t depth = 1;
+	while(depth < m_path.size() && depth < nodeDepth && m_path[depth].childPos == mortonCode.decode(treeDepth - 1 - depth))
+		++depth;
+
+	if(depth < m_path.size() && depth < nodeDepth)
 	{
-		byteIndex++;
-		bitShift = kFirstNodeShift;
+		// Move to the target child from the previous one when it comes after it
+		const PathNode& previous = m_path[depth];
+		const uint		childPos = mortonCode.decode(treeDepth - 1 - depth);
+
+		NodeIndex index;
+		if(childPos < previous.childPos)
+			index = m_tree->getChildIndex(m_path[depth - 1].index, childPos);
+		else if(childPos == previous.childPos + 1)
+			index = getEnd(previous);
+		else
+			index = m_tree->skipSubtrees(previous.index, childPos - previous.childPos);
+
+		m_path.resize(depth);
+		m_path.push_back({index, NodeIndex(), childPos, false});
 	}
 	else
-		bitShift -= kNodeSizeInBits;
+		m_path.resize(depth);
+
+	// Road to the node
+	while(true)
+	{
+		const NodeState state = getState();
+		if(state == NodeState::CompositeFilled)
+			// TODO throw custom exception
+			throw std::logic_error("BitOctree::Cursor::seek : Error while reading nodes");
+
+		if(m_path.size() >= nodeDepth || state != NodeState::CompositeEmpty)
+			return state;
+
+		const uint childPos = mortonCode.decode(treeDepth - 1 - static_cast<uint>(m_path.size()));
+		m_path.push_back({m_tree->getChildIndex(m_path.back().index, childPos), NodeIndex(), childPos, false});
+	}
+}
+
+template<uint D, class BitArray>
+inline bool BinNTree<D, BitArray>::Cursor::firstChild()
+{
+	if(getState() != NodeState::CompositeEmpty)
+		return false;
+
+	NodeIndex index = m_path.back().index;
+	m_path.push_back({++index, NodeIndex(), 0, false});
+	return true;
+}
+
+template<uint D, class BitArray>
+inline bool BinNTree<D, BitArray>::Cursor::nextSibling()
+{
+	PathNode& node = m_path.back();
+	if(m_path.size() == 1 || node.childPos == BinNTree<D, BitArray>::kChildrenCount - 1)
+		return false;
+
+	node = {getEnd(node), NodeIndex(), node.childPos + 1, false};
+	return true;
+}
+
+template<uint D, class BitArray>
+inline bool BinNTree<D, BitArray>::Cursor::parent()
+{
+	if(m_path.size() == 1)
+		return false;
+
+	// The end of the last child is the end of its parent
+	const PathNode node	  = m_path.back();
+	PathNode&	   parent = m_path[m_path.size() - 2];
+	if(node.childPos == BinNTree<D, BitArray>::kChildrenCount - 1)
+		parent.hasEnd = findEnd(node, parent.end);
+
+	m_path.pop_back();
+	return true;
+}
+
+/*****************************
+ * Node Index implementation *
+ *****************************/
+
+template<uint D, class BitArray>
+inline typename BinNTree<D, BitArray>::NodeIndex& BinNTree<D, BitArray>::NodeIndex::operator++()
+{
+	m_bitIndex += kNodeSize;
 	return *this;
 }
 
-template<uint D>
-inline typename BinNTree<D>::NodeIndex BinNTree<D>::NodeIndex::operator++(int)
+template<uint D, class BitArray>
+inline typename BinNTree<D, BitArray>::NodeIndex BinNTree<D, BitArray>::NodeIndex::operator++(int)
 {
 	const NodeIndex result = *this;
 	++(*this);
 	return result;
 }
 
-template<uint D>
-inline typename BinNTree<D>::NodeIndex& BinNTree<D>::NodeIndex::operator--()
+template<uint D, class BitArray>
+inline typename BinNTree<D, BitArray>::NodeIndex& BinNTree<D, BitArray>::NodeIndex::operator--()
 {
-	if(bitShift == kFirstNodeShift)
-	{
-		byteIndex--;
-		bitShift = kFourthNodeShift;
-	}
-	else
-		bitShift += kNodeSizeInBits;
+	m_bitIndex -= kNodeSize;
 	return *this;
 }
 
-template<uint D>
-inline typename BinNTree<D>::NodeIndex BinNTree<D>::NodeIndex::operator--(int)
+template<uint D, class BitArray>
+inline typename BinNTree<D, BitArray>::NodeIndex BinNTree<D, BitArray>::NodeIndex::operator--(int)
 {
 	const NodeIndex result = *this;
 	--(*this);
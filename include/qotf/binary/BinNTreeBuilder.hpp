@@ -0,0 +1,186 @@
+#pragma once
+
+#include <qotf/binary/BinNTree.hpp>
+#include <qotf/internal/BitVector.hpp>
+#include <qotf/morton/MortonCode.hpp>
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace qotf
+{
+
+/**
+ * Build a BinNTree from a stream of filled leaves sorted in Morton order
+ *
+ * The preorder stream of the tree is written directly, in a single pass :
+ * the builder only keeps the path from the root to the last added leaf,
+ * and uniform children are merged into their parent as soon as it is complete.
+ */
+template<uint D>
+class BinNTreeBuilder
+{
+	using Tree = BinNTree<D>;
+
+	static constexpr uint kChildrenCount = powerOfTwo(D);
+
+	struct OpenNode
+	{
+		size_t position;
+		uint   childCount;
+	};
+
+public:
+	explicit BinNTreeBuilder(uint maxDepth);
+
+	/**
+	 * Fill the deepest node of [mortonCode]
+	 * Adding the same code again does nothing
+	 * Requires :
+	 *   - the codes are added in Morton order
+	 */
+	template<class Code, class = EnableIfMortonCode<Code, D>>
+	void add(const Code& mortonCode);
+
+	/**
+	 * Return the tree of all the added codes
+	 * The builder is then ready for a new tree
+	 */
+	template<class BitArray = internal::BitVector>
+	BinNTree<D, BitArray> build();
+
+private:
+	internal::BitVector	  m_bitArray;
+	std::vector<OpenNode> m_path;
+
+	uint m_depth;
+	bool m_isEmpty;
+
+	uint getChildLevel(size_t pathIndex) const { return m_depth - 2 - pathIndex; }
+
+	/**
+	 * Add [count] Empty leaves to the open node at the end of the path
+	 */
+	void addEmptyChildren(uint count);
+
+	/**
+	 * Complete the open node at the end of the path with Empty leaves,
+	 * merge its children if they are all the same leaf, and remove it from the path
+	 */
+	void closeNode();
+};
+
+/**********************************
+ * BinNTreeBuilder implementation *
+ **********************************/
+
+template<uint D>
+inline BinNTreeBuilder<D>::BinNTreeBuilder(uint maxDepth) :
+	m_depth(maxDepth),
+	m_isEmpty(true)
+{
+	m_path.reserve(m_depth);
+}
+
+template<uint D>
+inline void BinNTreeBuilder<D>::addEmptyChildren(uint count)
+{
+	for(uint i = 0; i < count; ++i)
+		Tree::appendNode(m_bitArray, NodeState::LeafEmpty);
+	m_path.back().childCount += count;
+}
+
+template<uint D>
+inline void BinNTreeBuilder<D>::closeNode()
+{
+	const OpenNode node = m_path.back();
+	addEmptyChildren(kChildrenCount - node.childCount);
+	m_path.pop_back();
+
+	// If the children are exactly kChildrenCount nodes, none of them is Composite
+	const size_t childrenPosition = node.position + 1;
+	if(m_bitArray.size() / Tree::kNodeSize - childrenPosition != kChildrenCount)
+		return;
+
+	const typename Tree::NodeIndex childIndex(childrenPosition * Tree::kNodeSize);
+	const byte					   childBits = (m_bitArray.data()[childIndex.byteIndex()] >> childIndex.bitShift()) & Tree::kNodeMask;
+	if(!Tree::ExcessScanner::allNodesEqual(m_bitArray.data(), childrenPosition, kChildrenCount, childBits))
+		return;
+
+	m_bitArray.resize(node.position * Tree::kNodeSize);
+	Tree::appendNode(m_bitArray, static_cast<NodeState>(childBits));
+}
+
+template<uint D>
+template<class Code, class>
+void BinNTreeBuilder<D>::add(const Code& mortonCode)
+{
+	if(m_isEmpty)
+	{
+		m_isEmpty = false;
+		if(m_depth == 1)
+		{
+			Tree::appendNode(m_bitArray, NodeState::LeafFilled);
+			return;
+		}
+		Tree::appendNode(m_bitArray, NodeState::CompositeEmpty);
+		m_path.push_back({0, 0});
+	}
+
+	if(m_path.empty())
+		// The root is already filled
+		return;
+
+	// Find the deepest open node containing the code
+	size_t pathIndex = 0;
+	while(pathIndex + 1 < m_path.size() && mortonCode.decode(getChildLevel(pathIndex)) + 1 == m_path[pathIndex].childCount)
+		++pathIndex;
+
+	while(m_path.size() > pathIndex + 1)
+		closeNode();
+
+	// Go down to the leaf, opening the nodes on the way
+	while(true)
+	{
+		const uint childLevel = getChildLevel(m_path.size() - 1);
+		const uint childPos	  = mortonCode.decode(childLevel);
+		const uint childCount = m_path.back().childCount;
+
+		if(childPos < childCount)
+		{
+			if(childLevel == 0 && childPos + 1 == childCount)
+				// Same leaf as the previous code
+				return;
+			throw std::invalid_argument("BinNTreeBuilder::add : codes are not sorted in Morton order");
+		}
+
+		addEmptyChildren(childPos - childCount);
+		++m_path.back().childCount;
+
+		if(childLevel == 0)
+		{
+			Tree::appendNode(m_bitArray, NodeState::LeafFilled);
+			return;
+		}
+
+		m_path.push_back({m_bitArray.size() / Tree::kNodeSize, 0});
+		Tree::appendNode(m_bitArray, NodeState::CompositeEmpty);
+	}
+}
+
+template<uint D>
+template<class BitArray>
+BinNTree<D, BitArray> BinNTreeBuilder<D>::build()
+{
+	while(!m_path.empty())
+		closeNode();
+
+	if(m_isEmpty)
+		Tree::appendNode(m_bitArray, NodeState::LeafEmpty);
+
+	m_isEmpty = true;
+	return BinNTree<D, BitArray>(m_depth, std::exchange(m_bitArray, internal::BitVector()));
+}
+
+} // namespace qotf
@@ -0,0 +1,405 @@
+#pragma once
+
+#include <qotf/binary/BinNTree.hpp>
+#include <qotf/internal/BitVector.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace qotf
+{
+
+/**
+ * Boolean formula over BinNTrees of the same depth, evaluated in a single pass
+ *
+ * An expression is built from the trees with the operators | (union), & (intersection),
+ * - (difference), ^ (symmetric difference) and ~ (complement), for example
+ *   (Expression(a) | Expression(b) | Expression(c)) - Expression(d)
+ * evaluate reads the preorder streams of all the trees together, without intermediate trees.
+ * At each node, the formula is simplified with the leaves of the trees as constants,
+ * and the children of the node evaluate the simplified formula : a node costs the number
+ * of trees still undecided under it, not the size of the whole formula.
+ * When the formula becomes a constant (e.g. a Filled leaf in a union), it is a leaf
+ * and the subtrees of the other trees are skipped, and when it only depends on one tree,
+ * the subtree of this tree is copied or complemented as a whole.
+ * The trees are referenced : they must outlive the expression and not be modified before evaluate.
+ */
+template<uint D, class BitArray = internal::BitVector>
+class BinNTreeExpression
+{
+	using Tree		= BinNTree<D, BitArray>;
+	using NodeIndex = typename Tree::NodeIndex;
+
+	static constexpr uint kChildrenCount = powerOfTwo(D);
+
+public:
+	/**
+	 * Expression of the cells filled in [tree]
+	 */
+	explicit BinNTreeExpression(const Tree& tree);
+
+	/**
+	 * Return the number of distinct trees of the expression
+	 */
+	uint getInputCount() const { return static_cast<uint>(m_inputs.size()); }
+
+	/**
+	 * Return the tree of the cells for which the formula is true
+	 */
+	Tree evaluate() const;
+
+	/**
+	 * Requires :
+	 *   - both expressions have trees of the same depth, otherwise std::invalid_argument is thrown
+	 */
+	friend BinNTreeExpression operator|(BinNTreeExpression a, const BinNTreeExpression& b) { return combine(std::move(a), b, kUnionTable); }
+	friend BinNTreeExpression operator&(BinNTreeExpression a, const BinNTreeExpression& b) { return combine(std::move(a), b, kIntersectionTable); }
+	friend BinNTreeExpression operator-(BinNTreeExpression a, const BinNTreeExpression& b) { return combine(std::move(a), b, kDifferenceTable); }
+	friend BinNTreeExpression operator^(BinNTreeExpression a, const BinNTreeExpression& b) { return combine(std::move(a), b, kSymmetricDifferenceTable); }
+
+	friend BinNTreeExpression operator~(BinNTreeExpression a)
+	{
+		a.m_program.push_back({Opcode::Complement, 0, 0});
+		return a;
+	}
+
+private:
+	static constexpr uint8_t kUnionTable			   = Tree::kUnionTable;
+	static constexpr uint8_t kIntersectionTable		   = Tree::kIntersectionTable;
+	static constexpr uint8_t kDifferenceTable		   = Tree::kDifferenceTable;
+	static constexpr uint8_t kSymmetricDifferenceTable = Tree::kSymmetricDifferenceTable;
+
+	enum class Opcode : uint8_t
+	{
+		Input,
+		Complement,
+		Binary
+	};
+
+	struct Instruction
+	{
+		Opcode	opcode;
+		uint8_t truthTable;
+		uint	input;
+	};
+
+	using Program = std::vector<Instruction>;
+
+	/**
+	 * Value of a cell at a node : Empty, Filled, or unknown for a Composite node
+	 */
+	enum class Value : uint8_t
+	{
+		Empty,
+		Filled,
+		Unknown
+	};
+
+	/**
+	 * Operand of a simplified program : a constant, or the instructions
+	 * from [first] to the end of the program
+	 */
+	struct Operand
+	{
+		Value  value;
+		size_t first;
+	};
+
+	/**
+	 * State of the walk over the trees
+	 */
+	struct Walk
+	{
+		std::vector<NodeIndex> indices;
+		std::vector<Value>	   values;
+
+		// The simplified program of each depth, and the trees it reads
+		std::vector<Program>		   programs;
+		std::vector<std::vector<uint>> activeInputs;
+
+		std::vector<Operand> operands;
+		std::vector<uint8_t> isActive;
+	};
+
+	std::vector<const Tree*> m_inputs;
+
+	// The formula in postfix order
+	std::vector<Instruction> m_program;
+
+	/**
+	 * Return the expression applying [truthTable] to [a] and [b], as in BinNTree::combine
+	 */
+	static BinNTreeExpression combine(BinNTreeExpression a, const BinNTreeExpression& b, uint8_t truthTable);
+
+	/**
+	 * Write to [simplified] the program [program] where the trees of known value in [values]
+	 * are replaced by constants, and return the value of the program if it is a constant
+	 */
+	static Value simplify(const Program& program, const std::vector<Value>& values, Program& simplified, std::vector<Operand>& operands);
+
+	/**
+	 * Return the value of [program] if all the cells it reads are [cell]
+	 */
+	static bool evaluateCells(const Program& program, bool cell, std::vector<Operand>& operands);
+
+	/**
+	 * Append to [output] the result of the node at the current indices of the trees
+	 * of walk.activeInputs at [depth], then move their indices to the end of their subtree
+	 */
+	void evaluateNodes(Walk& walk, uint depth, internal::BitVector& output) const;
+};
+
+/*************************************
+ * BinNTreeExpression implementation *
+ *************************************/
+
+template<uint D, class BitArray>
+inline BinNTreeExpression<D, BitArray>::BinNTreeExpression(const Tree& tree) :
+	m_inputs{&tree},
+	m_program{{Opcode::Input, 0, 0}}
+{
+}
+
+template<uint D, class BitArray>
+BinNTreeExpression<D, BitArray> BinNTreeExpression<D, BitArray>::combine(BinNTreeExpression a, const BinNTreeExpression& b, uint8_t truthTable)
+{
+	if(a.m_inputs.front()->getDepth() != b.m_inputs.front()->getDepth())
+		throw std::invalid_argument("BinNTreeExpression : the trees have different depths");
+
+	// A tree used on both sides stays a single input
+	std::vector<uint> inputs;
+	inputs.reserve(b.m_inputs.size());
+	for(const Tree* tree : b.m_inputs)
+	{
+		const auto found = std::find(a.m_inputs.begin(), a.m_inputs.end(), tree);
+		inputs.push_back(static_cast<uint>(found - a.m_inputs.begin()));
+		if(found == a.m_inputs.end())
+			a.m_inputs.push_back(tree);
+	}
+
+	for(Instruction instruction : b.m_program)
+	{
+		if(instruction.opcode == Opcode::Input)
+			instruction.input = inputs[instruction.input];
+		a.m_program.push_back(instruction);
+	}
+	a.m_program.push_back({Opcode::Binary, truthTable, 0});
+
+	return a;
+}
+
+template<uint D, class BitArray>
+typename BinNTreeExpression<D, BitArray>::Tree BinNTreeExpression<D, BitArray>::evaluate() const
+{
+	const uint inputCount = getInputCount();
+	const uint depth	  = m_inputs.front()->getDepth();
+
+	Walk walk;
+	walk.indices.assign(inputCount, NodeIndex());
+	walk.values.assign(inputCount, Value::Unknown);
+	walk.programs.resize(depth + 1);
+	walk.activeInputs.resize(depth + 1);
+	walk.operands.reserve(m_program.size());
+	walk.isActive.assign(inputCount, false);
+	for(uint i = 0; i <= depth; ++i)
+	{
+		walk.programs[i].reserve(m_program.size());
+		walk.activeInputs[i].reserve(inputCount);
+	}
+
+	// All the trees have a root
+	walk.programs[0] = m_program;
+	walk.activeInputs[0].resize(inputCount);
+	std::iota(walk.activeInputs[0].begin(), walk.activeInputs[0].end(), 0);
+
+	size_t maxSize = 0;
+	for(const Tree* tree : m_inputs)
+		maxSize = std::max(maxSize, tree->m_bitArray.size());
+
+	internal::BitVector output;
+	output.reserve(maxSize);
+	evaluateNodes(walk, 0, output);
+
+	Tree tree(depth, std::move(output));
+
+	// The subtrees copied from the inputs keep their pending collapses
+	tree.m_hasPendingCollapse = std::any_of(m_inputs.begin(), m_inputs.end(), [](const Tree* input) { return input->m_hasPendingCollapse; });
+	return tree;
+}
+
+template<uint D, class BitArray>
+typename BinNTreeExpression<D, BitArray>::Value BinNTreeExpression<D, BitArray>::simplify(const Program& program, const std::vector<Value>& values, Program& simplified, std::vector<Operand>& operands)
+{
+	simplified.clear();
+	operands.clear();
+
+	for(const Instruction& instruction : program)
+	{
+		switch(instruction.opcode)
+		{
+		case Opcode::Input:
+		{
+			const Value value = values[instruction.input];
+			operands.push_back({value, simplified.size()});
+			if(value == Value::Unknown)
+				simplified.push_back(instruction);
+			break;
+		}
+		case Opcode::Complement:
+		{
+			Operand& operand = operands.back();
+			if(operand.value != Value::Unknown)
+				operand.value = operand.value == Value::Filled ? Value::Empty : Value::Filled;
+			else if(simplified.back().opcode == Opcode::Complement)
+				simplified.pop_back();
+			else
+				simplified.push_back(instruction);
+			break;
+		}
+		case Opcode::Binary:
+		{
+			const Operand b = operands.back();
+			operands.pop_back();
+			Operand& a = operands.back();
+
+			if(a.value == Value::Unknown && b.value == Value::Unknown)
+			{
+				simplified.push_back(instruction);
+				break;
+			}
+			if(a.value != Value::Unknown && b.value != Value::Unknown)
+			{
+				const uint cell = (a.value == Value::Filled) << 1 | (b.value == Value::Filled);
+				a.value			= instruction.truthTable >> cell & 1 ? Value::Filled : Value::Empty;
+				break;
+			}
+
+			// A constant and an unknown operand : the result is a constant, the operand or its complement
+			const bool isFirstConstant = a.value != Value::Unknown;
+			const uint constant		   = (isFirstConstant ? a.value : b.value) == Value::Filled;
+			const uint emptyCell	   = isFirstConstant ? constant << 1 : constant;
+			const uint filledCell	   = isFirstConstant ? constant << 1 | 1 : 0b10 | constant;
+			const bool emptyResult	   = instruction.truthTable >> emptyCell & 1;
+			const bool filledResult	   = instruction.truthTable >> filledCell & 1;
+
+			// The instructions of the unknown operand are the last ones
+			const size_t first = isFirstConstant ? b.first : a.first;
+			if(emptyResult == filledResult)
+			{
+				simplified.resize(first);
+				a = {filledResult ? Value::Filled : Value::Empty, first};
+				break;
+			}
+
+			a = {Value::Unknown, first};
+			if(emptyResult)
+				simplified.push_back({Opcode::Complement, 0, 0});
+			break;
+		}
+		}
+	}
+	return operands.back().value;
+}
+
+template<uint D, class BitArray>
+bool BinNTreeExpression<D, BitArray>::evaluateCells(const Program& program, bool cell, std::vector<Operand>& operands)
+{
+	operands.clear();
+
+	for(const Instruction& instruction : program)
+	{
+		switch(instruction.opcode)
+		{
+		case Opcode::Input:
+			operands.push_back({cell ? Value::Filled : Value::Empty, 0});
+			break;
+		case Opcode::Complement:
+			operands.back().value = operands.back().value == Value::Filled ? Value::Empty : Value::Filled;
+			break;
+		case Opcode::Binary:
+		{
+			const Value b = operands.back().value;
+			operands.pop_back();
+
+			const uint cell			= (operands.back().value == Value::Filled) << 1 | (b == Value::Filled);
+			operands.back().value = instruction.truthTable >> cell & 1 ? Value::Filled : Value::Empty;
+			break;
+		}
+		}
+	}
+	return operands.back().value == Value::Filled;
+}
+
+template<uint D, class BitArray>
+void BinNTreeExpression<D, BitArray>::evaluateNodes(Walk& walk, uint depth, internal::BitVector& output) const
+{
+	const std::vector<uint>& activeInputs = walk.activeInputs[depth];
+
+	// The leaves give their value to their whole subtree, and the other trees stay unknown
+	for(uint input : activeInputs)
+	{
+		const NodeState state = m_inputs[input]->getNodeState(walk.indices[input]);
+		if(state == NodeState::CompositeFilled)
+			// TODO throw custom exception
+			throw std::logic_error("BitOctree::evaluate : Error while reading nodes");
+
+		if(state == NodeState::CompositeEmpty)
+		{
+			walk.values[input] = Value::Unknown;
+			continue;
+		}
+		walk.values[input] = state == NodeState::LeafFilled ? Value::Filled : Value::Empty;
+		++walk.indices[input];
+	}
+
+	Program&		   program		  = walk.programs[depth + 1];
+	std::vector<uint>& childInputs	  = walk.activeInputs[depth + 1];
+	const Value		   result		  = simplify(walk.programs[depth], walk.values, program, walk.operands);
+
+	childInputs.clear();
+	for(const Instruction& instruction : program)
+		if(instruction.opcode == Opcode::Input && !walk.isActive[instruction.input])
+		{
+			walk.isActive[instruction.input] = true;
+			childInputs.push_back(instruction.input);
+		}
+
+	// The subtrees the simplified program does not read are skipped
+	for(uint input : activeInputs)
+	{
+		if(walk.values[input] == Value::Unknown && !walk.isActive[input])
+			walk.indices[input] = m_inputs[input]->skipSubtrees(walk.indices[input], 1);
+	}
+	for(uint input : childInputs)
+		walk.isActive[input] = false;
+
+	if(result != Value::Unknown)
+	{
+		Tree::appendNode(output, result == Value::Filled ? NodeState::LeafFilled : NodeState::LeafEmpty);
+		return;
+	}
+
+	if(childInputs.size() == 1)
+	{
+		const bool emptyResult	= evaluateCells(program, false, walk.operands);
+		const bool filledResult = evaluateCells(program, true, walk.operands);
+
+		Tree::appendCombinedSubtree(*m_inputs[childInputs.front()], walk.indices[childInputs.front()], emptyResult, filledResult, output);
+		return;
+	}
+
+	const size_t parentPosition = output.size() / Tree::kNodeSize;
+	Tree::appendNode(output, NodeState::CompositeEmpty);
+	for(uint input : childInputs)
+		++walk.indices[input];
+
+	for(uint childPos = 0; childPos < kChildrenCount; ++childPos)
+		evaluateNodes(walk, depth + 1, output);
+
+	Tree::mergeLastChildren(output, parentPosition);
+}
+
+} // namespace qotf
@@ -2,6 +2,9 @@
 
 #include <qotf/utils/Type.hpp>
 
+#include <cstdint>
+#include <cstring>
+
 namespace qotf::internal
 {
 
@@ -49,5 +52,30 @@ inline constexpr bool hasCompleteByte(size_t index, size_t count)
 	return count >= (kByteSize + bitutils::leftShiftInsideByte(index));
 }
 
+/**
+ * Read (resp. write) 8 bytes as a word whose most significant byte is the first one,
+ * so that the bits keep the order they have in the bytes
+ * The bytes go through std::memcpy, which compilers turn into a single load or store and a byte swap
+ */
+inline std::uint64_t loadBigEndianWord(const byte bytes[])
+{
+	byte wordBytes[8];
+	std::memcpy(wordBytes, bytes, sizeof(wordBytes));
+
+	std::uint64_t word = 0;
+	for(ushort i = 0; i < 8; ++i)
+		word = word << 8 | std::to_integer<std::uint64_t>(wordBytes[i]);
+	return word;
+}
+
+inline void storeBigEndianWord(byte bytes[], std::uint64_t word)
+{
+	byte wordBytes[8];
+	for(ushort i = 8; i-- > 0; word >>= 8)
+		wordBytes[i] = static_cast<byte>(word);
+
+	std::memcpy(bytes, wordBytes, sizeof(wordBytes));
+}
+
 } // namespace bitutils
 } // namespace qotf::internal
\ No newline at end of file
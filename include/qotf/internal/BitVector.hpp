@@ -38,6 +38,19 @@ public:
 
 	const byte* data() const { return m_bytes.data(); }
 
+	byte& byteAt(size_t byteIndex) { return m_bytes[byteIndex]; }
+
+	const byte& byteAt(size_t byteIndex) const { return m_bytes[byteIndex]; }
+
+	/**
+	 * Call visitor(data, offset, size) on the contiguous bytes holding the bits
+	 * from [index] to the end, [offset] being the index of the first bit of [data],
+	 * and [size] its number of bits
+	 * The visitor returns false to stop the visit
+	 */
+	template<class Visitor>
+	void visitSegments(size_t index, Visitor&& visitor) const;
+
 	/**
 	 * Return the size of the array in bits
 	 */
@@ -85,6 +98,21 @@ public:
 	void append(size_t count);
 	void append(size_t count, bool bit);
 
+	/**
+	 * Append the [count] bits of [bits] beginning at [index]
+	 * Requires :
+	 *   - index + count <= bits.size
+	 *   - bits is not this array
+	 */
+	void append(const BitVector& bits, size_t index, size_t count);
+
+	/**
+	 * Append the [count] bits of [bytes] beginning at [index]
+	 * Requires :
+	 *   - bytes is not the data of this array
+	 */
+	void append(const byte bytes[], size_t index, size_t count);
+
 	/**
 	 * Insert [count] bits at [index], and set them to [bit]
 	 *   - index <= size
@@ -121,4 +149,11 @@ private:
 	size_t	   m_size;
 };
 
+template<class Visitor>
+inline void BitVector::visitSegments(size_t index, Visitor&& visitor) const
+{
+	if(index < m_size)
+		visitor(data(), size_t{0}, m_size);
+}
+
 } // namespace qotf::internal
\ No newline at end of file
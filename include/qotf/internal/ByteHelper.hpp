@@ -3,7 +3,9 @@
 #include <qotf/internal/BitUtils.hpp>
 #include <qotf/utils/Type.hpp>
 
+#include <cstdint>
 #include <cstring>
+#include <type_traits>
 
 namespace qotf::internal
 {
@@ -70,6 +72,8 @@ public:
 	inline void copyByte(size_t dstBitIndex, size_t srcByteIndex);
 	template<Direction>
 	inline void copyBytes(size_t dstBitIndex, size_t srcByteIndex, size_t count);
+	template<Direction>
+	inline void copyBytesByByte(size_t dstBitIndex, size_t srcByteIndex, size_t count);
 	inline void copyByteStart(size_t dstBitIndex, size_t srcByteIndex, ushort bitCount);
 	inline void copyByteEnd(size_t dstBitIndex, size_t srcByteIndex, ushort bitCount);
 	inline void copyByteMiddle(size_t dstBitIndex, size_t srcBitIndex, ushort bitCount);
@@ -78,6 +82,9 @@ public:
 	inline void shiftBits(size_t index, size_t count, size_t shift);
 
 private:
+	template<Direction>
+	inline void copyBytesByWord(size_t dstBitIndex, size_t srcByteIndex, size_t count);
+
 	template<bool>
 	inline void setBitsLeftByteEnd(size_t index, size_t count);
 	template<bool>
@@ -123,6 +130,17 @@ template<class ByteArray>
 template<bool bit>
 inline void ByteHelper<ByteArray>::setBits(size_t index, size_t count)
 {
+	if(count == 0)
+		return;
+
+	constexpr byte srcByte = bit ? kFullByte : kEmptyByte;
+
+	if(bitutils::byteIndex(index) == bitutils::byteIndex(index + count - 1))
+	{
+		setBytePart(index, srcByte, count);
+		return;
+	}
+
 	setBitsLeftByteEnd<bit>(index, count);
 	setBitsMiddleBytes<bit>(index, count);
 	setBitsRightByteStart<bit>(index, count);
@@ -136,9 +154,10 @@ inline void ByteHelper<ByteArray>::setBitsLeftByteEnd(size_t index, size_t count
 
 	if(bitutils::leftShiftInsideByte(leftmostBitIndex) != 0)
 	{
-		const ushort bitCount = bitutils::rightShiftInsideByte(leftmostBitIndex) + 1;
+		constexpr byte srcByte	= bit ? kFullByte : kEmptyByte;
+		const ushort   bitCount = bitutils::rightShiftInsideByte(leftmostBitIndex) + 1;
 
-		setBytePart(leftmostBitIndex, kFullByte, bitCount);
+		setBytePart(leftmostBitIndex, srcByte, bitCount);
 	}
 }
 
@@ -146,19 +165,17 @@ template<class ByteArray>
 template<bool bit>
 inline void ByteHelper<ByteArray>::setBitsMiddleBytes(size_t index, size_t count)
 {
-	const size_t leftmostBitIndex  = index;
-	const size_t rightmostBitIndex = index + count - 1;
-
 	const ushort maxBitIndexInByte		= kByteSize - 1;
-	const size_t leftmostFullByteIndex	= bitutils::byteIndex(leftmostBitIndex + maxBitIndexInByte);
-	const size_t rightmostFullByteIndex = bitutils::byteIndex(rightmostBitIndex - maxBitIndexInByte);
+	const size_t leftmostFullByteIndex	= bitutils::byteIndex(index + maxBitIndexInByte);
+	const size_t rightmostFullByteLimit = bitutils::byteIndex(index + count);
 
-	const size_t byteCount = rightmostFullByteIndex - leftmostFullByteIndex + 1;
+	if(rightmostFullByteLimit <= leftmostFullByteIndex)
+		return;
 
-	const size_t dstBitIndex = bitutils::bitIndex(leftmostFullByteIndex);
+	constexpr byte srcByte	 = bit ? kFullByte : kEmptyByte;
+	const size_t   byteCount = rightmostFullByteLimit - leftmostFullByteIndex;
 
-	for(size_t i = 0; i < byteCount; i++)
-		setByte(dstBitIndex + i * kByteSize, kFullByte);
+	std::memset(&m_rBytes[leftmostFullByteIndex], std::to_integer<int>(srcByte), byteCount);
 }
 
 template<class ByteArray>
@@ -169,9 +186,11 @@ inline void ByteHelper<ByteArray>::setBitsRightByteStart(size_t index, size_t co
 
 	if(bitutils::rightShiftInsideByte(rightmostBitIndex) != 0)
 	{
-		const size_t dstBitIndex = bitutils::bitIndexAtByteStart(rightmostBitIndex);
+		constexpr byte srcByte	   = bit ? kFullByte : kEmptyByte;
+		const size_t   dstBitIndex = bitutils::bitIndexAtByteStart(rightmostBitIndex);
+		const ushort   bitCount	   = bitutils::leftShiftInsideByte(rightmostBitIndex) + 1;
 
-		setBytePart(dstBitIndex, kFullByte, count);
+		setBytePart(dstBitIndex, srcByte, bitCount);
 	}
 }
 
@@ -298,32 +317,93 @@ inline void ByteHelper<ByteArray>::copyBytes(size_t dstBitIndex, size_t srcByteI
 		void*		dst = &m_rBytes[dstByteIndex];
 		const void* src = &m_rBytes[srcByteIndex];
 
-		const size_t diff	 = utils::byteIndexDiff<direction>(dstByteIndex, srcByteIndex);
-		const int	 overlap = count - diff;
+		const size_t diff = utils::byteIndexDiff<direction>(dstByteIndex, srcByteIndex);
 
-		if(overlap > 0)
+		if(count > diff)
 			std::memmove(dst, src, count);
 		else
 			std::memcpy(dst, src, count);
 	}
 	else
+		copyBytesByWord<direction>(dstBitIndex, srcByteIndex, count);
+}
+
+/**
+ * Reference implementation of copyBytes, copying byte by byte
+ */
+template<class ByteArray>
+template<Direction direction>
+inline void ByteHelper<ByteArray>::copyBytesByByte(size_t dstBitIndex, size_t srcByteIndex, size_t count)
+{
+	if constexpr(utils::isRight<direction>())
 	{
-		if constexpr(utils::isRight<direction>())
-		{
-			const size_t deltaIndex = count - 1;
-			srcByteIndex += deltaIndex;
-			dstBitIndex += kByteSize * deltaIndex;
-		}
+		const size_t deltaIndex = count - 1;
+		srcByteIndex += deltaIndex;
+		dstBitIndex += kByteSize * deltaIndex;
+	}
 
-		for(size_t i = 0; i < count; i++)
-		{
-			copyByte(dstBitIndex, srcByteIndex);
-			if constexpr(utils::isLeft<direction>())
-				dstBitIndex += kByteSize, srcByteIndex++;
-			else
-				dstBitIndex -= kByteSize, srcByteIndex--;
-		}
+	for(size_t i = 0; i < count; i++)
+	{
+		copyByte(dstBitIndex, srcByteIndex);
+		if constexpr(utils::isLeft<direction>())
+			dstBitIndex += kByteSize, srcByteIndex++;
+		else
+			dstBitIndex -= kByteSize, srcByteIndex--;
+	}
+}
+
+template<class ByteArray>
+template<Direction direction>
+inline void ByteHelper<ByteArray>::copyBytesByWord(size_t dstBitIndex, size_t srcByteIndex, size_t count)
+{
+	if(count == 0)
+		return;
+
+	// The [count] source bytes cover [count + 1] destination bytes :
+	// the first and the last ones are partly written, and each one in between
+	// is the end of a source byte followed by the start of the next one
+	const size_t dstByteIndex = bitutils::byteIndex(dstBitIndex);
+	const ushort rightShift	  = bitutils::bitIndexInsideByte(dstBitIndex);
+	const ushort leftShift	  = kByteSize - rightShift;
+
+	const byte firstSrcByte = m_rBytes[srcByteIndex];
+	const byte lastSrcByte	= m_rBytes[srcByteIndex + count - 1];
+
+	const byte* src = &m_rBytes[srcByteIndex];
+	byte*		dst = &m_rBytes[dstByteIndex];
+
+	// Eight destination bytes per step, the order keeping the source bytes
+	// from being overwritten before being read
+	// A fixed array too small for a word is copied byte by byte
+	constexpr bool isWordCopied = !std::is_array_v<ByteArray> || std::extent_v<ByteArray> > 8;
+
+	auto copyWord = [&](size_t i) {
+		const std::uint64_t word = bitutils::loadBigEndianWord(src + i - 1) << leftShift | bitutils::loadBigEndianWord(src + i) >> rightShift;
+		bitutils::storeBigEndianWord(dst + i, word);
+	};
+	auto copyMiddleByte = [&](size_t i) {
+		dst[i] = src[i - 1] << leftShift | src[i] >> rightShift;
+	};
+
+	if constexpr(utils::isLeft<direction>())
+	{
+		size_t i = 1;
+		for(; isWordCopied && i + 8 <= count; i += 8)
+			copyWord(i);
+		for(; i < count; ++i)
+			copyMiddleByte(i);
 	}
+	else
+	{
+		size_t i = count;
+		for(; isWordCopied && i >= 9; i -= 8)
+			copyWord(i - 8);
+		for(; i > 1; --i)
+			copyMiddleByte(i - 1);
+	}
+
+	setBytePart(dstBitIndex, firstSrcByte, leftShift);
+	setBytePart(bitutils::bitIndex(dstByteIndex + count), lastSrcByte << leftShift, rightShift);
 }
 
 template<class ByteArray>
@@ -358,7 +438,10 @@ template<class ByteArray>
 template<Direction direction>
 inline void ByteHelper<ByteArray>::shiftBits(size_t index, size_t count, size_t shift)
 {
-	if(bitutils::bitsAreInMiddleOfByte(index, count))
+	if(count == 0 || shift == 0)
+		return;
+
+	if(bitutils::byteIndex(index) == bitutils::byteIndex(index + count - 1))
 	{
 		const size_t dstBitIndex = utils::shiftBitIndex<direction>(index, shift);
 		copyByteMiddle(dstBitIndex, index, count);
@@ -387,8 +470,7 @@ inline void ByteHelper<ByteArray>::shiftBitsLeftByteEnd(size_t index, size_t cou
 
 	if(bitutils::leftShiftInsideByte(leftmostBitIndex) != 0)
 	{
-		const size_t srcBitIndex  = bitutils::bitIndexInsideByte(leftmostBitIndex);
-		const size_t srcByteIndex = bitutils::byteIndex(srcBitIndex);
+		const size_t srcByteIndex = bitutils::byteIndex(leftmostBitIndex);
 		const size_t dstBitIndex  = utils::shiftBitIndex<direction>(leftmostBitIndex, shift);
 
 		const ushort bitCount = bitutils::rightShiftInsideByte(leftmostBitIndex) + 1;
@@ -401,17 +483,14 @@ template<class ByteArray>
 template<Direction direction>
 inline void ByteHelper<ByteArray>::shiftBitsMiddleBytes(size_t index, size_t count, size_t shift)
 {
-	if(!bitutils::hasCompleteByte(index, count))
-		return;
-
-	const size_t leftmostBitIndex  = index;
-	const size_t rightmostBitIndex = index + count - 1;
-
 	const ushort maxBitIndexInByte			= kByteSize - 1;
-	const size_t leftmostCompleteByteIndex	= bitutils::byteIndex(leftmostBitIndex + maxBitIndexInByte);
-	const size_t rightmostCompleteByteIndex = bitutils::byteIndex(rightmostBitIndex - maxBitIndexInByte);
+	const size_t leftmostCompleteByteIndex	= bitutils::byteIndex(index + maxBitIndexInByte);
+	const size_t rightmostCompleteByteLimit = bitutils::byteIndex(index + count);
+
+	if(rightmostCompleteByteLimit <= leftmostCompleteByteIndex)
+		return;
 
-	const size_t byteCount = rightmostCompleteByteIndex - leftmostCompleteByteIndex + 1;
+	const size_t byteCount = rightmostCompleteByteLimit - leftmostCompleteByteIndex;
 
 	if(byteCount != 0)
 	{
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <qotf/internal/BitUtils.hpp>
+#include <qotf/internal/BitVector.hpp>
+#include <qotf/internal/FenwickTree.hpp>
+#include <qotf/utils/Type.hpp>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace qotf::internal
+{
+
+/**
+ * A bit array cut into blocks of about [BlockByteCount] bytes, each one being a BitVector
+ *
+ * Every block but the last one holds a whole number of bytes, so a byte of the array
+ * always lies in a single block. An insertion or a removal of a whole number of bytes
+ * only shifts the bits of the blocks it touches instead of every bit after it :
+ * the blocks are found from a Fenwick tree of their sizes, which an edit updates in O(log(blockCount)).
+ * Other sizes have to realign all the following blocks.
+ *
+ * Blocks are split when they grow over twice [BlockByteCount] bytes,
+ * and merged with their neighbour when they shrink under half of it,
+ * and only then the sizes of all the blocks are summed again.
+ */
+template<size_t BlockByteCount = 4096>
+class ChunkedBitVector
+{
+	static_assert(BlockByteCount >= 2);
+
+	static constexpr size_t kBlockBitCount = bitutils::bitCount(BlockByteCount);
+
+public:
+	ChunkedBitVector();
+	explicit ChunkedBitVector(size_t size, bool value = false);
+	explicit ChunkedBitVector(BitVector&& bits);
+
+	/**
+	 * Return the size of the array in bits
+	 */
+	size_t size() const { return m_size; }
+
+	size_t blockCount() const { return m_blocks.size(); }
+
+	/**
+	 * Reserve the blocks for the desired number of bits
+	 */
+	void reserve(size_t count);
+
+	/**
+	 * Get the bit at [index]
+	 * Requires :
+	 *   - index < size
+	 */
+	bool get(size_t index) const;
+
+	/**
+	 * Set to [bit] the bit at [index]
+	 * Requires :
+	 *   - index < size
+	 */
+	void set(size_t index, bool bit);
+
+	byte& byteAt(size_t byteIndex);
+
+	const byte& byteAt(size_t byteIndex) const;
+
+	/**
+	 * Insert [count] bits at [index], and set them to [bit]
+	 *   - index <= size
+	 */
+	template<bool bit = false>
+	void insert(size_t index, size_t count);
+
+	/**
+	 * Remove [count] bits at [index]
+	 * Requires :
+	 *   - index + count <= size
+	 */
+	void remove(size_t index, size_t count);
+
+	/**
+	 * Same as BitVector::visitSegments, with one segment per block
+	 */
+	template<class Visitor>
+	void visitSegments(size_t index, Visitor&& visitor) const;
+
+private:
+	std::vector<BitVector> m_blocks;
+	FenwickTree<size_t>	   m_blockSizes;
+
+	size_t m_size;
+
+	/**
+	 * Return the block containing the bit at [index], or the last block if index = size,
+	 * and set [offset] to the index of the bit inside the block
+	 */
+	size_t findBlock(size_t index, size_t& offset) const;
+
+	/**
+	 * Sum again the sizes of every block, after some were split or merged
+	 */
+	void resetSizes();
+
+	/**
+	 * Split or merge [block] if its size is out of bounds, otherwise update its size
+	 */
+	void rebalance(size_t block);
+
+	/**
+	 * Cut again every block from [block] into whole bytes blocks
+	 */
+	void realign(size_t block);
+
+	/**
+	 * Cut [bits] into blocks of [BlockByteCount] bytes, inserted at [block]
+	 */
+	void insertBlocks(size_t block, const BitVector& bits);
+};
+
+/***********************************
+ * ChunkedBitVector implementation *
+ ***********************************/
+
+template<size_t BlockByteCount>
+inline ChunkedBitVector<BlockByteCount>::ChunkedBitVector() :
+	m_blocks(1),
+	m_size(0)
+{
+	resetSizes();
+}
+
+template<size_t BlockByteCount>
+inline ChunkedBitVector<BlockByteCount>::ChunkedBitVector(size_t size, bool value) :
+	ChunkedBitVector(BitVector(size, value))
+{
+}
+
+template<size_t BlockByteCount>
+inline ChunkedBitVector<BlockByteCount>::ChunkedBitVector(BitVector&& bits) :
+	m_size(bits.size())
+{
+	if(bits.size() <= 2 * kBlockBitCount)
+		m_blocks.push_back(std::move(bits));
+	else
+		insertBlocks(0, bits);
+
+	resetSizes();
+}
+
+template<size_t BlockByteCount>
+inline void ChunkedBitVector<BlockByteCount>::reserve(size_t count)
+{
+	m_blocks.reserve(count / kBlockBitCount + 1);
+}
+
+template<size_t BlockByteCount>
+inline size_t ChunkedBitVector<BlockByteCount>::findBlock(size_t index, size_t& offset) const
+{
+	offset			   = index;
+	const size_t block = m_blockSizes.find(offset);
+	if(block < m_blocks.size())
+		return block;
+
+	// The end of the array is the end of the last block
+	offset += m_blocks.back().size();
+	return m_blocks.size() - 1;
+}
+
+template<size_t BlockByteCount>
+inline bool ChunkedBitVector<BlockByteCount>::get(size_t index) const
+{
+	size_t		 offset;
+	const size_t block = findBlock(index, offset);
+	return m_blocks[block].get(offset);
+}
+
+template<size_t BlockByteCount>
+inline void ChunkedBitVector<BlockByteCount>::set(size_t index, bool bit)
+{
+	size_t		 offset;
+	const size_t block = findBlock(index, offset);
+	m_blocks[block].set(offset, bit);
+}
+
+template<size_t BlockByteCount>
+inline byte& ChunkedBitVector<BlockByteCount>::byteAt(size_t byteIndex)
+{
+	size_t		 offset;
+	const size_t block = findBlock(bitutils::bitIndex(byteIndex), offset);
+	return m_blocks[block].byteAt(bitutils::byteIndex(offset));
+}
+
+template<size_t BlockByteCount>
+inline const byte& ChunkedBitVector<BlockByteCount>::byteAt(size_t byteIndex) const
+{
+	size_t		 offset;
+	const size_t block = findBlock(bitutils::bitIndex(byteIndex), offset);
+	return m_blocks[block].byteAt(bitutils::byteIndex(offset));
+}
+
+template<size_t BlockByteCount>
+inline void ChunkedBitVector<BlockByteCount>::resetSizes()
+{
+	std::vector<size_t> sizes(m_blocks.size());
+	for(size_t i = 0; i < m_blocks.size(); ++i)
+		sizes[i] = m_blocks[i].size();
+	m_blockSizes.assign(std::move(sizes));
+}
+
+template<size_t BlockByteCount>
+inline void ChunkedBitVector<BlockByteCount>::insertBlocks(size_t block, const BitVector& bits)
+{
+	std::vector<BitVector> blocks;
+	for(size_t index = 0; index < bits.size(); index += kBlockBitCount)
+	{
+		blocks.emplace_back();
+		blocks.back().append(bits, index, std::min(kBlockBitCount, bits.size() - index));
+	}
+	if(blocks.empty())
+		blocks.emplace_back();
+
+	m_blocks.insert(m_blocks.begin() + block, std::make_move_iterator(blocks.begin()), std::make_move_iterator(blocks.end()));
+}
+
+template<size_t BlockByteCount>
+inline void ChunkedBitVector<BlockByteCount>::realign(size_t block)
+{
+	BitVector bits;
+	bits.reserve(m_size - m_blockSizes.prefixSum(block));
+	for(size_t i = block; i < m_blocks.size(); ++i)
+		bits.append(m_blocks[i], 0, m_blocks[i].size());
+
+	m_blocks.erase(m_blocks.begin() + block, m_blocks.end());
+	insertBlocks(block, bits);
+	resetSizes();
+}
+
+template<size_t BlockByteCount>
+inline void ChunkedBitVector<BlockByteCount>::rebalance(size_t block)
+{
+	BitVector& bits = m_blocks[block];
+
+	if(bits.size() > 2 * kBlockBitCount)
+	{
+		const BitVector tooLarge = std::exchange(bits, BitVector());
+		m_blocks.erase(m_blocks.begin() + block);
+		insertBlocks(block, tooLarge);
+		resetSizes();
+	}
+	else if(bits.size() < kBlockBitCount / 2 && m_blocks.size() > 1)
+	{
+		// Merge with the next block, or the previous one for the last block
+		const size_t left = block + 1 < m_blocks.size() ? block : block - 1;
+
+		m_blocks[left].append(m_blocks[left + 1], 0, m_blocks[left + 1].size());
+		m_blocks.erase(m_blocks.begin() + left + 1);
+		resetSizes();
+		rebalance(left);
+	}
+	else
+		m_blockSizes.set(block, bits.size());
+}
+
+template<size_t BlockByteCount>
+template<bool bit>
+inline void ChunkedBitVector<BlockByteCount>::insert(size_t index, size_t count)
+{
+	size_t		 offset;
+	const size_t block = findBlock(index, offset);
+
+	m_blocks[block].insert<bit>(offset, count);
+	m_size += count;
+
+	if(!bitutils::isMultipleOfByteSize(count) && block + 1 < m_blocks.size())
+		realign(block);
+	else
+		rebalance(block);
+}
+
+template<size_t BlockByteCount>
+inline void ChunkedBitVector<BlockByteCount>::remove(size_t index, size_t count)
+{
+	if(count == 0)
+		return;
+
+	size_t		 firstIndex;
+	size_t		 lastIndex;
+	const size_t first = findBlock(index, firstIndex);
+	const size_t last  = findBlock(index + count - 1, lastIndex);
+	++lastIndex;
+
+	if(first == last)
+		m_blocks[first].remove(firstIndex, count);
+	else
+	{
+		// Join what is left of the first and the last blocks
+		BitVector& joined = m_blocks[first];
+		joined.resize(firstIndex);
+		joined.append(m_blocks[last], lastIndex, m_blocks[last].size() - lastIndex);
+
+		m_blocks.erase(m_blocks.begin() + first + 1, m_blocks.begin() + last + 1);
+		resetSizes();
+	}
+	m_size -= count;
+
+	if(!bitutils::isMultipleOfByteSize(count) && first + 1 < m_blocks.size())
+		realign(first);
+	else
+		rebalance(first);
+}
+
+template<size_t BlockByteCount>
+template<class Visitor>
+inline void ChunkedBitVector<BlockByteCount>::visitSegments(size_t index, Visitor&& visitor) const
+{
+	if(index >= m_size)
+		return;
+
+	size_t offset;
+	size_t block = findBlock(index, offset);
+	for(size_t start = index - offset; block < m_blocks.size(); start += m_blocks[block++].size())
+		if(!visitor(m_blocks[block].data(), start, m_blocks[block].size()))
+			return;
+}
+
+} // namespace qotf::internal
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <qotf/internal/X86Kernels.hpp>
+#include <qotf/utils/Type.hpp>
+
+#include <cstdint>
+#include <cstring>
+
+namespace qotf::internal
+{
+
+using Excess = std::int32_t;
+
+/**
+ * Word-parallel primitives skipping the nodes of a preorder stream of 2-bit nodes
+ * (see ExcessScanner)
+ *
+ * A word of 32 nodes with c Composite nodes has an excess of c * ChildrenCount - 32,
+ * and its minimum prefix excess is at least -(32 - c), reached if all its leaves come first.
+ * So a word can be skipped as a whole as long as [excess] minus its leaf count
+ * stays above [target], which only needs a popcount of the Composite bits.
+ */
+namespace excesskernels
+{
+
+constexpr size_t   kNodesPerByte  = 4;
+constexpr size_t   kNodesPerWord  = 32;
+constexpr uint64_t kCompositeBits = 0xAAAA'AAAA'AAAA'AAAAULL;
+
+inline uint64_t loadWord(const byte data[], size_t nodeIndex)
+{
+	uint64_t word;
+	std::memcpy(&word, data + nodeIndex / kNodesPerByte, sizeof(word));
+	return word;
+}
+
+struct PortablePopcount
+{
+	uint operator()(uint64_t word) const
+	{
+		word = word - ((word >> 1) & 0x5555'5555'5555'5555ULL);
+		word = (word & 0x3333'3333'3333'3333ULL) + ((word >> 2) & 0x3333'3333'3333'3333ULL);
+		word = (word + (word >> 4)) & 0x0F0F'0F0F'0F0F'0F0FULL;
+		return (word * 0x0101'0101'0101'0101ULL) >> 56;
+	}
+};
+
+/**
+ * Return whether or not the word at [nodeIndex] has been skipped
+ */
+template<uint ChildrenCount, class Popcount>
+inline bool skipWord(const byte data[], size_t nodeIndex, Excess& excess, Excess target)
+{
+	const Excess compositeCount = Popcount{}(loadWord(data, nodeIndex) & kCompositeBits);
+	const Excess leafCount		= kNodesPerWord - compositeCount;
+
+	if(excess - leafCount <= target)
+		return false;
+
+	excess += compositeCount * ChildrenCount - static_cast<Excess>(kNodesPerWord);
+	return true;
+}
+
+#if QOTF_X86_KERNELS
+
+/**
+ * Uses the popcnt instruction when inlined into a function compiled for it
+ */
+struct BuiltinPopcount
+{
+	uint operator()(uint64_t word) const { return __builtin_popcountll(word); }
+};
+
+#endif
+
+} // namespace excesskernels
+} // namespace qotf::internal
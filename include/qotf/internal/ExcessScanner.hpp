@@ -0,0 +1,430 @@
+#pragma once
+
+#include <qotf/internal/BitUtils.hpp>
+#include <qotf/internal/ExcessKernels.hpp>
+#include <qotf/utils/Type.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace qotf::internal
+{
+
+/**
+ * Scans a preorder stream of 2-bit nodes (four nodes per byte, the first one on
+ * the two leftmost bits, the left bit of a node being the Composite bit)
+ *
+ * Each node has an excess :
+ *  - Composite : ChildrenCount - 1
+ *  - Leaf      : -1
+ * A complete subtree always sums to -1, and every proper prefix of it is >= 0,
+ * so skipping [count] subtrees means finding the first position where the
+ * excess drops by [count].
+ *
+ * The scan first skips whole words (32 nodes) that cannot reach the target
+ * (see excesskernels), then reads a byte (four nodes) per step, thanks to a table
+ * giving the excess and the minimum prefix excess of every byte.
+ * The word kernel is picked at runtime depending on the CPU (popcnt or portable).
+ */
+template<uint ChildrenCount>
+class ExcessScanner
+{
+	static constexpr size_t kNodesPerByte = excesskernels::kNodesPerByte;
+	static constexpr size_t kNodesPerWord = excesskernels::kNodesPerWord;
+
+	struct ByteExcess
+	{
+		std::int16_t excess;
+		std::int16_t minExcess;
+	};
+
+	using ByteExcessTable = std::array<ByteExcess, 256>;
+
+public:
+	using ForwardFunction = size_t (*)(const byte data[], size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target);
+
+	static constexpr Excess kCompositeExcess = ChildrenCount - 1;
+	static constexpr Excess kLeafExcess		 = -1;
+
+	/**
+	 * Return the excess of the node at [nodeIndex]
+	 */
+	static Excess nodeExcess(const byte data[], size_t nodeIndex);
+
+	/**
+	 * Add the excess of the nodes from [nodeIndex] to [excess], until it reaches [target]
+	 * Return the index of the node following the one that reached [target],
+	 * or [nodeLimit] if it is never reached
+	 * Requires :
+	 *   - excess > target
+	 */
+	static size_t forward(const byte data[], size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target);
+
+	/**
+	 * Kernels of forward :
+	 *  - forwardByWord       : skips words with a portable popcount
+	 *  - forwardByPopcntWord : skips words with the popcnt instruction (x86 only)
+	 */
+	static size_t forwardByWord(const byte data[], size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target);
+#if QOTF_X86_KERNELS
+	static size_t forwardByPopcntWord(const byte data[], size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target);
+#endif
+
+	/**
+	 * Return the fastest kernel of forward supported by the CPU
+	 */
+	static ForwardFunction selectForwardFunction();
+
+	/**
+	 * Same as forward, reading one byte per step
+	 */
+	static size_t forwardByByte(const byte data[], size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target);
+
+	/**
+	 * Same as forward, reading one node per step
+	 * This is the reference implementation of forward
+	 */
+	static size_t forwardByNode(const byte data[], size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target);
+
+	/**
+	 * Return the excess of the nodes in [first, last), and set [minExcess]
+	 * to their minimum prefix excess
+	 */
+	static Excess summarize(const byte data[], size_t first, size_t last, Excess& minExcess);
+
+	/**
+	 * Return whether or not the [count] nodes from [nodeIndex] are all equal to [nodeBits]
+	 */
+	static bool allNodesEqual(const byte data[], size_t nodeIndex, size_t count, byte nodeBits);
+
+	/**
+	 * Return the number of nodes equal to [nodeBits] among the [count] nodes from [nodeIndex]
+	 */
+	static size_t countNodes(const byte data[], size_t nodeIndex, size_t count, byte nodeBits);
+
+	/**
+	 * Same as forward, summarize, allNodesEqual and countNodes, over the segments of a bit array
+	 * (see BitVector::visitSegments)
+	 */
+	template<class BitArray>
+	static size_t forwardIn(const BitArray& bits, size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target);
+	template<class BitArray>
+	static Excess summarizeIn(const BitArray& bits, size_t first, size_t last, Excess& minExcess);
+	template<class BitArray>
+	static bool allNodesEqualIn(const BitArray& bits, size_t nodeIndex, size_t count, byte nodeBits);
+	template<class BitArray>
+	static size_t countNodesIn(const BitArray& bits, size_t nodeIndex, size_t count, byte nodeBits);
+
+private:
+	static constexpr size_t kNodeSize = 2;
+
+	template<class Popcount>
+	static size_t forwardByWord(const byte data[], size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target);
+
+	static constexpr ByteExcessTable makeByteExcessTable();
+
+	static constexpr ByteExcessTable kByteExcessTable = makeByteExcessTable();
+};
+
+template<uint ChildrenCount>
+constexpr typename ExcessScanner<ChildrenCount>::ByteExcessTable ExcessScanner<ChildrenCount>::makeByteExcessTable()
+{
+	ByteExcessTable table{};
+
+	for(uint value = 0; value < table.size(); ++value)
+	{
+		std::int16_t excess	   = 0;
+		std::int16_t minExcess = kCompositeExcess;
+
+		for(uint node = 0; node < kNodesPerByte; ++node)
+		{
+			const uint shift = kByteSize - 1 - 2 * node;
+			excess += ((value >> shift) & 1) ? kCompositeExcess : kLeafExcess;
+			if(excess < minExcess)
+				minExcess = excess;
+		}
+		table[value] = {excess, minExcess};
+	}
+	return table;
+}
+
+template<uint ChildrenCount>
+inline Excess ExcessScanner<ChildrenCount>::nodeExcess(const byte data[], size_t nodeIndex)
+{
+	const byte	 bytes = data[nodeIndex / kNodesPerByte];
+	const ushort shift = kByteSize - 1 - 2 * (nodeIndex % kNodesPerByte);
+
+	return static_cast<bool>((bytes >> shift) & kBitMask) ? kCompositeExcess : kLeafExcess;
+}
+
+template<uint ChildrenCount>
+inline size_t ExcessScanner<ChildrenCount>::forward(const byte data[], size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target)
+{
+	static const ForwardFunction forwardFunction = selectForwardFunction();
+
+	return forwardFunction(data, nodeIndex, nodeLimit, excess, target);
+}
+
+template<uint ChildrenCount>
+template<class Popcount>
+inline size_t ExcessScanner<ChildrenCount>::forwardByWord(const byte data[], size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target)
+{
+	// Read node by node until the beginning of a byte
+	for(; nodeIndex < nodeLimit && nodeIndex % kNodesPerByte; ++nodeIndex)
+	{
+		excess += nodeExcess(data, nodeIndex);
+		if(excess <= target)
+			return nodeIndex + 1;
+	}
+
+	while(true)
+	{
+		// Skip the words that cannot reach the target
+		for(; nodeIndex + kNodesPerWord <= nodeLimit; nodeIndex += kNodesPerWord)
+			if(!excesskernels::skipWord<ChildrenCount, Popcount>(data, nodeIndex, excess, target))
+				break;
+
+		// Read the next word byte by byte, it may reach the target
+		const size_t wordLimit = std::min(nodeIndex + kNodesPerWord, nodeLimit);
+		for(; nodeIndex + kNodesPerByte <= wordLimit; nodeIndex += kNodesPerByte)
+		{
+			const ByteExcess& byteExcess = kByteExcessTable[std::to_integer<uint>(data[nodeIndex / kNodesPerByte])];
+			if(excess + byteExcess.minExcess <= target)
+				// Find the exact node inside this byte
+				return forwardByNode(data, nodeIndex, nodeIndex + kNodesPerByte, excess, target);
+			excess += byteExcess.excess;
+		}
+
+		if(nodeIndex + kNodesPerByte > nodeLimit)
+			return forwardByNode(data, nodeIndex, nodeLimit, excess, target);
+	}
+}
+
+template<uint ChildrenCount>
+inline size_t ExcessScanner<ChildrenCount>::forwardByWord(const byte data[], size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target)
+{
+	return forwardByWord<excesskernels::PortablePopcount>(data, nodeIndex, nodeLimit, excess, target);
+}
+
+#if QOTF_X86_KERNELS
+
+template<uint ChildrenCount>
+__attribute__((target("popcnt"), flatten)) inline size_t ExcessScanner<ChildrenCount>::forwardByPopcntWord(const byte data[], size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target)
+{
+	return forwardByWord<excesskernels::BuiltinPopcount>(data, nodeIndex, nodeLimit, excess, target);
+}
+
+#endif
+
+template<uint ChildrenCount>
+inline typename ExcessScanner<ChildrenCount>::ForwardFunction ExcessScanner<ChildrenCount>::selectForwardFunction()
+{
+#if QOTF_X86_KERNELS
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("popcnt"))
+		return forwardByPopcntWord;
+#endif
+	return forwardByWord;
+}
+
+template<uint ChildrenCount>
+inline size_t ExcessScanner<ChildrenCount>::forwardByByte(const byte data[], size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target)
+{
+	for(; nodeIndex < nodeLimit && nodeIndex % kNodesPerByte; ++nodeIndex)
+	{
+		excess += nodeExcess(data, nodeIndex);
+		if(excess <= target)
+			return nodeIndex + 1;
+	}
+
+	// Skip whole bytes until the one reaching the target
+	for(; nodeIndex + kNodesPerByte <= nodeLimit; nodeIndex += kNodesPerByte)
+	{
+		const ByteExcess& byteExcess = kByteExcessTable[std::to_integer<uint>(data[nodeIndex / kNodesPerByte])];
+		if(excess + byteExcess.minExcess <= target)
+			break;
+		excess += byteExcess.excess;
+	}
+
+	// Find the exact node inside this byte
+	return forwardByNode(data, nodeIndex, nodeLimit, excess, target);
+}
+
+template<uint ChildrenCount>
+inline size_t ExcessScanner<ChildrenCount>::forwardByNode(const byte data[], size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target)
+{
+	for(; nodeIndex < nodeLimit; ++nodeIndex)
+	{
+		excess += nodeExcess(data, nodeIndex);
+		if(excess <= target)
+			return nodeIndex + 1;
+	}
+	return nodeLimit;
+}
+
+template<uint ChildrenCount>
+inline Excess ExcessScanner<ChildrenCount>::summarize(const byte data[], size_t first, size_t last, Excess& minExcess)
+{
+	Excess excess = 0;
+
+	for(; first < last && first % kNodesPerByte; ++first)
+	{
+		excess += nodeExcess(data, first);
+		if(excess < minExcess)
+			minExcess = excess;
+	}
+
+	for(; first + kNodesPerByte <= last; first += kNodesPerByte)
+	{
+		const ByteExcess& byteExcess = kByteExcessTable[std::to_integer<uint>(data[first / kNodesPerByte])];
+		if(excess + byteExcess.minExcess < minExcess)
+			minExcess = excess + byteExcess.minExcess;
+		excess += byteExcess.excess;
+	}
+
+	for(; first < last; ++first)
+	{
+		excess += nodeExcess(data, first);
+		if(excess < minExcess)
+			minExcess = excess;
+	}
+	return excess;
+}
+
+template<uint ChildrenCount>
+inline bool ExcessScanner<ChildrenCount>::allNodesEqual(const byte data[], size_t nodeIndex, size_t count, byte nodeBits)
+{
+	const size_t nodeLimit = nodeIndex + count;
+	const byte	 fullByte  = nodeBits | nodeBits << 2 | nodeBits << 4 | nodeBits << 6;
+
+	for(; nodeIndex < nodeLimit && nodeIndex % kNodesPerByte; ++nodeIndex)
+	{
+		const ushort shift = kByteSize - 2 - 2 * (nodeIndex % kNodesPerByte);
+		if(((data[nodeIndex / kNodesPerByte] >> shift) & byte{0b11}) != nodeBits)
+			return false;
+	}
+
+	for(; nodeIndex + kNodesPerByte <= nodeLimit; nodeIndex += kNodesPerByte)
+		if(data[nodeIndex / kNodesPerByte] != fullByte)
+			return false;
+
+	for(; nodeIndex < nodeLimit; ++nodeIndex)
+	{
+		const ushort shift = kByteSize - 2 - 2 * (nodeIndex % kNodesPerByte);
+		if(((data[nodeIndex / kNodesPerByte] >> shift) & byte{0b11}) != nodeBits)
+			return false;
+	}
+	return true;
+}
+
+template<uint ChildrenCount>
+inline size_t ExcessScanner<ChildrenCount>::countNodes(const byte data[], size_t nodeIndex, size_t count, byte nodeBits)
+{
+	const size_t nodeLimit = nodeIndex + count;
+	const byte	 fullByte  = nodeBits | nodeBits << 2 | nodeBits << 4 | nodeBits << 6;
+	size_t		 result	   = 0;
+
+	for(; nodeIndex < nodeLimit && nodeIndex % kNodesPerByte; ++nodeIndex)
+	{
+		const ushort shift = kByteSize - 2 - 2 * (nodeIndex % kNodesPerByte);
+		result += ((data[nodeIndex / kNodesPerByte] >> shift) & byte{0b11}) == nodeBits;
+	}
+
+	// A node is equal when both bits of its difference are clear
+	for(; nodeIndex + kNodesPerByte <= nodeLimit; nodeIndex += kNodesPerByte)
+	{
+		const byte difference = data[nodeIndex / kNodesPerByte] ^ fullByte;
+		const byte equalNodes = ~(difference | difference >> 1) & byte{0b0101'0101};
+		result += excesskernels::PortablePopcount{}(std::to_integer<uint64_t>(equalNodes));
+	}
+
+	for(; nodeIndex < nodeLimit; ++nodeIndex)
+	{
+		const ushort shift = kByteSize - 2 - 2 * (nodeIndex % kNodesPerByte);
+		result += ((data[nodeIndex / kNodesPerByte] >> shift) & byte{0b11}) == nodeBits;
+	}
+	return result;
+}
+
+template<uint ChildrenCount>
+template<class BitArray>
+inline size_t ExcessScanner<ChildrenCount>::forwardIn(const BitArray& bits, size_t nodeIndex, size_t nodeLimit, Excess& excess, Excess target)
+{
+	size_t position = nodeLimit;
+
+	bits.visitSegments(nodeIndex * kNodeSize, [&](const byte data[], size_t offset, size_t size) {
+		const size_t firstNode	  = offset / kNodeSize;
+		const size_t segmentLimit = std::min(firstNode + size / kNodeSize, nodeLimit);
+		const size_t localIndex	  = std::max(nodeIndex, firstNode) - firstNode;
+
+		const size_t localPosition = forward(data, localIndex, segmentLimit - firstNode, excess, target);
+		if(excess <= target)
+		{
+			position = firstNode + localPosition;
+			return false;
+		}
+		return segmentLimit < nodeLimit;
+	});
+	return position;
+}
+
+template<uint ChildrenCount>
+template<class BitArray>
+inline Excess ExcessScanner<ChildrenCount>::summarizeIn(const BitArray& bits, size_t first, size_t last, Excess& minExcess)
+{
+	Excess excess = 0;
+
+	bits.visitSegments(first * kNodeSize, [&](const byte data[], size_t offset, size_t size) {
+		const size_t firstNode	  = offset / kNodeSize;
+		const size_t segmentLimit = std::min(firstNode + size / kNodeSize, last);
+		const size_t localIndex	  = std::max(first, firstNode) - firstNode;
+
+		// The minimum of the segment is relative to its own beginning
+		Excess		 localMinExcess = minExcess - excess;
+		const Excess segmentExcess	= summarize(data, localIndex, segmentLimit - firstNode, localMinExcess);
+
+		minExcess = excess + localMinExcess;
+		excess += segmentExcess;
+		return segmentLimit < last;
+	});
+	return excess;
+}
+
+template<uint ChildrenCount>
+template<class BitArray>
+inline bool ExcessScanner<ChildrenCount>::allNodesEqualIn(const BitArray& bits, size_t nodeIndex, size_t count, byte nodeBits)
+{
+	const size_t nodeLimit = nodeIndex + count;
+	bool		 result	   = true;
+
+	bits.visitSegments(nodeIndex * kNodeSize, [&](const byte data[], size_t offset, size_t size) {
+		const size_t firstNode	  = offset / kNodeSize;
+		const size_t segmentLimit = std::min(firstNode + size / kNodeSize, nodeLimit);
+		const size_t localIndex	  = std::max(nodeIndex, firstNode) - firstNode;
+
+		result = allNodesEqual(data, localIndex, segmentLimit - firstNode - localIndex, nodeBits);
+		return result && segmentLimit < nodeLimit;
+	});
+	return result;
+}
+
+template<uint ChildrenCount>
+template<class BitArray>
+inline size_t ExcessScanner<ChildrenCount>::countNodesIn(const BitArray& bits, size_t nodeIndex, size_t count, byte nodeBits)
+{
+	const size_t nodeLimit = nodeIndex + count;
+	size_t		 result	   = 0;
+
+	bits.visitSegments(nodeIndex * kNodeSize, [&](const byte data[], size_t offset, size_t size) {
+		const size_t firstNode	  = offset / kNodeSize;
+		const size_t segmentLimit = std::min(firstNode + size / kNodeSize, nodeLimit);
+		const size_t localIndex	  = std::max(nodeIndex, firstNode) - firstNode;
+
+		result += countNodes(data, localIndex, segmentLimit - firstNode - localIndex, nodeBits);
+		return segmentLimit < nodeLimit;
+	});
+	return result;
+}
+
+} // namespace qotf::internal
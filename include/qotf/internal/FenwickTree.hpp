@@ -0,0 +1,118 @@
+#pragma once
+
+#include <qotf/utils/Type.hpp>
+
+#include <utility>
+#include <vector>
+
+namespace qotf::internal
+{
+
+/**
+ * Prefix sums of an array of non-negative values (a binary indexed tree)
+ *
+ * A value is changed, a prefix sum is read, and the element holding a prefix sum is found,
+ * in O(log(size)). The size only changes by assigning the whole array again, in O(size).
+ */
+template<class T>
+class FenwickTree
+{
+public:
+	FenwickTree() = default;
+
+	size_t size() const { return m_tree.size(); }
+
+	/**
+	 * Replace the array by [values]
+	 */
+	void assign(std::vector<T> values);
+
+	/**
+	 * Add [value] to the element at [index]
+	 * Requires :
+	 *   - index < size
+	 */
+	void add(size_t index, T value);
+
+	/**
+	 * Set the element at [index] to [value]
+	 * Requires :
+	 *   - index < size
+	 */
+	void set(size_t index, T value) { add(index, value - at(index)); }
+
+	/**
+	 * Return the element at [index]
+	 * Requires :
+	 *   - index < size
+	 */
+	T at(size_t index) const { return prefixSum(index + 1) - prefixSum(index); }
+
+	/**
+	 * Return the sum of the elements before [index]
+	 * Requires :
+	 *   - index <= size
+	 */
+	T prefixSum(size_t index) const;
+
+	/**
+	 * Return the element holding [value] in the prefix sums, the first one whose prefix sum,
+	 * itself included, is above [value], and subtract from [value] the sum of the elements before it
+	 * Return size if [value] is not below the sum of all the elements
+	 */
+	size_t find(T& value) const;
+
+private:
+	// Element i holds the sum of the (i + 1) & -(i + 1) elements ending at i
+	std::vector<T> m_tree;
+
+	size_t m_highestStep = 0;
+};
+
+template<class T>
+inline void FenwickTree<T>::assign(std::vector<T> values)
+{
+	m_tree = std::move(values);
+
+	for(size_t i = 1; i <= m_tree.size(); ++i)
+	{
+		const size_t parent = i + (i & (~i + 1));
+		if(parent <= m_tree.size())
+			m_tree[parent - 1] += m_tree[i - 1];
+	}
+
+	m_highestStep = 1;
+	while(2 * m_highestStep <= m_tree.size())
+		m_highestStep <<= 1;
+}
+
+template<class T>
+inline void FenwickTree<T>::add(size_t index, T value)
+{
+	for(size_t i = index + 1; i <= m_tree.size(); i += i & (~i + 1))
+		m_tree[i - 1] += value;
+}
+
+template<class T>
+inline T FenwickTree<T>::prefixSum(size_t index) const
+{
+	T sum{};
+	for(size_t i = index; i > 0; i &= i - 1)
+		sum += m_tree[i - 1];
+	return sum;
+}
+
+template<class T>
+inline size_t FenwickTree<T>::find(T& value) const
+{
+	size_t position = 0;
+	for(size_t step = m_highestStep; step; step >>= 1)
+		if(position + step <= m_tree.size() && m_tree[position + step - 1] <= value)
+		{
+			position += step;
+			value -= m_tree[position - 1];
+		}
+	return position;
+}
+
+} // namespace qotf::internal
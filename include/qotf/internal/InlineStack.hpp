@@ -0,0 +1,41 @@
+#pragma once
+
+#include <qotf/utils/Type.hpp>
+
+#include <array>
+#include <cassert>
+
+namespace qotf::internal
+{
+
+/**
+ * Stack of at most Capacity elements, stored inline so that it never allocates
+ */
+template<class T, size_t Capacity>
+class InlineStack
+{
+public:
+	InlineStack() = default;
+
+	size_t size() const { return m_size; }
+	bool   empty() const { return m_size == 0; }
+
+	T&		 back() { return m_items[m_size - 1]; }
+	const T& back() const { return m_items[m_size - 1]; }
+
+	const T& operator[](size_t index) const { return m_items[index]; }
+
+	void push_back(const T& item)
+	{
+		assert(m_size < Capacity);
+		m_items[m_size++] = item;
+	}
+
+	void pop_back() { --m_size; }
+
+private:
+	std::array<T, Capacity> m_items;
+	size_t					m_size = 0;
+};
+
+} // namespace qotf::internal
@@ -0,0 +1,354 @@
+#pragma once
+
+#include <qotf/internal/ExcessScanner.hpp>
+#include <qotf/utils/Type.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace qotf::internal
+{
+
+/**
+ * Sampled excess index over a preorder stream of 2-bit nodes
+ * (see ExcessScanner for the definition of the excess)
+ *
+ * The stream is cut into blocks of about kBlockNodeCount nodes, and each block keeps
+ * its node count, its total excess and its minimum prefix excess. A tree over the blocks
+ * sums them, so a search finds the block of a node, or skips any number of blocks,
+ * in O(log(blockCount)).
+ *
+ * The blocks only know their node count, not their position : an edit recomputes
+ * the blocks it touches and their ancestors in the tree, the following blocks are left as they are.
+ * Blocks are split when they grow over twice kBlockNodeCount nodes,
+ * and merged with their neighbour when they shrink under half of it.
+ */
+template<uint ChildrenCount>
+class SubtreeIndex
+{
+	using Scanner = ExcessScanner<ChildrenCount>;
+
+	static constexpr size_t kBlockNodeCount = 256;
+	static constexpr Excess kNoMin			= std::numeric_limits<Excess>::max() / 2;
+
+	struct Summary
+	{
+		uint   nodeCount;
+		Excess excess;
+		Excess minExcess;
+	};
+
+	static constexpr Summary kEmptySummary{0, 0, kNoMin};
+
+public:
+	SubtreeIndex() = default;
+
+	/**
+	 * Drop every summary
+	 */
+	void clear();
+
+	/**
+	 * Build the summaries of the [nodeCount] nodes of [bits]
+	 */
+	template<class BitArray>
+	void build(const BitArray& bits, size_t nodeCount);
+
+	/**
+	 * Update the summaries after the node at [nodeIndex] of [bits] changed
+	 */
+	template<class BitArray>
+	void update(const BitArray& bits, size_t nodeIndex);
+
+	/**
+	 * Update the summaries after [count] nodes were inserted at [nodeIndex] in [bits]
+	 */
+	template<class BitArray>
+	void insert(const BitArray& bits, size_t nodeIndex, size_t count);
+
+	/**
+	 * Update the summaries after the [count] nodes at [nodeIndex] were removed from [bits]
+	 */
+	template<class BitArray>
+	void remove(const BitArray& bits, size_t nodeIndex, size_t count);
+
+	/**
+	 * Return the index of the node following the [subtreeCount]th complete subtree
+	 * beginning at [nodeIndex]
+	 * Requires :
+	 *   - subtreeCount > 0
+	 *   - there are at least [subtreeCount] complete subtrees after [nodeIndex]
+	 */
+	template<class BitArray>
+	size_t forwardSearch(const BitArray& bits, size_t nodeIndex, size_t subtreeCount) const;
+
+	/**
+	 * Return the memory used by the summaries, in bytes
+	 */
+	size_t memoryUsage() const { return m_tree.capacity() * sizeof(Summary); }
+
+private:
+	static Summary merge(const Summary& left, const Summary& right);
+
+	template<class BitArray>
+	static Summary computeBlock(const BitArray& bits, size_t first, size_t nodeCount);
+
+	size_t totalNodeCount() const { return m_tree.empty() ? 0 : m_tree[1].nodeCount; }
+
+	Summary& leaf(size_t block) { return m_tree[m_leafCount + block]; }
+
+	const Summary& leaf(size_t block) const { return m_tree[m_leafCount + block]; }
+
+	/**
+	 * Return the block containing the node at [nodeIndex], and set [first] to its first node
+	 * Requires :
+	 *   - nodeIndex < nodeCount
+	 */
+	size_t findBlock(size_t nodeIndex, size_t& first) const;
+
+	/**
+	 * Return the first block from [block] whose prefix excess reaches [target],
+	 * while adding the node count and the excess of the skipped blocks to [first] and [excess]
+	 */
+	size_t searchBlock(size_t block, size_t& first, Excess& excess, Excess target) const;
+
+	/**
+	 * Merge again the ancestors of [block] in the tree
+	 */
+	void updateAncestors(size_t block);
+
+	/**
+	 * Replace the blocks [block, blockEnd), whose nodes are the [nodeCount] nodes of [bits] from [first],
+	 * by blocks of kBlockNodeCount to twice kBlockNodeCount nodes
+	 */
+	template<class BitArray>
+	void cut(const BitArray& bits, size_t block, size_t blockEnd, size_t first, size_t nodeCount);
+
+	std::vector<Summary> m_tree;
+
+	size_t m_leafCount	= 0;
+	size_t m_blockCount = 0;
+};
+
+template<uint ChildrenCount>
+inline void SubtreeIndex<ChildrenCount>::clear()
+{
+	m_tree.clear();
+	m_tree.shrink_to_fit();
+	m_leafCount	 = 0;
+	m_blockCount = 0;
+}
+
+template<uint ChildrenCount>
+inline typename SubtreeIndex<ChildrenCount>::Summary SubtreeIndex<ChildrenCount>::merge(const Summary& left, const Summary& right)
+{
+	return {left.nodeCount + right.nodeCount, left.excess + right.excess, std::min(left.minExcess, left.excess + right.minExcess)};
+}
+
+template<uint ChildrenCount>
+template<class BitArray>
+inline typename SubtreeIndex<ChildrenCount>::Summary SubtreeIndex<ChildrenCount>::computeBlock(const BitArray& bits, size_t first, size_t nodeCount)
+{
+	Summary summary{static_cast<uint>(nodeCount), 0, kNoMin};
+	summary.excess = Scanner::summarizeIn(bits, first, first + nodeCount, summary.minExcess);
+	return summary;
+}
+
+template<uint ChildrenCount>
+inline void SubtreeIndex<ChildrenCount>::updateAncestors(size_t block)
+{
+	for(size_t i = (m_leafCount + block) >> 1; i; i >>= 1)
+		m_tree[i] = merge(m_tree[2 * i], m_tree[2 * i + 1]);
+}
+
+template<uint ChildrenCount>
+template<class BitArray>
+inline void SubtreeIndex<ChildrenCount>::cut(const BitArray& bits, size_t block, size_t blockEnd, size_t first, size_t nodeCount)
+{
+	// Rounded down, so that every block but a lone one has at least kBlockNodeCount nodes
+	const size_t cutCount = std::max<size_t>(nodeCount / kBlockNodeCount, 1);
+
+	std::vector<Summary> blocks(cutCount);
+	for(size_t i = 0; i < cutCount; ++i)
+	{
+		const size_t blockFirst = nodeCount * i / cutCount;
+		const size_t blockLast	= nodeCount * (i + 1) / cutCount;
+		blocks[i]				= computeBlock(bits, first + blockFirst, blockLast - blockFirst);
+	}
+
+	// The same number of blocks only changes their ancestors
+	if(cutCount == blockEnd - block)
+	{
+		for(size_t i = 0; i < cutCount; ++i)
+		{
+			leaf(block + i) = blocks[i];
+			updateAncestors(block + i);
+		}
+		return;
+	}
+
+	// Otherwise the following blocks move, and the whole tree is merged again
+	blocks.insert(blocks.begin(), m_tree.begin() + m_leafCount, m_tree.begin() + m_leafCount + block);
+	blocks.insert(blocks.end(), m_tree.begin() + m_leafCount + blockEnd, m_tree.begin() + m_leafCount + m_blockCount);
+
+	m_blockCount = blocks.size();
+	m_leafCount	 = 1;
+	while(m_leafCount < m_blockCount)
+		m_leafCount <<= 1;
+
+	m_tree.assign(2 * m_leafCount, kEmptySummary);
+	std::copy(blocks.begin(), blocks.end(), m_tree.begin() + m_leafCount);
+	for(size_t i = m_leafCount - 1; i > 0; --i)
+		m_tree[i] = merge(m_tree[2 * i], m_tree[2 * i + 1]);
+}
+
+template<uint ChildrenCount>
+template<class BitArray>
+inline void SubtreeIndex<ChildrenCount>::build(const BitArray& bits, size_t nodeCount)
+{
+	m_tree.clear();
+	m_leafCount	 = 0;
+	m_blockCount = 0;
+	cut(bits, 0, 0, 0, nodeCount);
+}
+
+template<uint ChildrenCount>
+inline size_t SubtreeIndex<ChildrenCount>::findBlock(size_t nodeIndex, size_t& first) const
+{
+	size_t i = 1;
+	first	 = 0;
+	while(i < m_leafCount)
+	{
+		i <<= 1;
+		if(nodeIndex >= first + m_tree[i].nodeCount)
+		{
+			first += m_tree[i].nodeCount;
+			++i;
+		}
+	}
+	return i - m_leafCount;
+}
+
+template<uint ChildrenCount>
+template<class BitArray>
+inline void SubtreeIndex<ChildrenCount>::update(const BitArray& bits, size_t nodeIndex)
+{
+	size_t		 first;
+	const size_t block = findBlock(nodeIndex, first);
+
+	leaf(block) = computeBlock(bits, first, leaf(block).nodeCount);
+	updateAncestors(block);
+}
+
+template<uint ChildrenCount>
+template<class BitArray>
+inline void SubtreeIndex<ChildrenCount>::insert(const BitArray& bits, size_t nodeIndex, size_t count)
+{
+	// Nodes added at the end go to the last block
+	size_t		 first;
+	const size_t block = findBlock(std::min(nodeIndex, totalNodeCount() - 1), first);
+
+	const size_t blockNodeCount = leaf(block).nodeCount + count;
+	if(blockNodeCount > 2 * kBlockNodeCount)
+		cut(bits, block, block + 1, first, blockNodeCount);
+	else
+	{
+		leaf(block) = computeBlock(bits, first, blockNodeCount);
+		updateAncestors(block);
+	}
+}
+
+template<uint ChildrenCount>
+template<class BitArray>
+inline void SubtreeIndex<ChildrenCount>::remove(const BitArray& bits, size_t nodeIndex, size_t count)
+{
+	if(count == 0)
+		return;
+
+	size_t first;
+	size_t block = findBlock(nodeIndex, first);
+
+	// Blocks [block, blockEnd) held the removed nodes
+	size_t blockEnd = block;
+	size_t last		= first;
+	while(last < nodeIndex + count)
+		last += leaf(blockEnd++).nodeCount;
+
+	// What is left of them is merged with a neighbour when it is too small
+	size_t leftCount = last - first - count;
+	if(leftCount < kBlockNodeCount / 2 && blockEnd < m_blockCount)
+		leftCount += leaf(blockEnd++).nodeCount;
+	else if(leftCount < kBlockNodeCount / 2 && block > 0)
+	{
+		leftCount += leaf(--block).nodeCount;
+		first -= leaf(block).nodeCount;
+	}
+
+	cut(bits, block, blockEnd, first, leftCount);
+}
+
+template<uint ChildrenCount>
+inline size_t SubtreeIndex<ChildrenCount>::searchBlock(size_t block, size_t& first, Excess& excess, Excess target) const
+{
+	size_t i = m_leafCount + block;
+
+	// Climb until a subtree reaches the target
+	while(excess + m_tree[i].minExcess > target)
+	{
+		excess += m_tree[i].excess;
+		first += m_tree[i].nodeCount;
+
+		// Go to the next subtree on the right
+		while(i & 1)
+			i >>= 1;
+		if(i == 0)
+			return m_leafCount;
+		++i;
+	}
+
+	// Go down to the leftmost block reaching the target
+	while(i < m_leafCount)
+	{
+		i <<= 1;
+		if(excess + m_tree[i].minExcess > target)
+		{
+			excess += m_tree[i].excess;
+			first += m_tree[i].nodeCount;
+			++i;
+		}
+	}
+	return i - m_leafCount;
+}
+
+template<uint ChildrenCount>
+template<class BitArray>
+inline size_t SubtreeIndex<ChildrenCount>::forwardSearch(const BitArray& bits, size_t nodeIndex, size_t subtreeCount) const
+{
+	const Excess target = -static_cast<Excess>(subtreeCount);
+	Excess		 excess = 0;
+
+	// Close subtrees (like the children of a leaf parent) are found without the summaries,
+	// so the nodes of about two blocks are read directly
+	const size_t scanLimit = std::min(nodeIndex + 2 * kBlockNodeCount, totalNodeCount());
+
+	const size_t position = Scanner::forwardIn(bits, nodeIndex, scanLimit, excess, target);
+	if(position != scanLimit || excess <= target || scanLimit == totalNodeCount())
+		return position;
+
+	// Finish the block of the limit, then skip the following blocks
+	size_t		 first;
+	const size_t block	  = findBlock(scanLimit, first);
+	const size_t blockEnd = first + leaf(block).nodeCount;
+
+	const size_t blockPosition = Scanner::forwardIn(bits, scanLimit, blockEnd, excess, target);
+	if(blockPosition != blockEnd || excess <= target || blockEnd == totalNodeCount())
+		return blockPosition;
+
+	first					 = blockEnd;
+	const size_t targetBlock = searchBlock(block + 1, first, excess, target);
+
+	return Scanner::forwardIn(bits, first, first + leaf(targetBlock).nodeCount, excess, target);
+}
+
+} // namespace qotf::internal
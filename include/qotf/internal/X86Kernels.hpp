@@ -0,0 +1,12 @@
+#pragma once
+
+/**
+ * QOTF_X86_KERNELS is 1 when the x86 kernels (popcnt, BMI2, AVX2, AVX-512) can be compiled,
+ * each of them being selected at runtime depending on the CPU
+ */
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define QOTF_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define QOTF_X86_KERNELS 0
+#endif
@@ -1,42 +1,194 @@
 #pragma once
 
 #include <qotf/morton/MortonCode.hpp>
+#include <qotf/morton/MortonKernels.hpp>
 #include <qotf/utils/Math.hpp>
 
+#include <algorithm>
 #include <array>
+#include <type_traits>
 
 namespace qotf
 {
 
-template<uint D>
+/**
+ * Storage of the 128-bit compact codes in two words
+ * The low word holds the deepest levels, so that the codes compare like 128-bit integers
+ */
+struct DoubleWord
+{
+	uint64_t high;
+	uint64_t low;
+
+	constexpr bool operator==(const DoubleWord& other) const { return high == other.high && low == other.low; }
+	constexpr bool operator!=(const DoubleWord& other) const { return !(*this == other); }
+	constexpr bool operator<(const DoubleWord& other) const { return high < other.high || (high == other.high && low < other.low); }
+};
+
+/**
+ * Morton code packed in a single Word : uint32_t, uint64_t or DoubleWord
+ * The width of the word bounds the number of levels, and the coordinates are cut to that many bits
+ *   - uint32_t : 16 levels in 2D, 10 in 3D
+ *   - uint64_t : 32 levels in 2D, 21 in 3D
+ *   - DoubleWord : 32 levels in 3D, only for D >= 3 as a 2D code of 32-bit coordinates fits in a uint64_t
+ */
+template<uint D, class Word = uint64_t>
 class CompactMortonCode final : public MortonCode<D>
 {
+	static_assert(std::is_same_v<Word, uint32_t> || std::is_same_v<Word, uint64_t> || std::is_same_v<Word, DoubleWord>);
+
+	static constexpr bool kIsDoubleWord = std::is_same_v<Word, DoubleWord>;
+
+	static_assert(!kIsDoubleWord || D >= 3, "A 2D code fits in a uint64_t, its DoubleWord high word would always be zero");
+
 public:
 	using Point = std::array<uint32_t, D>;
 
+	/**
+	 * Number of levels held by the code
+	 */
+	static constexpr uint kLevelCount = std::min<uint>(kIsDoubleWord ? 2 * (64 / D) : 8 * sizeof(Word) / D, 32);
+
 	CompactMortonCode()							= delete;
 	CompactMortonCode(const CompactMortonCode&) = default;
 
 	explicit constexpr CompactMortonCode(const Point& p) :
-		m_code(encode(p)) {}
+		m_code(encodeCode<false>(p)) {}
 
 	CompactMortonCode& operator=(const CompactMortonCode&) = default;
 
 	constexpr uint decode(uint level) const override;
 
+	constexpr Word getCode() const { return m_code; }
+
+	/**
+	 * Return the coordinates of the code
+	 * Only the first kLevelCount bits of each coordinate are kept by the code
+	 */
+	constexpr Point toPoint() const { return decodeCode<false>(m_code); }
+
+	/**
+	 * Build a code from its value, as returned by getCode
+	 */
+	static CompactMortonCode fromCode(Word code) { return CompactMortonCode(code, CodeTag{}); }
+
+	/**
+	 * Dilated-integer arithmetic : the coordinate along [axis] is changed inside the code,
+	 * without decoding it, and wraps around its kLevelCount bits
+	 * Requires :
+	 *   - the Word is not a DoubleWord
+	 */
+	CompactMortonCode add(uint axis, uint32_t value) const;
+	CompactMortonCode subtract(uint axis, uint32_t value) const;
+	CompactMortonCode increment(uint axis) const;
+	CompactMortonCode decrement(uint axis) const;
+
+	/**
+	 * Compare the coordinates along [axis] of both codes, without decoding them
+	 * Return a negative value if this coordinate is the lowest, zero if they are equal,
+	 * and a positive value otherwise
+	 */
+	int compareAxis(uint axis, const CompactMortonCode& other) const;
+
+	/**
+	 * Return the code of the cell at [level] containing this one, whose digits under [level] are cleared
+	 */
+	CompactMortonCode parent(uint level) const;
+
+	/**
+	 * Return the code of the child [index] of the cell at [level] containing this one
+	 * Requires :
+	 *   - 0 < level <= kLevelCount
+	 *   - index < 2^D
+	 */
+	CompactMortonCode child(uint level, uint index) const;
+
+	/**
+	 * Encoding and decoding with magic masks
+	 * At runtime, the constructor and toPoint use pdep and pext instead when the CPU has a fast BMI2
+	 */
+	constexpr static Word  encodeByMasks(const Point& p) { return encodeCode<true>(p); }
+	constexpr static Point decodeByMasks(const Word& code) { return decodeCode<true>(code); }
+
+	/**
+	 * Encode the [count] points of [points], given as one array per coordinate, into [codes]
+	 * The kernel is chosen at runtime among AVX-512, BMI2, AVX2 and the magic masks
+	 * DoubleWord codes are encoded one by one
+	 */
+	static void encodeBatch(const mortonkernels::PointArrays<D>& points, size_t count, Word codes[]);
+
+	static void encodeBatchByMasks(const mortonkernels::PointArrays<D>& points, size_t count, Word codes[]);
+
+	/**
+	 * Return the masks of the magic-mask interleave, as built by getMask
+	 */
+	constexpr static mortonkernels::SplitMasks getSplitMasks();
+
 private:
-	uint64_t m_code;
+	using EncodeBatchFunction = void (*)(const mortonkernels::SplitMasks&, const mortonkernels::PointArrays<D>&, size_t, Word[]);
+
+	/**
+	 * Number of levels held by a 64-bit word (the low word of a DoubleWord)
+	 */
+	static constexpr uint kWordLevelCount = std::min<uint>(kLevelCount, 64 / D);
+
+	struct CodeTag
+	{
+	};
+
+	Word m_code;
+
+	constexpr CompactMortonCode(Word code, CodeTag) :
+		m_code(code) {}
+
+	/**
+	 * Return the bits of the coordinate [axis] in the code
+	 */
+	constexpr static Word axisMask(uint axis);
+
+	/**
+	 * Return [value] spread on the bits of the coordinate [axis]
+	 */
+	constexpr static Word dilate(uint axis, uint32_t value);
+
+	/**
+	 * Add (resp. subtract) a value already spread on the bits of the coordinate [axis]
+	 */
+	CompactMortonCode addDilated(uint axis, Word dilated) const;
+	CompactMortonCode subtractDilated(uint axis, Word dilated) const;
+
+	/**
+	 * Return a mask of the digits under [level]
+	 */
+	constexpr static Word lowLevelsMask(uint level);
+
+	static EncodeBatchFunction selectEncodeBatchFunction();
 
 	template<uint N, uint64_t M, uint n = N>
 	constexpr static uint64_t getMask();
 
-	constexpr static uint64_t encode(const Point&);
+	template<bool ByMasks>
+	constexpr static Word encodeCode(const Point&);
+
+	template<bool ByMasks>
+	constexpr static Point decodeCode(const Word&);
+
+	/**
+	 * Encode (resp. decode) the first kWordLevelCount levels of the coordinates in a 64-bit word
+	 */
+	template<bool ByMasks>
+	constexpr static uint64_t encodeWord(const Point&);
+
+	template<bool ByMasks>
+	constexpr static Point decodeWord(uint64_t);
+
 	constexpr static uint64_t split(uint);
+	constexpr static uint32_t compact(uint64_t);
 };
 
-template<uint D>
+template<uint D, class Word>
 template<uint N, uint64_t M, uint n>
-constexpr uint64_t CompactMortonCode<D>::getMask()
+constexpr uint64_t CompactMortonCode<D, Word>::getMask()
 {
 	if constexpr(n == 0)
 		return M;
@@ -48,39 +200,44 @@ constexpr uint64_t CompactMortonCode<D>::getMask()
 	}
 }
 
-template<uint D>
-constexpr uint64_t CompactMortonCode<D>::split(uint n)
+template<uint D, class Word>
+constexpr mortonkernels::SplitMasks CompactMortonCode<D, Word>::getSplitMasks()
 {
-	constexpr uint	   dFactor	= D - 2;
-	constexpr uint64_t bitsMask = (1ULL << (64 / D)) - 1;
+	constexpr uint dFactor = D - 2;
 
-	constexpr uint shift1 = 16 << dFactor;
-	constexpr uint shift2 = 8 << dFactor;
-	constexpr uint shift3 = 4 << dFactor;
-	constexpr uint shift4 = 2 << dFactor;
-	constexpr uint shift5 = 1 << dFactor;
+	return {(1ULL << kWordLevelCount) - 1,
+			{16 << dFactor, 8 << dFactor, 4 << dFactor, 2 << dFactor, 1 << dFactor},
+			{getMask<1, 0x0000FFFFULL>(),
+			 getMask<2, 0x000000FFULL>(),
+			 getMask<3, 0x0000000FULL>(),
+			 getMask<4, 0x00000003ULL>(),
+			 getMask<5, 0x00000001ULL>()}};
+}
 
-	constexpr uint64_t mask1 = getMask<1, 0x0000FFFFULL>();
-	constexpr uint64_t mask2 = getMask<2, 0x000000FFULL>();
-	constexpr uint64_t mask3 = getMask<3, 0x0000000FULL>();
-	constexpr uint64_t mask4 = getMask<4, 0x00000003ULL>();
-	constexpr uint64_t mask5 = getMask<5, 0x00000001ULL>();
+template<uint D, class Word>
+constexpr uint64_t CompactMortonCode<D, Word>::split(uint n)
+{
+	constexpr mortonkernels::SplitMasks splitMasks = getSplitMasks();
 
-	// Keep the first (64 / D) bits
-	uint64_t x = n & bitsMask;
+	return mortonkernels::split(splitMasks, n);
+}
 
-	x = (x | x << shift1) & mask1;
-	x = (x | x << shift2) & mask2;
-	x = (x | x << shift3) & mask3;
-	x = (x | x << shift4) & mask4;
-	x = (x | x << shift5) & mask5;
+template<uint D, class Word>
+constexpr uint32_t CompactMortonCode<D, Word>::compact(uint64_t x)
+{
+	constexpr mortonkernels::SplitMasks splitMasks = getSplitMasks();
 
-	return x;
+	return mortonkernels::compact(splitMasks, x);
 }
 
-template<uint D>
-constexpr uint64_t CompactMortonCode<D>::encode(const Point& coords)
+template<uint D, class Word>
+template<bool ByMasks>
+constexpr uint64_t CompactMortonCode<D, Word>::encodeWord(const Point& coords)
 {
+#if QOTF_X86_KERNELS
+	if(!ByMasks && !__builtin_is_constant_evaluated() && mortonkernels::hasFastBmi2())
+		return mortonkernels::encodeBmi2<D, kWordLevelCount>(coords);
+#endif
 	uint64_t code = 0;
 
 	for(uint i = 1; i <= D; ++i)
@@ -89,11 +246,219 @@ constexpr uint64_t CompactMortonCode<D>::encode(const Point& coords)
 	return code;
 }
 
-template<uint D>
-constexpr uint CompactMortonCode<D>::decode(uint level) const
+template<uint D, class Word>
+template<bool ByMasks>
+constexpr typename CompactMortonCode<D, Word>::Point CompactMortonCode<D, Word>::decodeWord(uint64_t code)
+{
+	Point coords{};
+
+#if QOTF_X86_KERNELS
+	if(!ByMasks && !__builtin_is_constant_evaluated() && mortonkernels::hasFastBmi2())
+	{
+		mortonkernels::decodeBmi2<D, kWordLevelCount>(code, coords);
+		return coords;
+	}
+#endif
+	for(uint i = 1; i <= D; ++i)
+		coords[i - 1] = compact(code >> (D - i));
+
+	return coords;
+}
+
+template<uint D, class Word>
+template<bool ByMasks>
+constexpr Word CompactMortonCode<D, Word>::encodeCode(const Point& coords)
+{
+	if constexpr(kIsDoubleWord)
+	{
+		// The high word holds the levels above the low one
+		Point high{};
+		for(uint i = 0; i < D; ++i)
+			high[i] = static_cast<uint32_t>(static_cast<uint64_t>(coords[i]) >> kWordLevelCount);
+
+		return {encodeWord<ByMasks>(high), encodeWord<ByMasks>(coords)};
+	}
+	else
+		return static_cast<Word>(encodeWord<ByMasks>(coords));
+}
+
+template<uint D, class Word>
+template<bool ByMasks>
+constexpr typename CompactMortonCode<D, Word>::Point CompactMortonCode<D, Word>::decodeCode(const Word& code)
+{
+	if constexpr(kIsDoubleWord)
+	{
+		const Point high = decodeWord<ByMasks>(code.high);
+
+		Point coords = decodeWord<ByMasks>(code.low);
+		for(uint i = 0; i < D; ++i)
+			coords[i] |= static_cast<uint32_t>(static_cast<uint64_t>(high[i]) << kWordLevelCount);
+
+		return coords;
+	}
+	else
+		return decodeWord<ByMasks>(code);
+}
+
+template<uint D, class Word>
+inline void CompactMortonCode<D, Word>::encodeBatch(const mortonkernels::PointArrays<D>& points, size_t count, Word codes[])
+{
+	static const EncodeBatchFunction encodeBatchFunction = selectEncodeBatchFunction();
+
+	encodeBatchFunction(getSplitMasks(), points, count, codes);
+}
+
+template<uint D, class Word>
+inline void CompactMortonCode<D, Word>::encodeBatchByMasks(const mortonkernels::PointArrays<D>& points, size_t count, Word codes[])
+{
+	if constexpr(kIsDoubleWord)
+	{
+		for(size_t i = 0; i < count; ++i)
+		{
+			Point coords;
+			for(uint axis = 0; axis < D; ++axis)
+				coords[axis] = points[axis][i];
+			codes[i] = encodeByMasks(coords);
+		}
+	}
+	else
+		mortonkernels::encodeBatchByMasks<D>(getSplitMasks(), points, 0, count, codes);
+}
+
+template<uint D, class Word>
+inline typename CompactMortonCode<D, Word>::EncodeBatchFunction CompactMortonCode<D, Word>::selectEncodeBatchFunction()
+{
+	if constexpr(kIsDoubleWord)
+	{
+		return [](const mortonkernels::SplitMasks&, const mortonkernels::PointArrays<D>& points, size_t count, Word codes[]) {
+			for(size_t i = 0; i < count; ++i)
+			{
+				Point coords;
+				for(uint axis = 0; axis < D; ++axis)
+					coords[axis] = points[axis][i];
+				codes[i] = CompactMortonCode(coords).getCode();
+			}
+		};
+	}
+	else
+	{
+#if QOTF_X86_KERNELS
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx512f"))
+			return mortonkernels::encodeBatchAvx512<D, Word>;
+		if(mortonkernels::hasFastBmi2())
+			return mortonkernels::encodeBatchBmi2<D, Word>;
+		if(__builtin_cpu_supports("avx2"))
+			return mortonkernels::encodeBatchAvx2<D, Word>;
+#endif
+		return [](const mortonkernels::SplitMasks& splitMasks, const mortonkernels::PointArrays<D>& points, size_t count, Word codes[]) {
+			mortonkernels::encodeBatchByMasks<D>(splitMasks, points, 0, count, codes);
+		};
+	}
+}
+
+template<uint D, class Word>
+constexpr Word CompactMortonCode<D, Word>::axisMask(uint axis)
+{
+	static_assert(!kIsDoubleWord, "Dilated arithmetic needs a single word code");
+
+	constexpr std::array<uint64_t, D> masks = mortonkernels::axisMasks<D, kLevelCount>();
+	return static_cast<Word>(masks[axis]);
+}
+
+template<uint D, class Word>
+constexpr Word CompactMortonCode<D, Word>::dilate(uint axis, uint32_t value)
+{
+	return static_cast<Word>(split(value) << (D - 1 - axis));
+}
+
+template<uint D, class Word>
+constexpr Word CompactMortonCode<D, Word>::lowLevelsMask(uint level)
+{
+	static_assert(!kIsDoubleWord, "Dilated arithmetic needs a single word code");
+	return level >= kLevelCount ? ~Word{0} : static_cast<Word>((uint64_t{1} << (D * level)) - 1);
+}
+
+template<uint D, class Word>
+inline CompactMortonCode<D, Word> CompactMortonCode<D, Word>::addDilated(uint axis, Word dilated) const
+{
+	const Word mask = axisMask(axis);
+
+	// Setting the bits of the other coordinates carries the sum over them
+	const Word sum = ((m_code | ~mask) + dilated) & mask;
+	return fromCode((m_code & ~mask) | sum);
+}
+
+template<uint D, class Word>
+inline CompactMortonCode<D, Word> CompactMortonCode<D, Word>::subtractDilated(uint axis, Word dilated) const
+{
+	const Word mask = axisMask(axis);
+
+	// Clearing the bits of the other coordinates borrows over them
+	const Word difference = ((m_code & mask) - dilated) & mask;
+	return fromCode((m_code & ~mask) | difference);
+}
+
+template<uint D, class Word>
+inline CompactMortonCode<D, Word> CompactMortonCode<D, Word>::add(uint axis, uint32_t value) const
+{
+	return addDilated(axis, dilate(axis, value));
+}
+
+template<uint D, class Word>
+inline CompactMortonCode<D, Word> CompactMortonCode<D, Word>::subtract(uint axis, uint32_t value) const
+{
+	return subtractDilated(axis, dilate(axis, value));
+}
+
+template<uint D, class Word>
+inline CompactMortonCode<D, Word> CompactMortonCode<D, Word>::increment(uint axis) const
+{
+	return addDilated(axis, Word{1} << (D - 1 - axis));
+}
+
+template<uint D, class Word>
+inline CompactMortonCode<D, Word> CompactMortonCode<D, Word>::decrement(uint axis) const
+{
+	return subtractDilated(axis, Word{1} << (D - 1 - axis));
+}
+
+template<uint D, class Word>
+inline int CompactMortonCode<D, Word>::compareAxis(uint axis, const CompactMortonCode& other) const
+{
+	// Dilation keeps the order of the coordinates
+	const Word mask	 = axisMask(axis);
+	const Word left	 = m_code & mask;
+	const Word right = other.m_code & mask;
+
+	return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+template<uint D, class Word>
+inline CompactMortonCode<D, Word> CompactMortonCode<D, Word>::parent(uint level) const
+{
+	return fromCode(m_code & ~lowLevelsMask(level));
+}
+
+template<uint D, class Word>
+inline CompactMortonCode<D, Word> CompactMortonCode<D, Word>::child(uint level, uint index) const
+{
+	return fromCode((m_code & ~lowLevelsMask(level)) | static_cast<Word>(Word{index} << (D * (level - 1))));
+}
+
+template<uint D, class Word>
+constexpr uint CompactMortonCode<D, Word>::decode(uint level) const
 {
 	constexpr uint mask = (1 << D) - 1;
-	return (m_code >> (D * level)) & mask;
+
+	if constexpr(kIsDoubleWord)
+	{
+		if(level >= kWordLevelCount)
+			return (m_code.high >> (D * (level - kWordLevelCount))) & mask;
+		return (m_code.low >> (D * level)) & mask;
+	}
+	else
+		return (m_code >> (D * level)) & mask;
 }
 
-} // namespace qotf
\ No newline at end of file
+} // namespace qotf
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <qotf/morton/CompactMortonCode.hpp>
+#include <qotf/morton/MortonCode.hpp>
+
+#include <array>
+#include <cstdint>
+
+namespace qotf
+{
+
+/**
+ * Tables of the Hilbert curve, computed at compile time
+ *
+ * The index is computed one level at a time from the most significant one, with a table
+ * giving for each orientation of the curve and each child the position of the child
+ * along the curve and the orientation inside it (Hamilton, "Compact Hilbert indices").
+ * An orientation, or state, is an entry corner and a direction.
+ */
+namespace hilbert
+{
+
+template<uint D>
+constexpr uint kStateCount = (1 << D) * D;
+
+struct Transition
+{
+	uint8_t digit;
+	uint8_t state;
+};
+
+/**
+ * Table indexed by the state and the Morton child index (resp. the position along the curve),
+ * giving the position along the curve (resp. the Morton child index) and the next state
+ */
+template<uint D>
+using TransitionTable = std::array<std::array<Transition, (1 << D)>, kStateCount<D>>;
+
+template<uint D>
+constexpr uint rotateLeft(uint bits, uint shift)
+{
+	shift %= D;
+	return ((bits << shift) | (bits >> (D - shift))) & ((1U << D) - 1);
+}
+
+template<uint D>
+constexpr uint rotateRight(uint bits, uint shift)
+{
+	shift %= D;
+	return ((bits >> shift) | (bits << (D - shift))) & ((1U << D) - 1);
+}
+
+constexpr uint gray(uint index)
+{
+	return index ^ (index >> 1);
+}
+
+constexpr uint grayInverse(uint bits)
+{
+	uint index = 0;
+	for(; bits; bits >>= 1)
+		index ^= bits;
+	return index;
+}
+
+constexpr uint trailingSetBits(uint bits)
+{
+	uint count = 0;
+	for(; bits & 1; bits >>= 1)
+		++count;
+	return count;
+}
+
+template<uint D>
+constexpr uint nextState(uint state, uint position)
+{
+	const uint entry	 = state / D;
+	const uint direction = state % D;
+
+	// Entry corner and direction of the child, relative to its parent
+	const uint childEntry	  = position == 0 ? 0 : gray(2 * ((position - 1) / 2));
+	const uint childDirection = position == 0 ? 0 : trailingSetBits(position % 2 ? position : position - 1) % D;
+
+	const uint nextEntry	 = entry ^ rotateLeft<D>(childEntry, direction + 1);
+	const uint nextDirection = (direction + childDirection + 1) % D;
+
+	return nextEntry * D + nextDirection;
+}
+
+template<uint D>
+constexpr TransitionTable<D> makeEncodeTable()
+{
+	TransitionTable<D> table{};
+
+	for(uint state = 0; state < kStateCount<D>; ++state)
+		for(uint child = 0; child < (1U << D); ++child)
+		{
+			const uint position = grayInverse(rotateRight<D>(child ^ (state / D), state % D + 1));
+			table[state][child] = {static_cast<uint8_t>(position), static_cast<uint8_t>(nextState<D>(state, position))};
+		}
+
+	return table;
+}
+
+template<uint D>
+constexpr TransitionTable<D> makeDecodeTable()
+{
+	TransitionTable<D> table{};
+
+	for(uint state = 0; state < kStateCount<D>; ++state)
+		for(uint position = 0; position < (1U << D); ++position)
+		{
+			const uint child	   = rotateLeft<D>(gray(position), state % D + 1) ^ (state / D);
+			table[state][position] = {static_cast<uint8_t>(child), static_cast<uint8_t>(nextState<D>(state, position))};
+		}
+
+	return table;
+}
+
+/**
+ * Number of levels read by a lookup in a step table
+ */
+template<uint D>
+constexpr uint kStepLevelCount = D == 2 ? 4 : 3;
+
+/**
+ * Table chaining the transitions over kStepLevelCount levels
+ * An entry packs the digits in its low D * kStepLevelCount bits, and the next state above them,
+ * to keep the 3D table in 24 KiB
+ */
+template<uint D>
+using StepTable = std::array<std::array<uint16_t, (1 << (D * kStepLevelCount<D>))>, kStateCount<D>>;
+
+template<uint D>
+constexpr StepTable<D> makeStepTable(const TransitionTable<D>& table)
+{
+	StepTable<D> stepTable{};
+
+	for(uint state = 0; state < kStateCount<D>; ++state)
+		for(uint digits = 0; digits < (1U << (D * kStepLevelCount<D>)); ++digits)
+		{
+			uint stepState	= state;
+			uint stepDigits = 0;
+			for(uint level = kStepLevelCount<D>; level-- > 0;)
+			{
+				const Transition& transition = table[stepState][(digits >> (D * level)) & ((1U << D) - 1)];
+
+				stepDigits |= transition.digit << (D * level);
+				stepState = transition.state;
+			}
+			stepTable[state][digits] = static_cast<uint16_t>(stepDigits | stepState << (D * kStepLevelCount<D>));
+		}
+
+	return stepTable;
+}
+
+/**
+ * Return the number of levels of [code] before its first non zero digit
+ * From the first state, these levels keep a zero digit in both directions,
+ * and only turn the direction of the state
+ */
+template<uint D, uint LevelCount>
+constexpr uint leadingZeroLevels(uint64_t code)
+{
+	if(code == 0)
+		return LevelCount;
+#if defined(__GNUC__) || defined(__clang__)
+	return (static_cast<uint>(__builtin_clzll(code)) - (64 - D * LevelCount)) / D;
+#else
+	uint level = LevelCount;
+	while(((code >> (D * (level - 1))) & ((1U << D) - 1)) == 0)
+		--level;
+	return LevelCount - level;
+#endif
+}
+
+/**
+ * Convert [code] with the transitions of [table] and [stepTable]
+ */
+template<uint D, uint LevelCount>
+constexpr uint64_t convert(const TransitionTable<D>& table, const StepTable<D>& stepTable, uint64_t code)
+{
+	constexpr uint64_t kStepMask = (1ULL << (D * kStepLevelCount<D>)) - 1;
+
+	const uint zeroLevels = leadingZeroLevels<D, LevelCount>(code);
+
+	uint64_t result = 0;
+	uint	 state	= zeroLevels % D;
+	uint	 level	= LevelCount - zeroLevels;
+
+	// Levels over a whole number of steps
+	while(level % kStepLevelCount<D>)
+	{
+		--level;
+		const Transition& transition = table[state][(code >> (D * level)) & ((1U << D) - 1)];
+
+		result |= static_cast<uint64_t>(transition.digit) << (D * level);
+		state = transition.state;
+	}
+
+	while(level > 0)
+	{
+		level -= kStepLevelCount<D>;
+		const uint transition = stepTable[state][(code >> (D * level)) & kStepMask];
+
+		result |= static_cast<uint64_t>(transition & kStepMask) << (D * level);
+		state = transition >> (D * kStepLevelCount<D>);
+	}
+
+	return result;
+}
+
+} // namespace hilbert
+
+/**
+ * Code of a cell along the Hilbert curve, whose consecutive cells are always neighbours
+ *
+ * getCode returns the index along the curve, to sort points with a better locality
+ * than the Z-order. decode still returns the child indices of the Node2Index / Node3Index
+ * convention, so the code goes down the trees like a Morton code.
+ * The Morton code is kept next to the Hilbert index, so decode does not walk the curve.
+ */
+template<uint D>
+class HilbertCode final : public MortonCode<D>
+{
+	static_assert(D == 2 || D == 3);
+
+	static constexpr uint kChildMask = (1 << D) - 1;
+
+public:
+	using Point = std::array<uint32_t, D>;
+
+	static constexpr uint kLevelCount = 64 / D;
+
+	HilbertCode()					= delete;
+	HilbertCode(const HilbertCode&) = default;
+
+	explicit HilbertCode(const Point& p) :
+		m_mortonCode(CompactMortonCode<D>(p).getCode()),
+		m_code(fromMorton(m_mortonCode)) {}
+
+	HilbertCode& operator=(const HilbertCode&) = default;
+
+	constexpr uint decode(uint level) const override { return (m_mortonCode >> (D * level)) & kChildMask; }
+
+	/**
+	 * Return the index of the cell along the Hilbert curve
+	 */
+	constexpr uint64_t getCode() const { return m_code; }
+
+	constexpr uint64_t getMortonCode() const { return m_mortonCode; }
+
+	Point toPoint() const { return CompactMortonCode<D>::decodeByMasks(m_mortonCode); }
+
+	/**
+	 * Convert a Morton code of kLevelCount levels to its index along the Hilbert curve
+	 */
+	constexpr static uint64_t fromMorton(uint64_t mortonCode);
+
+	/**
+	 * Convert an index along the Hilbert curve to its Morton code
+	 */
+	constexpr static uint64_t toMorton(uint64_t code);
+
+private:
+	uint64_t m_mortonCode;
+	uint64_t m_code;
+
+	static constexpr hilbert::TransitionTable<D> kEncodeTable	 = hilbert::makeEncodeTable<D>();
+	static constexpr hilbert::TransitionTable<D> kDecodeTable	 = hilbert::makeDecodeTable<D>();
+	static constexpr hilbert::StepTable<D>		 kEncodeStepTable = hilbert::makeStepTable<D>(kEncodeTable);
+	static constexpr hilbert::StepTable<D>		 kDecodeStepTable = hilbert::makeStepTable<D>(kDecodeTable);
+};
+
+template<uint D>
+constexpr uint64_t HilbertCode<D>::fromMorton(uint64_t mortonCode)
+{
+	return hilbert::convert<D, kLevelCount>(kEncodeTable, kEncodeStepTable, mortonCode);
+}
+
+template<uint D>
+constexpr uint64_t HilbertCode<D>::toMorton(uint64_t code)
+{
+	return hilbert::convert<D, kLevelCount>(kDecodeTable, kDecodeStepTable, code);
+}
+
+} // namespace qotf
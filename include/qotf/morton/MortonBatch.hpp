@@ -0,0 +1,281 @@
+#pragma once
+
+#include <qotf/morton/CompactMortonCode.hpp>
+#include <qotf/utils/ThreadPool.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace qotf
+{
+
+/**
+ * Contiguous array of compact Morton codes, the input of the batch operations on the trees
+ *
+ * Only the [levelCount] deepest levels of the codes are significant, the levels above them are zero.
+ * A tree of maxDepth d reads d - 1 levels, so its leaves are the codes of d - 1 levels.
+ * The codes are sorted with an LSD radix sort reading only the D * levelCount significant bits,
+ * twelve bits per pass, and a pass is skipped when all the codes share its digit.
+ */
+template<uint D, class Word = uint64_t>
+class MortonBatch
+{
+	static_assert(std::is_same_v<Word, uint32_t> || std::is_same_v<Word, uint64_t>, "MortonBatch sorts single word codes");
+
+public:
+	using Code	= CompactMortonCode<D, Word>;
+	using Point = typename Code::Point;
+
+	/**
+	 * Iterator over the codes as CompactMortonCode, to give the batch to BinNTree::setNodes
+	 */
+	class CodeIterator
+	{
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type		= Code;
+		using difference_type	= std::ptrdiff_t;
+		using pointer			= void;
+		using reference			= Code;
+
+		explicit CodeIterator(const Word* word) :
+			m_word(word) {}
+
+		Code operator*() const { return Code::fromCode(*m_word); }
+		Code operator[](difference_type offset) const { return Code::fromCode(m_word[offset]); }
+
+		CodeIterator& operator++()
+		{
+			++m_word;
+			return *this;
+		}
+
+		CodeIterator& operator+=(difference_type offset)
+		{
+			m_word += offset;
+			return *this;
+		}
+
+		CodeIterator	operator+(difference_type offset) const { return CodeIterator(m_word + offset); }
+		difference_type operator-(const CodeIterator& other) const { return m_word - other.m_word; }
+
+		bool operator==(const CodeIterator& other) const { return m_word == other.m_word; }
+		bool operator!=(const CodeIterator& other) const { return m_word != other.m_word; }
+		bool operator<(const CodeIterator& other) const { return m_word < other.m_word; }
+
+	private:
+		const Word* m_word;
+	};
+
+	/**
+	 * Requires :
+	 *   - levelCount <= Code::kLevelCount, otherwise std::invalid_argument is thrown
+	 */
+	explicit MortonBatch(uint levelCount = Code::kLevelCount);
+
+	uint getLevelCount() const { return m_levelCount; }
+
+	size_t size() const { return m_codes.size(); }
+	bool   empty() const { return m_codes.empty(); }
+
+	void reserve(size_t count) { m_codes.reserve(count); }
+	void clear() { m_codes.clear(); }
+
+	/**
+	 * Requires :
+	 *   - the coordinates are under 2^levelCount
+	 */
+	void add(const Point& p) { m_codes.push_back(Code(p).getCode()); }
+	void add(const Code& code) { m_codes.push_back(code.getCode()); }
+
+	/**
+	 * Add the [count] points of the coordinate arrays [points], encoded with Code::encodeBatch
+	 */
+	void add(const mortonkernels::PointArrays<D>& points, size_t count);
+
+	Word operator[](size_t index) const { return m_codes[index]; }
+
+	const Word* data() const { return m_codes.data(); }
+	const Word* begin() const { return m_codes.data(); }
+	const Word* end() const { return m_codes.data() + m_codes.size(); }
+
+	CodeIterator codesBegin() const { return CodeIterator(begin()); }
+	CodeIterator codesEnd() const { return CodeIterator(end()); }
+
+	/**
+	 * Sort the codes in Morton order
+	 * With a pool, each pass computes the histograms and moves the codes in parallel
+	 */
+	void sort();
+	void sort(ThreadPool& pool);
+
+	/**
+	 * Remove the duplicated codes, in place
+	 * Requires :
+	 *   - the codes are sorted
+	 */
+	void unique();
+
+	/**
+	 * Replace each code by the first code of its ancestor keeping only its [levelCount] highest levels,
+	 * keeping the order : the levels under them are cleared, so the codes still address the same tree,
+	 * at the node depth levelCount + 1
+	 * Requires :
+	 *   - levelCount <= getLevelCount(), otherwise std::invalid_argument is thrown
+	 */
+	void truncate(uint levelCount);
+
+private:
+	static constexpr uint	kDigitBitCount = 12;
+	static constexpr size_t kBucketCount   = size_t{1} << kDigitBitCount;
+
+	/**
+	 * Under this size, std::sort is faster than the radix passes
+	 */
+	static constexpr size_t kRadixMinSize = 1 << 10;
+
+	/**
+	 * Minimum number of codes sorted by a task
+	 */
+	static constexpr size_t kTaskMinSize = 1 << 14;
+
+	using Histogram = std::array<size_t, kBucketCount>;
+
+	std::vector<Word> m_codes;
+	uint			  m_levelCount;
+
+	/**
+	 * [run] calls a task for each index in [0, taskCount)
+	 */
+	template<class Run>
+	void radixSort(uint taskCount, Run&& run);
+};
+
+/******************************
+ * MortonBatch implementation *
+ ******************************/
+
+template<uint D, class Word>
+inline MortonBatch<D, Word>::MortonBatch(uint levelCount) :
+	m_levelCount(levelCount)
+{
+	if(levelCount > Code::kLevelCount)
+		throw std::invalid_argument("MortonBatch : the codes cannot hold that many levels");
+}
+
+template<uint D, class Word>
+inline void MortonBatch<D, Word>::add(const mortonkernels::PointArrays<D>& points, size_t count)
+{
+	const size_t first = m_codes.size();
+	m_codes.resize(first + count);
+	Code::encodeBatch(points, count, m_codes.data() + first);
+}
+
+template<uint D, class Word>
+inline void MortonBatch<D, Word>::sort()
+{
+	radixSort(1, [](uint taskCount, const auto& task) {
+		for(uint i = 0; i < taskCount; ++i)
+			task(i);
+	});
+}
+
+template<uint D, class Word>
+inline void MortonBatch<D, Word>::sort(ThreadPool& pool)
+{
+	const uint taskCount = static_cast<uint>(std::clamp<size_t>(m_codes.size() / kTaskMinSize, 1, pool.getThreadCount()));
+
+	radixSort(taskCount, [&pool](uint taskCount, const auto& task) { pool.run(taskCount, task); });
+}
+
+template<uint D, class Word>
+template<class Run>
+inline void MortonBatch<D, Word>::radixSort(uint taskCount, Run&& run)
+{
+	const size_t count = m_codes.size();
+	if(count < kRadixMinSize)
+	{
+		std::sort(m_codes.begin(), m_codes.end());
+		return;
+	}
+
+	const uint	 bitCount  = D * m_levelCount;
+	const size_t chunkSize = (count + taskCount - 1) / taskCount;
+
+	std::vector<Word>	   buffer(count);
+	std::vector<Histogram> offsets(taskCount);
+
+	Word* source = m_codes.data();
+	Word* target = buffer.data();
+
+	for(uint shift = 0; shift < bitCount; shift += kDigitBitCount)
+	{
+		run(taskCount, [&](uint task) {
+			Histogram histogram{};
+
+			const size_t last = std::min(count, (task + 1) * chunkSize);
+			for(size_t i = task * chunkSize; i < last; ++i)
+				++histogram[(source[i] >> shift) & (kBucketCount - 1)];
+
+			offsets[task] = histogram;
+		});
+
+		// The codes of a bucket are moved in the order of the tasks, which keeps the sort stable
+		size_t offset = 0;
+		bool   isUniform = false;
+		for(size_t bucket = 0; bucket < kBucketCount; ++bucket)
+		{
+			const size_t bucketFirst = offset;
+			for(Histogram& histogram : offsets)
+			{
+				const size_t bucketCount = histogram[bucket];
+				histogram[bucket]		 = offset;
+				offset += bucketCount;
+			}
+			isUniform = isUniform || offset - bucketFirst == count;
+		}
+		if(isUniform)
+			continue;
+
+		run(taskCount, [&](uint task) {
+			// A local copy, as the offsets could alias the codes for the compiler
+			Histogram histogram = offsets[task];
+
+			const size_t last = std::min(count, (task + 1) * chunkSize);
+			for(size_t i = task * chunkSize; i < last; ++i)
+			{
+				const Word code = source[i];
+				target[histogram[(code >> shift) & (kBucketCount - 1)]++] = code;
+			}
+		});
+		std::swap(source, target);
+	}
+
+	if(source != m_codes.data())
+		m_codes.swap(buffer);
+}
+
+template<uint D, class Word>
+inline void MortonBatch<D, Word>::unique()
+{
+	m_codes.erase(std::unique(m_codes.begin(), m_codes.end()), m_codes.end());
+}
+
+template<uint D, class Word>
+inline void MortonBatch<D, Word>::truncate(uint levelCount)
+{
+	if(levelCount > m_levelCount)
+		throw std::invalid_argument("MortonBatch : cannot truncate to more levels than the codes have");
+
+	const uint shift = D * (m_levelCount - levelCount);
+	const Word mask	 = shift < 8 * sizeof(Word) ? static_cast<Word>(~Word{0} << shift) : Word{0};
+	for(Word& code : m_codes)
+		code &= mask;
+}
+
+} // namespace qotf
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <qotf/morton/CompactMortonCode.hpp>
+#include <qotf/morton/MortonKernels.hpp>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace qotf
+{
+
+/**
+ * Axis-aligned box of cells, whose codes are handled without decoding them
+ *
+ * The codes of a box are not contiguous along the Z-order. The box gives :
+ *   - the next (resp. previous) code of the box after (resp. before) any code,
+ *     with the BIGMIN (resp. LITMAX) algorithm of Tropf and Herzog,
+ *     to skip the codes out of the box in a sorted array of codes
+ *   - a decomposition in intervals of contiguous codes, following the order of the trees,
+ *     with at most a given number of intervals
+ */
+template<uint D, class Word = uint64_t>
+class MortonBox
+{
+	static_assert(!std::is_same_v<Word, DoubleWord>, "MortonBox needs a single word code");
+
+public:
+	using Code	= CompactMortonCode<D, Word>;
+	using Point = typename Code::Point;
+
+	/**
+	 * Interval of codes, both bounds included
+	 */
+	struct Interval
+	{
+		Word first;
+		Word last;
+	};
+
+	/**
+	 * Box between the cells [min] and [max], both included
+	 * Requires :
+	 *   - min[i] <= max[i] for each axis
+	 */
+	MortonBox(const Point& min, const Point& max);
+
+	Word getMinCode() const { return m_minCode; }
+	Word getMaxCode() const { return m_maxCode; }
+
+	bool contains(Word code) const;
+
+	enum class Overlap
+	{
+		Outside,
+		Partial,
+		Inside
+	};
+
+	/**
+	 * Return how the cell of [level] levels whose first code is [prefix] overlaps the box,
+	 * as a node of a tree whose deepest nodes are the cells of level 0
+	 * Requires :
+	 *   - the [level] lowest levels of prefix are zero
+	 */
+	Overlap overlap(Word prefix, uint level) const;
+
+	/**
+	 * Set [next] to the lowest code of the box above [code] (BIGMIN)
+	 * Return false if there is none
+	 * Requires :
+	 *   - code is not in the box
+	 */
+	bool nextInBox(Word code, Word& next) const;
+
+	/**
+	 * Set [previous] to the highest code of the box under [code] (LITMAX)
+	 * Return false if there is none
+	 * Requires :
+	 *   - code is not in the box
+	 */
+	bool previousInBox(Word code, Word& previous) const;
+
+	/**
+	 * Return sorted intervals covering the box, with at most [maxIntervalCount] intervals
+	 * The cells crossing the border of the box are cut level by level while both the intervals
+	 * and these cells stay within the limit, which also bounds the work to the limit times the depth.
+	 * The intervals then cover exactly the box, otherwise they also cover some cells out of it
+	 * Requires :
+	 *   - maxIntervalCount > 0
+	 */
+	std::vector<Interval> decompose(size_t maxIntervalCount) const;
+
+	/**
+	 * Call [visitor] with the iterator of each code of the box in the sorted codes [first, last),
+	 * jumping over the codes out of the box
+	 */
+	template<class Iterator, class Visitor>
+	void visitSorted(Iterator first, Iterator last, Visitor&& visitor) const;
+
+private:
+	static constexpr uint kBitCount = D * Code::kLevelCount;
+
+	static constexpr std::array<uint64_t, D> kAxisMasks = mortonkernels::axisMasks<D, Code::kLevelCount>();
+
+	Word m_minCode;
+	Word m_maxCode;
+
+	/**
+	 * Return the bits under [bit] of the coordinate owning [bit]
+	 */
+	static Word lowerAxisBits(uint bit);
+
+	/**
+	 * Set [bit] and clear the bits under it in its coordinate (resp. the opposite)
+	 */
+	static Word load1000(Word code, uint bit);
+	static Word load0111(Word code, uint bit);
+
+	static Word lowLevelsMask(uint level);
+
+	/**
+	 * Return the sorted and merged intervals of [intervals] and of the cells [cells] of [level] levels
+	 */
+	static std::vector<Interval> merge(std::vector<Interval> intervals, const std::vector<Word>& cells, uint level);
+};
+
+template<uint D, class Word>
+inline MortonBox<D, Word>::MortonBox(const Point& min, const Point& max) :
+	m_minCode(Code(min).getCode()),
+	m_maxCode(Code(max).getCode())
+{
+}
+
+template<uint D, class Word>
+inline bool MortonBox<D, Word>::contains(Word code) const
+{
+	for(uint axis = 0; axis < D; ++axis)
+	{
+		const Word mask = static_cast<Word>(kAxisMasks[axis]);
+		if((code & mask) < (m_minCode & mask) || (code & mask) > (m_maxCode & mask))
+			return false;
+	}
+	return true;
+}
+
+template<uint D, class Word>
+inline Word MortonBox<D, Word>::lowerAxisBits(uint bit)
+{
+	const Word axisMask = static_cast<Word>(kAxisMasks[D - 1 - bit % D]);
+	return axisMask & ((Word{1} << bit) - 1);
+}
+
+template<uint D, class Word>
+inline Word MortonBox<D, Word>::load1000(Word code, uint bit)
+{
+	return (code & ~lowerAxisBits(bit)) | (Word{1} << bit);
+}
+
+template<uint D, class Word>
+inline Word MortonBox<D, Word>::load0111(Word code, uint bit)
+{
+	return (code & ~(Word{1} << bit)) | lowerAxisBits(bit);
+}
+
+template<uint D, class Word>
+inline bool MortonBox<D, Word>::nextInBox(Word code, Word& next) const
+{
+	Word min   = m_minCode;
+	Word max   = m_maxCode;
+	bool found = false;
+
+	for(uint bit = kBitCount; bit-- > 0;)
+	{
+		const uint codeBit = (code >> bit) & 1;
+		const uint minBit  = (min >> bit) & 1;
+		const uint maxBit  = (max >> bit) & 1;
+
+		switch(codeBit << 2 | minBit << 1 | maxBit)
+		{
+		case 0b001:
+			next  = load1000(min, bit);
+			found = true;
+			max	  = load0111(max, bit);
+			break;
+		case 0b011:
+			next = min;
+			return true;
+		case 0b100:
+			return found;
+		case 0b101:
+			min = load1000(min, bit);
+			break;
+		default:
+			// 0b000 and 0b111 go on, 0b010 and 0b110 cannot happen with min <= max
+			break;
+		}
+	}
+	return found;
+}
+
+template<uint D, class Word>
+inline bool MortonBox<D, Word>::previousInBox(Word code, Word& previous) const
+{
+	Word min   = m_minCode;
+	Word max   = m_maxCode;
+	bool found = false;
+
+	for(uint bit = kBitCount; bit-- > 0;)
+	{
+		const uint codeBit = (code >> bit) & 1;
+		const uint minBit  = (min >> bit) & 1;
+		const uint maxBit  = (max >> bit) & 1;
+
+		switch(codeBit << 2 | minBit << 1 | maxBit)
+		{
+		case 0b001:
+			max = load0111(max, bit);
+			break;
+		case 0b011:
+			return found;
+		case 0b100:
+			previous = max;
+			return true;
+		case 0b101:
+			previous = load0111(max, bit);
+			found	 = true;
+			min		 = load1000(min, bit);
+			break;
+		default:
+			break;
+		}
+	}
+	return found;
+}
+
+template<uint D, class Word>
+inline Word MortonBox<D, Word>::lowLevelsMask(uint level)
+{
+	return level >= Code::kLevelCount ? static_cast<Word>(~Word{0}) : static_cast<Word>((uint64_t{1} << (D * level)) - 1);
+}
+
+template<uint D, class Word>
+inline typename MortonBox<D, Word>::Overlap MortonBox<D, Word>::overlap(Word prefix, uint level) const
+{
+	const Word last = prefix | lowLevelsMask(level);
+
+	bool inside = true;
+	for(uint axis = 0; axis < D; ++axis)
+	{
+		const Word mask = static_cast<Word>(kAxisMasks[axis]);
+		if((last & mask) < (m_minCode & mask) || (prefix & mask) > (m_maxCode & mask))
+			return Overlap::Outside;
+
+		inside = inside && (prefix & mask) >= (m_minCode & mask) && (last & mask) <= (m_maxCode & mask);
+	}
+	return inside ? Overlap::Inside : Overlap::Partial;
+}
+
+template<uint D, class Word>
+inline std::vector<typename MortonBox<D, Word>::Interval> MortonBox<D, Word>::merge(std::vector<Interval> intervals, const std::vector<Word>& cells, uint level)
+{
+	for(Word prefix : cells)
+		intervals.push_back({prefix, static_cast<Word>(prefix | lowLevelsMask(level))});
+
+	std::sort(intervals.begin(), intervals.end(), [](const Interval& a, const Interval& b) { return a.first < b.first; });
+
+	std::vector<Interval> merged;
+	for(const Interval& interval : intervals)
+	{
+		if(!merged.empty() && merged.back().last + 1 == interval.first)
+			merged.back().last = interval.last;
+		else
+			merged.push_back(interval);
+	}
+	return merged;
+}
+
+template<uint D, class Word>
+inline std::vector<typename MortonBox<D, Word>::Interval> MortonBox<D, Word>::decompose(size_t maxIntervalCount) const
+{
+	// Start from the smallest cell containing the box
+	uint level = 0;
+	while(level < Code::kLevelCount && (m_minCode & ~lowLevelsMask(level)) != (m_maxCode & ~lowLevelsMask(level)))
+		++level;
+
+	std::vector<Interval> inside;
+	std::vector<Word>	  partial{static_cast<Word>(m_minCode & ~lowLevelsMask(level))};
+	std::vector<Interval> result = merge(inside, partial, level);
+
+	while(level > 0 && !partial.empty())
+	{
+		const uint childLevel = level - 1;
+
+		std::vector<Interval> nextInside = inside;
+		std::vector<Word>	  nextPartial;
+		for(Word cell : partial)
+			for(Word child = 0; child < (Word{1} << D); ++child)
+			{
+				const Word prefix = cell | static_cast<Word>(child << (D * childLevel));
+
+				switch(overlap(prefix, childLevel))
+				{
+				case Overlap::Inside:
+					nextInside.push_back({prefix, static_cast<Word>(prefix | lowLevelsMask(childLevel))});
+					break;
+				case Overlap::Partial:
+					nextPartial.push_back(prefix);
+					break;
+				case Overlap::Outside:
+					break;
+				}
+			}
+
+		if(nextPartial.size() > maxIntervalCount)
+			break;
+
+		std::vector<Interval> nextResult = merge(nextInside, nextPartial, childLevel);
+		if(nextResult.size() > maxIntervalCount)
+			break;
+
+		inside	= std::move(nextInside);
+		partial = std::move(nextPartial);
+		result	= std::move(nextResult);
+		level	= childLevel;
+	}
+	return result;
+}
+
+template<uint D, class Word>
+template<class Iterator, class Visitor>
+inline void MortonBox<D, Word>::visitSorted(Iterator first, Iterator last, Visitor&& visitor) const
+{
+	first = std::lower_bound(first, last, m_minCode);
+
+	while(first != last && *first <= m_maxCode)
+	{
+		if(contains(*first))
+		{
+			visitor(first);
+			++first;
+			continue;
+		}
+
+		Word next;
+		if(!nextInBox(*first, next))
+			return;
+		first = std::lower_bound(first, last, next);
+	}
+}
+
+} // namespace qotf
@@ -2,6 +2,8 @@
 
 #include <qotf/utils/Type.hpp>
 
+#include <type_traits>
+
 namespace qotf
 {
 
@@ -25,4 +27,13 @@ public:
 	virtual uint decode(uint level) const = 0;
 };
 
+/**
+ * Trees take their codes as a template parameter constrained by this alias,
+ * so that the calls to decode of a final code class (like CompactMortonCode)
+ * are resolved and inlined at compile time
+ * Passing a MortonCode<D> keeps the virtual call
+ */
+template<class Code, uint D>
+using EnableIfMortonCode = std::enable_if_t<std::is_base_of_v<MortonCode<D>, Code>>;
+
 } // namespace qotf
\ No newline at end of file
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <qotf/internal/X86Kernels.hpp>
+#include <qotf/utils/Type.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace qotf
+{
+
+/**
+ * Morton encoding and decoding kernels
+ *
+ * With the BMI2 instructions, pdep scatters the bits of a coordinate on the bits
+ * of its axis in the code, and pext gathers them back.
+ * Batches of points are encoded with the magic-mask interleave, several points at once
+ * with AVX2 or AVX-512.
+ */
+namespace mortonkernels
+{
+
+constexpr uint kSplitStepCount = 5;
+
+/**
+ * Masks of the magic-mask interleave : the coordinate is first cut to [bitsMask],
+ * then each step computes x = (x | x << shifts[i]) & masks[i]
+ */
+struct SplitMasks
+{
+	uint64_t							  bitsMask;
+	std::array<uint, kSplitStepCount>	  shifts;
+	std::array<uint64_t, kSplitStepCount> masks;
+};
+
+/**
+ * Coordinate arrays of a batch of points, one array per axis
+ */
+template<uint D>
+using PointArrays = std::array<const uint32_t*, D>;
+
+constexpr uint64_t split(const SplitMasks& splitMasks, uint32_t coord)
+{
+	uint64_t x = coord & splitMasks.bitsMask;
+	for(uint step = 0; step < kSplitStepCount; ++step)
+		x = (x | x << splitMasks.shifts[step]) & splitMasks.masks[step];
+	return x;
+}
+
+/**
+ * Reverse the steps of split
+ * The steps are unrolled : as a loop, the compiler does not unroll it and the decoding gets slower
+ */
+constexpr uint32_t compact(const SplitMasks& splitMasks, uint64_t x)
+{
+	static_assert(kSplitStepCount == 5, "compact unrolls the steps of split");
+
+	x &= splitMasks.masks[4];
+	x = (x | x >> splitMasks.shifts[4]) & splitMasks.masks[3];
+	x = (x | x >> splitMasks.shifts[3]) & splitMasks.masks[2];
+	x = (x | x >> splitMasks.shifts[2]) & splitMasks.masks[1];
+	x = (x | x >> splitMasks.shifts[1]) & splitMasks.masks[0];
+	x = (x | x >> splitMasks.shifts[0]) & splitMasks.bitsMask;
+
+	return static_cast<uint32_t>(x);
+}
+
+/**
+ * Encode the points [first, last) of [points] into [codes]
+ * Word is the type of the codes, uint32_t or uint64_t, the masks cutting the coordinates
+ * to the levels it holds
+ */
+template<uint D, class Word>
+inline void encodeBatchByMasks(const SplitMasks& splitMasks, const PointArrays<D>& points, size_t first, size_t last, Word codes[])
+{
+	for(size_t i = first; i < last; ++i)
+	{
+		uint64_t code = 0;
+		for(uint axis = 0; axis < D; ++axis)
+			code |= split(splitMasks, points[axis][i]) << (D - 1 - axis);
+		codes[i] = static_cast<Word>(code);
+	}
+}
+
+/**
+ * Return the bits of a code of dimension D and [levelCount] levels holding the coordinate [axis]
+ * The first coordinate is on the most significant bit of each group of D bits
+ */
+template<uint D>
+constexpr uint64_t axisMask(uint axis, uint levelCount = 64 / D)
+{
+	uint64_t mask = 0;
+	for(uint bit = 0; bit < levelCount; ++bit)
+		mask |= 1ULL << (bit * D + D - 1 - axis);
+	return mask;
+}
+
+template<uint D, uint LevelCount>
+constexpr std::array<uint64_t, D> axisMasks()
+{
+	std::array<uint64_t, D> masks{};
+	for(uint axis = 0; axis < D; ++axis)
+		masks[axis] = axisMask<D>(axis, LevelCount);
+	return masks;
+}
+
+#if QOTF_X86_KERNELS
+
+/**
+ * Return whether pdep and pext are fast : Zen and Zen 2 run them in microcode
+ */
+inline bool hasFastBmi2()
+{
+	static const bool result = (__builtin_cpu_init(), __builtin_cpu_supports("bmi2") &&
+													  !__builtin_cpu_is("znver1") && !__builtin_cpu_is("znver2"));
+	return result;
+}
+
+template<uint D, uint LevelCount = 64 / D>
+__attribute__((target("bmi2"))) inline uint64_t encodeBmi2(const std::array<uint32_t, D>& coords)
+{
+	constexpr std::array<uint64_t, D> masks = axisMasks<D, LevelCount>();
+
+	uint64_t code = 0;
+	for(uint axis = 0; axis < D; ++axis)
+		code |= _pdep_u64(coords[axis], masks[axis]);
+	return code;
+}
+
+/**
+ * The coordinates are written through a reference : returned by value, the array is packed
+ * in two registers through the stack, and the store forwarding stall costs more than pext
+ */
+template<uint D, uint LevelCount = 64 / D>
+__attribute__((target("bmi2"))) inline void decodeBmi2(uint64_t code, std::array<uint32_t, D>& coords)
+{
+	constexpr std::array<uint64_t, D> masks = axisMasks<D, LevelCount>();
+
+	for(uint axis = 0; axis < D; ++axis)
+		coords[axis] = static_cast<uint32_t>(_pext_u64(code, masks[axis]));
+}
+
+template<uint D, class Word>
+__attribute__((target("avx2"))) inline void encodeBatchAvx2(const SplitMasks& splitMasks, const PointArrays<D>& points, size_t count, Word codes[])
+{
+	constexpr size_t kLaneCount = 4;
+
+	const __m256i bitsMask = _mm256_set1_epi64x(static_cast<long long>(splitMasks.bitsMask));
+
+	__m128i shifts[kSplitStepCount];
+	__m256i masks[kSplitStepCount];
+	for(uint step = 0; step < kSplitStepCount; ++step)
+	{
+		shifts[step] = _mm_cvtsi32_si128(static_cast<int>(splitMasks.shifts[step]));
+		masks[step]	 = _mm256_set1_epi64x(static_cast<long long>(splitMasks.masks[step]));
+	}
+
+	const size_t vectorCount = count - count % kLaneCount;
+	for(size_t i = 0; i < vectorCount; i += kLaneCount)
+	{
+		__m256i code = _mm256_setzero_si256();
+		for(uint axis = 0; axis < D; ++axis)
+		{
+			const __m128i coords = _mm_loadu_si128(reinterpret_cast<const __m128i*>(points[axis] + i));
+
+			__m256i x = _mm256_and_si256(_mm256_cvtepu32_epi64(coords), bitsMask);
+			for(uint step = 0; step < kSplitStepCount; ++step)
+				x = _mm256_and_si256(_mm256_or_si256(x, _mm256_sll_epi64(x, shifts[step])), masks[step]);
+
+			code = _mm256_or_si256(code, _mm256_slli_epi64(x, D - 1 - axis));
+		}
+		if constexpr(sizeof(Word) == sizeof(uint64_t))
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(codes + i), code);
+		else
+		{
+			// Gather the low halves of the lanes
+			const __m256i narrowed = _mm256_permutevar8x32_epi32(code, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(codes + i), _mm256_castsi256_si128(narrowed));
+		}
+	}
+	encodeBatchByMasks<D>(splitMasks, points, vectorCount, count, codes);
+}
+
+// The AVX-512 intrinsics of GCC 12 start from an uninitialized vector, which -Wuninitialized reports
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+template<uint D, class Word>
+__attribute__((target("avx512f"))) inline void encodeBatchAvx512(const SplitMasks& splitMasks, const PointArrays<D>& points, size_t count, Word codes[])
+{
+	constexpr size_t kLaneCount = 8;
+
+	const __m512i bitsMask = _mm512_set1_epi64(static_cast<long long>(splitMasks.bitsMask));
+
+	__m128i shifts[kSplitStepCount];
+	__m512i masks[kSplitStepCount];
+	for(uint step = 0; step < kSplitStepCount; ++step)
+	{
+		shifts[step] = _mm_cvtsi32_si128(static_cast<int>(splitMasks.shifts[step]));
+		masks[step]	 = _mm512_set1_epi64(static_cast<long long>(splitMasks.masks[step]));
+	}
+
+	const size_t vectorCount = count - count % kLaneCount;
+	for(size_t i = 0; i < vectorCount; i += kLaneCount)
+	{
+		__m512i code = _mm512_setzero_si512();
+		for(uint axis = 0; axis < D; ++axis)
+		{
+			const __m256i coords = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(points[axis] + i));
+
+			__m512i x = _mm512_and_si512(_mm512_cvtepu32_epi64(coords), bitsMask);
+			for(uint step = 0; step < kSplitStepCount; ++step)
+				x = _mm512_and_si512(_mm512_or_si512(x, _mm512_sll_epi64(x, shifts[step])), masks[step]);
+
+			code = _mm512_or_si512(code, _mm512_slli_epi64(x, D - 1 - axis));
+		}
+		if constexpr(sizeof(Word) == sizeof(uint64_t))
+			_mm512_storeu_si512(codes + i, code);
+		else
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(codes + i), _mm512_cvtepi64_epi32(code));
+	}
+	encodeBatchByMasks<D>(splitMasks, points, vectorCount, count, codes);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+/**
+ * pdep does not need the masks of the interleave, [splitMasks] is only there to share
+ * the signature of the other batch kernels
+ */
+template<uint D, class Word>
+__attribute__((target("bmi2"))) inline void encodeBatchBmi2([[maybe_unused]] const SplitMasks& splitMasks, const PointArrays<D>& points, size_t count, Word codes[])
+{
+	constexpr uint kLevelCount = 8 * sizeof(Word) / D;
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		std::array<uint32_t, D> coords;
+		for(uint axis = 0; axis < D; ++axis)
+			coords[axis] = points[axis][i];
+		codes[i] = static_cast<Word>(encodeBmi2<D, kLevelCount>(coords));
+	}
+}
+
+#endif
+
+} // namespace mortonkernels
+} // namespace qotf
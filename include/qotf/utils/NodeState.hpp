@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 namespace qotf
 {
 
@@ -11,7 +13,7 @@ namespace qotf
  *  - 0 = Leaf      (non parent/has no children)
  *  - 1 = Composite (parent/has children)
  */
-enum class NodeState : byte
+enum class NodeState : std::uint8_t
 {
 	LeafEmpty		= 0b00,
 	LeafFilled		= 0b01,
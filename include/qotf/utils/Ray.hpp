@@ -0,0 +1,53 @@
+#pragma once
+
+#include <qotf/utils/Type.hpp>
+
+#include <array>
+#include <cstdint>
+
+namespace qotf
+{
+
+/**
+ * Ray in the space of a tree, where a cell of the deepest level is a unit cube
+ * and the tree covers [0, 2^(maxDepth - 1)) on each axis
+ */
+template<uint D>
+struct Ray
+{
+	std::array<double, D> origin;
+
+	/**
+	 * Not null, and not necessarily normalized
+	 */
+	std::array<double, D> direction;
+
+	/**
+	 * Length of the ray, in cells
+	 */
+	double maxDistance;
+};
+
+/**
+ * Leaf hit by a ray
+ */
+template<uint D>
+struct RayHit
+{
+	/**
+	 * Value of the CompactMortonCode<D> of the first cell of the leaf
+	 */
+	uint64_t code;
+
+	/**
+	 * Depth of the leaf, 0 if nothing was hit
+	 */
+	uint depth;
+
+	/**
+	 * Distance from the origin of the ray to the entry point in the leaf
+	 */
+	double distance;
+};
+
+} // namespace qotf
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <qotf/utils/Type.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace qotf
+{
+
+/**
+ * Fixed set of worker threads running the tasks of one job at a time
+ *
+ * run blocks until all the tasks of the job are done, and the calling thread
+ * takes tasks too : a pool of N threads starts N - 1 workers.
+ */
+class ThreadPool
+{
+public:
+	explicit ThreadPool(uint threadCount = std::max(1U, std::thread::hardware_concurrency()));
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&)			 = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * Return the number of threads running the tasks, the calling thread included
+	 */
+	uint getThreadCount() const { return static_cast<uint>(m_workers.size()) + 1; }
+
+	/**
+	 * Call [task] for each index in [0, taskCount), from any thread of the pool
+	 * If a task throws, the tasks not started yet are skipped, and once every thread is done
+	 * the first exception thrown is rethrown by run
+	 * Requires :
+	 *   - run is not called from a task
+	 */
+	void run(uint taskCount, const std::function<void(uint)>& task);
+
+private:
+	std::vector<std::thread> m_workers;
+
+	std::mutex				m_mutex;
+	std::condition_variable m_jobStarted;
+	std::condition_variable m_jobDone;
+
+	const std::function<void(uint)>* m_task = nullptr;
+
+	uint			  m_taskCount	  = 0;
+	std::atomic<uint> m_nextTask	  = 0;
+	uint			  m_busyWorkers	  = 0;
+	uint64_t		  m_jobGeneration = 0;
+	bool			  m_stopping	  = false;
+
+	std::exception_ptr m_exception;
+
+	void workerLoop();
+
+	/**
+	 * Run the tasks of the current job until there is none left,
+	 * or until a task throws : the first exception is kept in m_exception
+	 */
+	void runTasks();
+};
+
+/*****************************
+ * ThreadPool implementation *
+ *****************************/
+
+inline ThreadPool::ThreadPool(uint threadCount)
+{
+	m_workers.reserve(threadCount - 1);
+	for(uint i = 1; i < threadCount; ++i)
+		m_workers.emplace_back([this]() { workerLoop(); });
+}
+
+inline ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_jobStarted.notify_all();
+
+	for(std::thread& worker : m_workers)
+		worker.join();
+}
+
+inline void ThreadPool::run(uint taskCount, const std::function<void(uint)>& task)
+{
+	if(taskCount == 0)
+		return;
+
+	if(m_workers.empty() || taskCount == 1)
+	{
+		for(uint i = 0; i < taskCount; ++i)
+			task(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task		  = &task;
+		m_taskCount	  = taskCount;
+		m_nextTask	  = 0;
+		m_busyWorkers = static_cast<uint>(m_workers.size());
+		m_exception	  = nullptr;
+		++m_jobGeneration;
+	}
+	m_jobStarted.notify_all();
+
+	runTasks();
+
+	// The workers read the task until they are done, so run cannot return before them
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_jobDone.wait(lock, [this]() { return m_busyWorkers == 0; });
+	m_task = nullptr;
+
+	if(m_exception)
+		std::rethrow_exception(std::exchange(m_exception, nullptr));
+}
+
+inline void ThreadPool::runTasks()
+{
+	try
+	{
+		for(uint i = m_nextTask++; i < m_taskCount; i = m_nextTask++)
+			(*m_task)(i);
+	}
+	catch(...)
+	{
+		// Skip the remaining tasks
+		m_nextTask = m_taskCount;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(!m_exception)
+			m_exception = std::current_exception();
+	}
+}
+
+inline void ThreadPool::workerLoop()
+{
+	uint64_t generation = 0;
+
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobStarted.wait(lock, [&]() { return m_stopping || m_jobGeneration != generation; });
+			if(m_stopping)
+				return;
+			generation = m_jobGeneration;
+		}
+
+		runTasks();
+
+		bool isLast;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			isLast = --m_busyWorkers == 0;
+		}
+		if(isLast)
+			m_jobDone.notify_one();
+	}
+}
+
+} // namespace qotf
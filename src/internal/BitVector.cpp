@@ -82,6 +82,30 @@ void BitVector::append(size_t count, bool bit)
 		append<false>(count);
 }
 
+void BitVector::append(const BitVector& bits, size_t index, size_t count)
+{
+	assert(&bits != this);
+
+	append(bits.data(), index, count);
+}
+
+void BitVector::append(const byte bytes[], size_t index, size_t count)
+{
+	const size_t dstIndex = m_size;
+	resize(m_size + count);
+
+	const ByteHelper<const byte* const> src(bytes);
+	ByteHelper<ByteVector>				dst(m_bytes);
+
+	// Copy byte by byte, then the remaining bits one by one
+	const size_t completeByteCount = bitutils::completeByteCount(count);
+	for(size_t i = 0; i < completeByteCount; ++i)
+		dst.setByte(dstIndex + bitutils::bitIndex(i), src.getByte(index + bitutils::bitIndex(i)));
+
+	for(size_t i = bitutils::bitIndex(completeByteCount); i < count; ++i)
+		set(dstIndex + i, src.getBit(index + i));
+}
+
 template<bool bit>
 void BitVector::insert(size_t index, size_t count)
 {
@@ -131,4 +155,13 @@ void BitVector::applyPattern(size_t index, const Pattern& pattern, size_t repeat
 	}
 }
 
+template void BitVector::set<false>(size_t);
+template void BitVector::set<true>(size_t);
+template void BitVector::setMany<false>(size_t, size_t);
+template void BitVector::setMany<true>(size_t, size_t);
+template void BitVector::append<false>(size_t);
+template void BitVector::append<true>(size_t);
+template void BitVector::insert<false>(size_t, size_t);
+template void BitVector::insert<true>(size_t, size_t);
+
 } // namespace qotf::internal
\ No newline at end of file
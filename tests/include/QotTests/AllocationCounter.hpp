@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Count of the allocations of the test program, made through any form of the global operator new
+ * The replacements of the operators are in AllocationCounter.cpp
+ */
+namespace qotf::tests
+{
+
+inline std::atomic<std::size_t> allocationCount{0};
+
+/**
+ * Count the allocations made during its lifetime
+ */
+class AllocationCounter
+{
+public:
+	AllocationCounter() :
+		m_start(allocationCount.load()) {}
+
+	std::size_t count() const { return allocationCount.load() - m_start; }
+
+private:
+	std::size_t m_start;
+};
+
+} // namespace qotf::tests
@@ -2,8 +2,12 @@
 
 #include <catch2/catch.hpp>
 
+#include <qotf/morton/BasicMortonCode.hpp>
 #include <qotf/morton/CompactMortonCode.hpp>
 
+#include <random>
+#include <vector>
+
 namespace qotf
 {
 
@@ -65,4 +69,232 @@ TEST_CASE("Compact Morton Code 3", "[CompactMortonCode<3>]")
 		CHECK(c6.decode(i) == 1);
 }
 
-} // namespace qotf
\ No newline at end of file
+TEST_CASE("Compact Morton Code to point", "[CompactMortonCode]")
+{
+	constexpr CompactMortonCode<3>::Point constant = CompactMortonCode<3>::decodeByMasks(CompactMortonCode<3>::encodeByMasks({63, 0, 2}));
+	static_assert(constant[0] == 63 && constant[1] == 0 && constant[2] == 2);
+
+	std::mt19937 generator(42);
+
+	for(uint i = 0; i < 1000; ++i)
+	{
+		const CompactMortonCode<2>::Point p2 = {static_cast<uint32_t>(generator()), static_cast<uint32_t>(generator())};
+		const CompactMortonCode<3>::Point p3 = {static_cast<uint32_t>(generator() & 0x1FFFFF),
+												static_cast<uint32_t>(generator() & 0x1FFFFF),
+												static_cast<uint32_t>(generator() & 0x1FFFFF)};
+
+		const CompactMortonCode<2> c2(p2);
+		const CompactMortonCode<3> c3(p3);
+
+		// The constructor may use pdep, compare with the magic masks
+		CHECK(c2.getCode() == CompactMortonCode<2>::encodeByMasks(p2));
+		CHECK(c3.getCode() == CompactMortonCode<3>::encodeByMasks(p3));
+
+		CHECK(c2.toPoint() == p2);
+		CHECK(c3.toPoint() == p3);
+		CHECK(CompactMortonCode<2>::decodeByMasks(c2.getCode()) == p2);
+		CHECK(CompactMortonCode<3>::decodeByMasks(c3.getCode()) == p3);
+	}
+}
+
+TEST_CASE("Compact Morton Code batch encoding", "[CompactMortonCode]")
+{
+	using Code = CompactMortonCode<3>;
+
+	// Not a multiple of the vector sizes, to go through the scalar tail
+	constexpr size_t kPointCount = 1003;
+
+	std::mt19937 generator(7);
+
+	std::array<std::vector<uint32_t>, 3> coords;
+	for(std::vector<uint32_t>& axis : coords)
+		for(size_t i = 0; i < kPointCount; ++i)
+			axis.push_back(static_cast<uint32_t>(generator()));
+
+	const mortonkernels::PointArrays<3> points = {coords[0].data(), coords[1].data(), coords[2].data()};
+
+	std::vector<uint64_t> expected;
+	for(size_t i = 0; i < kPointCount; ++i)
+		expected.push_back(Code::encodeByMasks({coords[0][i], coords[1][i], coords[2][i]}));
+
+	std::vector<uint64_t> codes(kPointCount);
+
+	Code::encodeBatch(points, kPointCount, codes.data());
+	CHECK(codes == expected);
+
+	codes.assign(kPointCount, 0);
+	Code::encodeBatchByMasks(points, kPointCount, codes.data());
+	CHECK(codes == expected);
+
+#if QOTF_X86_KERNELS
+	if(__builtin_cpu_supports("bmi2"))
+	{
+		codes.assign(kPointCount, 0);
+		mortonkernels::encodeBatchBmi2<3>(Code::getSplitMasks(), points, kPointCount, codes.data());
+		CHECK(codes == expected);
+	}
+	if(__builtin_cpu_supports("avx2"))
+	{
+		codes.assign(kPointCount, 0);
+		mortonkernels::encodeBatchAvx2<3>(Code::getSplitMasks(), points, kPointCount, codes.data());
+		CHECK(codes == expected);
+	}
+	if(__builtin_cpu_supports("avx512f"))
+	{
+		codes.assign(kPointCount, 0);
+		mortonkernels::encodeBatchAvx512<3>(Code::getSplitMasks(), points, kPointCount, codes.data());
+		CHECK(codes == expected);
+	}
+#endif
+}
+
+TEST_CASE("Compact Morton Code words", "[CompactMortonCode]")
+{
+	static_assert(CompactMortonCode<2, uint32_t>::kLevelCount == 16);
+	static_assert(CompactMortonCode<3, uint32_t>::kLevelCount == 10);
+	static_assert(CompactMortonCode<3>::kLevelCount == 21);
+	static_assert(CompactMortonCode<3, DoubleWord>::kLevelCount == 32);
+
+	std::mt19937 generator(11);
+
+	auto checkWord = [&](auto code, uint32_t coordMask) {
+		using Code = decltype(code);
+
+		for(uint i = 0; i < 1000; ++i)
+		{
+			const typename Code::Point p = {static_cast<uint32_t>(generator()) & coordMask,
+											static_cast<uint32_t>(generator()) & coordMask,
+											static_cast<uint32_t>(generator()) & coordMask};
+
+			const Code					 c(p);
+			const BasicMortonCode<3>	 reference({p[0], p[1], p[2]});
+
+			for(uint level = 0; level < Code::kLevelCount; ++level)
+				CHECK(c.decode(level) == reference.decode(level));
+
+			CHECK(c.getCode() == Code::encodeByMasks(p));
+			CHECK(c.toPoint() == p);
+			CHECK(Code::decodeByMasks(c.getCode()) == p);
+		}
+	};
+
+	checkWord(CompactMortonCode<3, uint32_t>({0, 0, 0}), 0x3FF);
+	checkWord(CompactMortonCode<3, DoubleWord>({0, 0, 0}), 0xFFFFFFFF);
+
+	// Coordinates are cut to the levels of the word
+	CHECK(CompactMortonCode<3, uint32_t>({0x7FF, 0, 0}).toPoint()[0] == 0x3FF);
+
+	// DoubleWord codes compare like integers
+	CHECK(CompactMortonCode<3, DoubleWord>({0x1FFFFF, 0, 0}).getCode() < CompactMortonCode<3, DoubleWord>({0, 0, 1 << 21}).getCode());
+}
+
+TEST_CASE("Compact Morton Code batch encoding of words", "[CompactMortonCode]")
+{
+	constexpr size_t kPointCount = 1003;
+
+	std::mt19937 generator(13);
+
+	std::array<std::vector<uint32_t>, 3> coords;
+	for(std::vector<uint32_t>& axis : coords)
+		for(size_t i = 0; i < kPointCount; ++i)
+			axis.push_back(static_cast<uint32_t>(generator()));
+
+	const mortonkernels::PointArrays<2> points	   = {coords[0].data(), coords[1].data()};
+	const mortonkernels::PointArrays<3> widePoints = {coords[0].data(), coords[1].data(), coords[2].data()};
+
+	std::vector<uint32_t>	narrow(kPointCount);
+	std::vector<DoubleWord> wide(kPointCount);
+
+	CompactMortonCode<2, uint32_t>::encodeBatch(points, kPointCount, narrow.data());
+	CompactMortonCode<3, DoubleWord>::encodeBatch(widePoints, kPointCount, wide.data());
+
+	for(size_t i = 0; i < kPointCount; ++i)
+	{
+		CHECK(narrow[i] == CompactMortonCode<2, uint32_t>({coords[0][i], coords[1][i]}).getCode());
+		CHECK(wide[i] == CompactMortonCode<3, DoubleWord>({coords[0][i], coords[1][i], coords[2][i]}).getCode());
+	}
+
+#if QOTF_X86_KERNELS
+	const mortonkernels::SplitMasks splitMasks = CompactMortonCode<2, uint32_t>::getSplitMasks();
+
+	std::vector<uint32_t> expected(kPointCount);
+	CompactMortonCode<2, uint32_t>::encodeBatchByMasks(points, kPointCount, expected.data());
+
+	if(__builtin_cpu_supports("bmi2"))
+	{
+		mortonkernels::encodeBatchBmi2<2>(splitMasks, points, kPointCount, narrow.data());
+		CHECK(narrow == expected);
+	}
+	if(__builtin_cpu_supports("avx2"))
+	{
+		mortonkernels::encodeBatchAvx2<2>(splitMasks, points, kPointCount, narrow.data());
+		CHECK(narrow == expected);
+	}
+	if(__builtin_cpu_supports("avx512f"))
+	{
+		mortonkernels::encodeBatchAvx512<2>(splitMasks, points, kPointCount, narrow.data());
+		CHECK(narrow == expected);
+	}
+#endif
+}
+
+TEST_CASE("Compact Morton Code dilated arithmetic", "[CompactMortonCode]")
+{
+	std::mt19937 generator(17);
+
+	auto checkWord = [&](auto code) {
+		using Code = decltype(code);
+
+		constexpr uint32_t kCoordMask = (1U << Code::kLevelCount) - 1;
+
+		for(uint i = 0; i < 1000; ++i)
+		{
+			const typename Code::Point p = {static_cast<uint32_t>(generator()) & kCoordMask,
+											static_cast<uint32_t>(generator()) & kCoordMask,
+											static_cast<uint32_t>(generator()) & kCoordMask};
+
+			const Code	   c(p);
+			const uint	   axis	 = generator() % 3;
+			const uint32_t value = static_cast<uint32_t>(generator()) & kCoordMask;
+
+			typename Code::Point expected = p;
+
+			expected[axis] = (p[axis] + value) & kCoordMask;
+			CHECK(c.add(axis, value).getCode() == Code(expected).getCode());
+
+			expected[axis] = (p[axis] - value) & kCoordMask;
+			CHECK(c.subtract(axis, value).getCode() == Code(expected).getCode());
+
+			expected[axis] = (p[axis] + 1) & kCoordMask;
+			CHECK(c.increment(axis).getCode() == Code(expected).getCode());
+
+			expected[axis] = (p[axis] - 1) & kCoordMask;
+			CHECK(c.decrement(axis).getCode() == Code(expected).getCode());
+
+			const Code other({p[0] ^ value, p[1] ^ value, p[2] ^ value});
+			for(uint a = 0; a < 3; ++a)
+			{
+				const uint32_t otherCoord = p[a] ^ value;
+				CHECK((c.compareAxis(a, other) < 0) == (p[a] < otherCoord));
+				CHECK((c.compareAxis(a, other) == 0) == (p[a] == otherCoord));
+			}
+		}
+	};
+
+	checkWord(CompactMortonCode<3>({0, 0, 0}));
+	checkWord(CompactMortonCode<3, uint32_t>({0, 0, 0}));
+
+	// Wrap around the levels of the code
+	CHECK(CompactMortonCode<2, uint32_t>({0xFFFF, 3}).increment(0).toPoint() == CompactMortonCode<2, uint32_t>::Point{0, 3});
+	CHECK(CompactMortonCode<2, uint32_t>({5, 0}).decrement(1).toPoint() == CompactMortonCode<2, uint32_t>::Point{5, 0xFFFF});
+
+	const CompactMortonCode<2> c({0b1011, 0b0110});
+	CHECK(c.parent(2).toPoint() == CompactMortonCode<2>::Point{0b1000, 0b0100});
+	CHECK(c.parent(0).getCode() == c.getCode());
+	CHECK(c.parent(CompactMortonCode<2>::kLevelCount).getCode() == 0);
+	CHECK(c.child(2, 0b01).toPoint() == CompactMortonCode<2>::Point{0b1000, 0b0110});
+	CHECK(c.child(1, 0b10).toPoint() == CompactMortonCode<2>::Point{0b1011, 0b0110});
+	CHECK(CompactMortonCode<2>::fromCode(c.getCode()).toPoint() == c.toPoint());
+}
+
+} // namespace qotf
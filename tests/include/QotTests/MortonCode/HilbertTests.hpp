@@ -0,0 +1,84 @@
+#pragma once
+
+#include <catch2/catch.hpp>
+
+#include <qotf/binary/BinNTree.hpp>
+#include <qotf/morton/CompactMortonCode.hpp>
+#include <qotf/morton/HilbertCode.hpp>
+
+#include <cstdlib>
+#include <random>
+
+namespace qotf
+{
+
+/**
+ * Check that the cells of a grid of [levelCount] levels, taken along the curve,
+ * are all visited and that each one is a neighbour of the previous one
+ */
+template<uint D>
+void checkHilbertCurve(uint levelCount)
+{
+	using Code = HilbertCode<D>;
+
+	// The grid is the corner of the curve at the origin, the index of its first cell
+	// is the index of the origin
+	const uint64_t first	 = Code(typename Code::Point{}).getCode();
+	const uint64_t cellCount = 1ULL << (D * levelCount);
+
+	typename Code::Point previous = CompactMortonCode<D>::decodeByMasks(Code::toMorton(first));
+	for(uint64_t index = first + 1; index < first + cellCount; ++index)
+	{
+		const uint64_t			   mortonCode = Code::toMorton(index);
+		const typename Code::Point point	  = CompactMortonCode<D>::decodeByMasks(mortonCode);
+
+		REQUIRE(Code::fromMorton(mortonCode) == index);
+
+		uint distance = 0;
+		for(uint i = 0; i < D; ++i)
+		{
+			REQUIRE(point[i] < (1U << levelCount));
+			distance += std::abs(static_cast<int>(point[i]) - static_cast<int>(previous[i]));
+		}
+		REQUIRE(distance == 1);
+
+		previous = point;
+	}
+}
+
+TEST_CASE("Hilbert Code curve", "[HilbertCode]")
+{
+	checkHilbertCurve<2>(5);
+	checkHilbertCurve<3>(4);
+}
+
+TEST_CASE("Hilbert Code decode", "[HilbertCode]")
+{
+	std::mt19937 generator(3);
+
+	for(uint i = 0; i < 1000; ++i)
+	{
+		const HilbertCode<3>::Point p = {static_cast<uint32_t>(generator() & 0x1FFFFF),
+										 static_cast<uint32_t>(generator() & 0x1FFFFF),
+										 static_cast<uint32_t>(generator() & 0x1FFFFF)};
+
+		const HilbertCode<3>	   hilbert(p);
+		const CompactMortonCode<3> morton(p);
+
+		for(uint level = 0; level < HilbertCode<3>::kLevelCount; ++level)
+			CHECK(hilbert.decode(level) == morton.decode(level));
+
+		CHECK(hilbert.toPoint() == p);
+		CHECK(HilbertCode<3>::toMorton(hilbert.getCode()) == morton.getCode());
+	}
+
+	BinNTree<2> quadtree(4);
+
+	const HilbertCode<2> code({5, 2});
+	quadtree.setNode(code, 4);
+	CHECK(quadtree.getNodeState(code, 4) == NodeState::LeafFilled);
+	CHECK(quadtree.getNodeState(CompactMortonCode<2>({5, 2}), 4) == NodeState::LeafFilled);
+	CHECK(quadtree.getNodeState(CompactMortonCode<2>({5, 3}), 4) == NodeState::LeafEmpty);
+}
+
+} // namespace qotf
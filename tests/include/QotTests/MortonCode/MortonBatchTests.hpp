@@ -0,0 +1,123 @@
+#pragma once
+
+#include <catch2/catch.hpp>
+
+#include <qotf/binary/BinNTree.hpp>
+#include <qotf/morton/MortonBatch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace qotf
+{
+
+TEST_CASE("Morton Batch sort", "[MortonBatch]")
+{
+	std::mt19937 generator(15);
+	ThreadPool	 pool(4);
+
+	for(size_t count : {0, 1, 100, 5000, 100000})
+	{
+		MortonBatch<3> batch(12);
+		MortonBatch<3> parallelBatch(12);
+		for(size_t i = 0; i < count; ++i)
+		{
+			// Few distinct coordinates, to get duplicates
+			const MortonBatch<3>::Point p = {static_cast<uint32_t>(generator() & 0xFFF),
+											 static_cast<uint32_t>(generator() & 0xFFF),
+											 static_cast<uint32_t>(generator() & 0x7)};
+			batch.add(p);
+			parallelBatch.add(p);
+		}
+
+		std::vector<uint64_t> expected(batch.begin(), batch.end());
+		std::sort(expected.begin(), expected.end());
+
+		batch.sort();
+		parallelBatch.sort(pool);
+		CHECK(std::vector<uint64_t>(batch.begin(), batch.end()) == expected);
+		CHECK(std::vector<uint64_t>(parallelBatch.begin(), parallelBatch.end()) == expected);
+
+		expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+		batch.unique();
+		CHECK(std::vector<uint64_t>(batch.begin(), batch.end()) == expected);
+	}
+
+	MortonBatch<2, uint32_t> words(16);
+	for(uint i = 0; i < 10000; ++i)
+		words.add({static_cast<uint32_t>(generator() & 0xFFFF), static_cast<uint32_t>(generator() & 0xFFFF)});
+	words.sort(pool);
+	CHECK(std::is_sorted(words.begin(), words.end()));
+}
+
+TEST_CASE("Morton Batch truncate", "[MortonBatch]")
+{
+	MortonBatch<2> batch(3);
+	batch.add({0, 0});
+	batch.add({1, 1});
+	batch.add({2, 1});
+	batch.add({7, 6});
+	batch.sort();
+
+	// Keep the highest level, the codes of the quadrants
+	batch.truncate(1);
+	batch.unique();
+
+	CHECK(batch.getLevelCount() == 3);
+	REQUIRE(batch.size() == 2);
+	CHECK(batch[0] == CompactMortonCode<2>({0, 0}).getCode());
+	CHECK(batch[1] == CompactMortonCode<2>({4, 4}).getCode());
+
+	// The truncated codes are the quadrants of the same tree, at depth 2
+	BinNTree<2> tree(4);
+	tree.setNodes(batch.codesBegin(), batch.codesEnd(), 2);
+	CHECK(tree.getNodeState(CompactMortonCode<2>({0, 0}), 2) == NodeState::LeafFilled);
+	CHECK(tree.getNodeState(CompactMortonCode<2>({4, 0}), 2) == NodeState::LeafEmpty);
+	CHECK(tree.getNodeState(CompactMortonCode<2>({4, 4}), 2) == NodeState::LeafFilled);
+
+	std::vector<NodeState> states(batch.size());
+	tree.getNodeStates(batch, 2, states.data());
+	CHECK(states == std::vector<NodeState>(2, NodeState::LeafFilled));
+
+	CHECK_THROWS_AS(batch.truncate(4), std::invalid_argument);
+	CHECK_THROWS_AS(MortonBatch<3>(22), std::invalid_argument);
+}
+
+TEST_CASE("Thread Pool", "[ThreadPool]")
+{
+	ThreadPool pool(3);
+	CHECK(pool.getThreadCount() == 3);
+
+	for(uint job = 0; job < 20; ++job)
+	{
+		std::vector<uint> results(1000, 0);
+		pool.run(static_cast<uint>(results.size()), [&](uint task) { results[task] += task; });
+
+		for(uint i = 0; i < results.size(); ++i)
+			REQUIRE(results[i] == i);
+	}
+
+	// Whichever thread runs the failing tasks, run waits for the others and rethrows
+	for(uint job = 0; job < 20; ++job)
+	{
+		std::atomic<uint> doneCount = 0;
+		CHECK_THROWS_AS(pool.run(1000,
+								 [&](uint task) {
+									 if(task % 100 == job)
+										 throw std::runtime_error("task");
+									 ++doneCount;
+								 }),
+						std::runtime_error);
+		CHECK(doneCount < 1000);
+	}
+
+	// The pool still runs jobs after an exception
+	std::atomic<uint> sum = 0;
+	pool.run(100, [&](uint task) { sum += task; });
+	CHECK(sum == 4950);
+}
+
+} // namespace qotf
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <catch2/catch.hpp>
+
+#include <qotf/morton/MortonBox.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace qotf
+{
+
+/**
+ * Compare a random box of a grid of [levelCount] levels with the codes of all the cells of the grid
+ */
+template<uint D, class Word>
+void checkMortonBox(std::mt19937& generator, uint levelCount)
+{
+	using Box  = MortonBox<D, Word>;
+	using Code = typename Box::Code;
+
+	std::uniform_int_distribution<uint32_t> coord(0, (1U << levelCount) - 1);
+
+	typename Code::Point min, max;
+	for(uint i = 0; i < D; ++i)
+	{
+		min[i] = coord(generator);
+		max[i] = coord(generator);
+		if(min[i] > max[i])
+			std::swap(min[i], max[i]);
+	}
+	const Box box(min, max);
+
+	const Word		  cellCount = Word{1} << (D * levelCount);
+	std::vector<Word> inside;
+	for(Word code = 0; code < cellCount; ++code)
+	{
+		const typename Code::Point p = Code::decodeByMasks(code);
+
+		bool contained = true;
+		for(uint i = 0; i < D; ++i)
+			contained = contained && min[i] <= p[i] && p[i] <= max[i];
+
+		REQUIRE(box.contains(code) == contained);
+		if(contained)
+			inside.push_back(code);
+	}
+
+	for(Word code = 0; code < cellCount; ++code)
+	{
+		if(box.contains(code))
+			continue;
+
+		const auto next = std::upper_bound(inside.begin(), inside.end(), code);
+		Word	   bigMin;
+		REQUIRE(box.nextInBox(code, bigMin) == (next != inside.end()));
+		if(next != inside.end())
+			REQUIRE(bigMin == *next);
+
+		const auto previous = std::lower_bound(inside.begin(), inside.end(), code);
+		Word	   litMax;
+		REQUIRE(box.previousInBox(code, litMax) == (previous != inside.begin()));
+		if(previous != inside.begin())
+			REQUIRE(litMax == *(previous - 1));
+	}
+
+	// Exact decomposition
+	const std::vector<typename Box::Interval> intervals = box.decompose(cellCount);
+	std::vector<Word>						  covered;
+	for(const typename Box::Interval& interval : intervals)
+	{
+		REQUIRE(interval.first <= interval.last);
+		if(!covered.empty())
+			REQUIRE(covered.back() + 1 < interval.first);
+		for(Word code = interval.first; code <= interval.last; ++code)
+			covered.push_back(code);
+	}
+	REQUIRE(covered == inside);
+
+	// Limited decomposition, covering the box with some more cells
+	for(size_t limit : {1, 2, 5})
+	{
+		const std::vector<typename Box::Interval> coarse = box.decompose(limit);
+		REQUIRE(coarse.size() <= limit);
+		for(Word code : inside)
+			REQUIRE(std::any_of(coarse.begin(), coarse.end(), [code](const typename Box::Interval& interval) {
+				return interval.first <= code && code <= interval.last;
+			}));
+	}
+
+	// Every other cell of the grid, visited with jumps
+	std::vector<Word> codes;
+	for(Word code = 0; code < cellCount; code += 2)
+		codes.push_back(code);
+
+	std::vector<Word> visited;
+	box.visitSorted(codes.begin(), codes.end(), [&](typename std::vector<Word>::const_iterator it) { visited.push_back(*it); });
+
+	std::vector<Word> expected;
+	std::copy_if(inside.begin(), inside.end(), std::back_inserter(expected), [](Word code) { return code % 2 == 0; });
+	REQUIRE(visited == expected);
+}
+
+TEST_CASE("Morton Box", "[MortonBox]")
+{
+	std::mt19937 generator(14);
+
+	for(uint i = 0; i < 50; ++i)
+	{
+		checkMortonBox<2, uint64_t>(generator, 5);
+		checkMortonBox<3, uint64_t>(generator, 3);
+		checkMortonBox<3, uint32_t>(generator, 3);
+	}
+
+	// Box of the deepest cells of the whole grid
+	const MortonBox<3>::Point max = {0x1FFFFF, 0x1FFFFF, 0x1FFFFF};
+	const MortonBox<3>		  box({1, 0, 0}, max);
+
+	const std::vector<MortonBox<3>::Interval> intervals = box.decompose(1000);
+	CHECK(intervals.back().last == ~uint64_t{0} >> 1);
+
+	uint64_t next;
+	CHECK(box.nextInBox(0, next));
+	CHECK(next == 0b100);
+}
+
+} // namespace qotf
@@ -2,8 +2,20 @@
 
 #include <catch2/catch.hpp>
 
+#include <QotTests/AllocationCounter.hpp>
+
 #include <qotf/morton/CompactMortonCode.hpp>
+#include <qotf/morton/MortonBox.hpp>
 #include <qotf/binary/BinNTree.hpp>
+#include <qotf/binary/BinNTreeBuilder.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
 
 /**
  *
@@ -49,6 +61,46 @@ namespace qotf
 
 using BinQuadtree = BinNTree<2>;
 
+/**
+ * Apply the same [editCount] random edits to [tree] and [others] : two edits out of three set a node,
+ * the others remove one, at a depth between [minDepth] and the depth of the trees
+ */
+template<uint D, class BitArray, class... Trees>
+void editRandomly(std::mt19937& random, uint editCount, uint minDepth, BinNTree<D, BitArray>& tree, Trees&... others)
+{
+	const uint treeDiv = 1 << (tree.getDepth() - 1);
+	for(uint j = 0; j < editCount; ++j)
+	{
+		typename CompactMortonCode<D>::Point point;
+		for(uint32_t& coordinate : point)
+			coordinate = random() % treeDiv;
+
+		const CompactMortonCode<D> c(point);
+		const uint				   depth = minDepth + random() % (tree.getDepth() - minDepth + 1);
+		if(j % 3)
+		{
+			tree.setNode(c, depth);
+			(others.setNode(c, depth), ...);
+		}
+		else
+		{
+			tree.removeNode(c, depth);
+			(others.removeNode(c, depth), ...);
+		}
+	}
+}
+
+/**
+ * A tree of [depth] built by [editCount] random edits below its root
+ */
+template<uint D>
+BinNTree<D> makeRandomTree(std::mt19937& random, uint depth, uint editCount)
+{
+	BinNTree<D> tree(depth);
+	editRandomly(random, editCount, 2, tree);
+	return tree;
+}
+
 TEST_CASE("BinNTree init node", "[BinNTree]")
 {
 	BinQuadtree			 quadtree(3);
@@ -241,4 +293,886 @@ TEST_CASE("BinNTree node remove optimization", "[BinNTree]")
 	CHECK(quadtree.getNodeState(c, 1) == NodeState::LeafEmpty);
 }
 
-} // namespace qotf
\ No newline at end of file
+TEST_CASE("BinNTree subtree index", "[BinNTree]")
+{
+	constexpr uint kDepth	= 7;
+	constexpr uint kTreeDiv = 1 << (kDepth - 1);
+
+	BinQuadtree plainTree(kDepth);
+	BinQuadtree indexedTree(kDepth);
+	indexedTree.setSubtreeIndexEnabled(true);
+
+	REQUIRE_FALSE(plainTree.isSubtreeIndexEnabled());
+	REQUIRE(indexedTree.isSubtreeIndexEnabled());
+
+	std::mt19937 random(42);
+	editRandomly(random, 3000, kDepth - 2, plainTree, indexedTree);
+
+	REQUIRE(plainTree.getNodeCount() == indexedTree.getNodeCount());
+	REQUIRE(indexedTree.getNodeCount() > 1000);
+
+	// An index built on an existing tree, then coarse edits growing and removing subtrees of several blocks
+	BinQuadtree lateTree = plainTree;
+	lateTree.setSubtreeIndexEnabled(true);
+	editRandomly(random, 300, 1, plainTree, indexedTree, lateTree);
+
+	REQUIRE(plainTree.getNodeCount() == indexedTree.getNodeCount());
+	REQUIRE(plainTree.getNodeCount() == lateTree.getNodeCount());
+
+	for(uint x = 0; x < kTreeDiv; ++x)
+		for(uint y = 0; y < kTreeDiv; ++y)
+		{
+			const CompactMortonCode<2> c({x, y});
+			for(uint d = 1; d <= kDepth; ++d)
+			{
+				CHECK(indexedTree.getNodeState(c, d) == plainTree.getNodeState(c, d));
+				CHECK(lateTree.getNodeState(c, d) == plainTree.getNodeState(c, d));
+			}
+		}
+}
+
+TEST_CASE("BinNTree set nodes", "[BinNTree]")
+{
+	constexpr uint kDepth	= 6;
+	constexpr uint kTreeDiv = 1 << (kDepth - 1);
+
+	// Morton order of the cells at [depth]
+	auto mortonLess = [](uint depth) {
+		return [depth](const CompactMortonCode<2>& a, const CompactMortonCode<2>& b) {
+			for(uint level = kDepth - 1; level >= kDepth - depth + 1; --level)
+				if(a.decode(level - 1) != b.decode(level - 1))
+					return a.decode(level - 1) < b.decode(level - 1);
+			return false;
+		};
+	};
+
+	std::mt19937 random(7);
+
+	for(uint i = 0; i < 20; ++i)
+	{
+		BinQuadtree expectedTree(kDepth);
+		BinQuadtree batchTree(kDepth);
+
+		// Some existing nodes, both filled and removed
+		editRandomly(random, 40, 2, expectedTree, batchTree);
+
+		const uint						  depth = 1 + random() % kDepth;
+		std::vector<CompactMortonCode<2>> codes;
+		for(uint j = 0; j < 1 + random() % 200; ++j)
+			codes.emplace_back(CompactMortonCode<2>::Point{static_cast<uint>(random() % kTreeDiv), static_cast<uint>(random() % kTreeDiv)});
+		std::sort(codes.begin(), codes.end(), mortonLess(depth));
+
+		for(const CompactMortonCode<2>& c : codes)
+			expectedTree.setNode(c, depth);
+		batchTree.setNodes(codes.begin(), codes.end(), depth);
+
+		REQUIRE(batchTree.getNodeCount() == expectedTree.getNodeCount());
+		for(uint x = 0; x < kTreeDiv; ++x)
+			for(uint y = 0; y < kTreeDiv; ++y)
+			{
+				const CompactMortonCode<2> c({x, y});
+				for(uint d = 1; d <= kDepth; ++d)
+					CHECK(batchTree.getNodeState(c, d) == expectedTree.getNodeState(c, d));
+			}
+	}
+}
+
+TEST_CASE("BinNTree batched node states", "[BinNTree]")
+{
+	constexpr uint kDepth	= 6;
+	constexpr uint kTreeDiv = 1 << (kDepth - 1);
+
+	std::mt19937 random(16);
+
+	for(uint i = 0; i < 20; ++i)
+	{
+		BinQuadtree quadtree(kDepth);
+		quadtree.setSubtreeIndexEnabled(i % 2);
+		editRandomly(random, 60, 2, quadtree);
+
+		MortonBatch<2> codes(kDepth - 1);
+		for(uint j = 0; j < 1 + random() % 300; ++j)
+			codes.add({static_cast<uint>(random() % kTreeDiv), static_cast<uint>(random() % kTreeDiv)});
+
+		for(uint depth = 1; depth <= kDepth; ++depth)
+		{
+			// Any order
+			std::vector<NodeState> states(codes.size());
+			quadtree.getNodeStates(codes, depth, states.data());
+			for(size_t j = 0; j < codes.size(); ++j)
+				REQUIRE(states[j] == quadtree.getNodeState(CompactMortonCode<2>::fromCode(codes[j]), depth));
+
+			// Sorted, with duplicates
+			MortonBatch<2> sorted = codes;
+			sorted.sort();
+
+			std::vector<NodeState> sortedStates(sorted.size());
+			quadtree.getNodeStates(sorted.codesBegin(), sorted.codesEnd(), depth, sortedStates.data());
+			for(size_t j = 0; j < sorted.size(); ++j)
+				REQUIRE(sortedStates[j] == quadtree.getNodeState(CompactMortonCode<2>::fromCode(sorted[j]), depth));
+		}
+	}
+}
+
+TEST_CASE("BinNTree parallel node states", "[BinNTree]")
+{
+	constexpr uint kDepth	= 8;
+	constexpr uint kTreeDiv = 1 << (kDepth - 1);
+
+	std::mt19937 random(17);
+	ThreadPool	 pool(4);
+
+	for(bool indexEnabled : {false, true})
+	{
+		BinNTree<3> octree = makeRandomTree<3>(random, kDepth, 2000);
+
+		octree.setSubtreeIndexEnabled(indexEnabled);
+
+		MortonBatch<3> codes(kDepth - 1);
+		for(uint j = 0; j < 20000; ++j)
+			codes.add({static_cast<uint>(random() % kTreeDiv), static_cast<uint>(random() % kTreeDiv), static_cast<uint>(random() % kTreeDiv)});
+
+		std::vector<NodeState> expected(codes.size());
+		octree.getNodeStates(codes, kDepth, expected.data());
+
+		std::vector<NodeState> states(codes.size());
+		octree.getNodeStates(codes, kDepth, states.data(), pool);
+		CHECK(states == expected);
+
+		MortonBatch<3> sorted = codes;
+		sorted.sort(pool);
+		octree.getNodeStates(sorted, kDepth - 2, expected.data());
+		octree.getNodeStates(sorted.codesBegin(), sorted.codesEnd(), kDepth - 2, states.data(), pool);
+		CHECK(states == expected);
+	}
+}
+
+TEST_CASE("BinNTree concurrent reads", "[BinNTree]")
+{
+	constexpr uint kDepth		= 8;
+	constexpr uint kTreeDiv		= 1 << (kDepth - 1);
+	constexpr uint kThreadCount = 4;
+
+	std::mt19937 random(23);
+
+	// The index and the volume summary are updated by the edits, and the answers come from a tree without them
+	BinNTree<3> plainTree(kDepth);
+	BinNTree<3> octree(kDepth);
+	octree.setSubtreeIndexEnabled(true);
+	octree.setVolumeSummaryEnabled(true);
+	editRandomly(random, 6000, kDepth - 3, octree, plainTree);
+	REQUIRE(octree.getNodeCount() > 10000);
+
+	MortonBatch<3> codes(kDepth - 1);
+	for(uint j = 0; j < 20000; ++j)
+		codes.add({static_cast<uint>(random() % kTreeDiv), static_cast<uint>(random() % kTreeDiv), static_cast<uint>(random() % kTreeDiv)});
+
+	std::vector<NodeState> expected(codes.size());
+	plainTree.getNodeStates(codes, kDepth, expected.data());
+
+	const MortonBox<3> box({3, 10, 20}, {90, 100, 127});
+
+	// Half of the threads read a node at a time, the other half on their own pool
+	std::vector<std::vector<NodeState>> states(kThreadCount, std::vector<NodeState>(codes.size()));
+	std::vector<uint64_t>				volumes(kThreadCount);
+	std::vector<uint64_t>				boxVolumes(kThreadCount);
+	std::vector<std::thread>			threads;
+	for(uint thread = 0; thread < kThreadCount; ++thread)
+		threads.emplace_back([&, thread]() {
+			volumes[thread]	   = octree.filledVolume();
+			boxVolumes[thread] = octree.countFilled(box);
+			if(thread % 2)
+			{
+				ThreadPool pool(2);
+				octree.getNodeStates(codes, kDepth, states[thread].data(), pool);
+				return;
+			}
+			for(size_t j = 0; j < codes.size(); ++j)
+				states[thread][j] = octree.getNodeState(codes.codesBegin()[j], kDepth);
+		});
+	for(std::thread& thread : threads)
+		thread.join();
+
+	for(const std::vector<NodeState>& threadStates : states)
+		CHECK(threadStates == expected);
+	CHECK(volumes == std::vector<uint64_t>(kThreadCount, plainTree.filledVolume()));
+	CHECK(boxVolumes == std::vector<uint64_t>(kThreadCount, plainTree.countFilled(box)));
+}
+
+TEST_CASE("BinNTree cursor", "[BinNTree]")
+{
+	constexpr uint kDepth	= 6;
+	constexpr uint kTreeDiv = 1 << (kDepth - 1);
+
+	std::mt19937 random(18);
+
+	for(uint i = 0; i < 10; ++i)
+	{
+		BinQuadtree quadtree(kDepth);
+		quadtree.setSubtreeIndexEnabled(i % 2);
+		editRandomly(random, 60, 2, quadtree);
+
+		// Depth-first traversal
+		BinQuadtree::Cursor cursor(quadtree);
+		uint				nodeCount = 0;
+		uint				leafCount = 0;
+		bool				done	  = false;
+		while(!done)
+		{
+			++nodeCount;
+			if(cursor.firstChild())
+				continue;
+
+			++leafCount;
+			const CompactMortonCode<2> corner(cursor.getCorner());
+			REQUIRE(quadtree.getNodeState(corner, cursor.getDepth()) == cursor.getState());
+
+			while(!cursor.nextSibling())
+				if(!cursor.parent())
+				{
+					done = true;
+					break;
+				}
+		}
+		CHECK(nodeCount == quadtree.getNodeCount());
+		CHECK(cursor.getDepth() == 1);
+		CHECK(leafCount == 1 + (nodeCount - 1) * 3 / 4);
+
+		// Seeks in any order
+		for(uint j = 0; j < 500; ++j)
+		{
+			const CompactMortonCode<2> c({static_cast<uint>(random() % kTreeDiv), static_cast<uint>(random() % kTreeDiv)});
+			const uint				   depth = 1 + random() % kDepth;
+
+			REQUIRE(cursor.seek(c, depth) == quadtree.getNodeState(c, depth));
+			REQUIRE(cursor.getDepth() <= depth);
+
+			// The cursor is on the node containing the cell
+			const CompactMortonCode<2>::Point corner = cursor.getCorner();
+			const uint						  size	 = 1 << (kDepth - cursor.getDepth());
+			const CompactMortonCode<2>::Point cell	 = c.toPoint();
+			for(uint axis = 0; axis < 2; ++axis)
+				REQUIRE((corner[axis] <= cell[axis] && cell[axis] < corner[axis] + size));
+		}
+	}
+
+	// 32 levels under the root, the width of the coordinates
+	BinQuadtree				   deepTree(33);
+	const CompactMortonCode<2> deepCell({0x8000'0005, 0xFFFF'FFFF});
+	deepTree.setNode(deepCell, 33);
+
+	BinQuadtree::Cursor deepCursor(deepTree);
+	REQUIRE(deepCursor.seek(deepCell, 33) == NodeState::LeafFilled);
+	CHECK(deepCursor.getCorner() == deepCell.toPoint());
+
+	BinNTree<3>			tooDeepTree(34);
+	BinNTree<3>::Cursor tooDeepCursor(tooDeepTree);
+	CHECK_THROWS_AS(tooDeepCursor.getCorner(), std::invalid_argument);
+}
+
+TEST_CASE("BinNTree allocation-free edits", "[BinNTree]")
+{
+	constexpr uint kDepth	= 7;
+	constexpr uint kTreeDiv = 1 << (kDepth - 1);
+
+	std::mt19937 random(19);
+
+	std::vector<CompactMortonCode<3>> codes;
+	for(uint i = 0; i < 300; ++i)
+		codes.emplace_back(CompactMortonCode<3>::Point{static_cast<uint>(random() % kTreeDiv), static_cast<uint>(random() % kTreeDiv),
+													   static_cast<uint>(random() % kTreeDiv)});
+
+	// Every form of operator new is counted
+	{
+		constexpr std::align_val_t kAlignment{64};
+
+		const tests::AllocationCounter counter;
+		::operator delete(::operator new(8));
+		::operator delete[](::operator new[](8));
+		::operator delete(::operator new(8, std::nothrow), std::nothrow);
+
+		void* aligned = ::operator new(8, kAlignment);
+		CHECK(reinterpret_cast<std::uintptr_t>(aligned) % 64 == 0);
+		::operator delete(aligned, kAlignment);
+		::operator delete[](::operator new[](8, kAlignment), kAlignment);
+		::operator delete(::operator new(8, kAlignment, std::nothrow), kAlignment, std::nothrow);
+		CHECK(counter.count() == 6);
+	}
+
+	BinNTree<3> octree(kDepth);
+
+	auto setAndRemove = [&]() {
+		for(const CompactMortonCode<3>& c : codes)
+			octree.setNode(c, kDepth);
+		for(const CompactMortonCode<3>& c : codes)
+			octree.removeNode(c, kDepth);
+	};
+
+	// The first edits grow the nodes to their largest size
+	setAndRemove();
+	{
+		const tests::AllocationCounter counter;
+		setAndRemove();
+		CHECK(counter.count() == 0);
+	}
+	CHECK(octree.getNodeCount() == 1);
+
+	std::sort(codes.begin(), codes.end(), [](const CompactMortonCode<3>& a, const CompactMortonCode<3>& b) { return a.getCode() < b.getCode(); });
+
+	// The bulk edits reuse the previous nodes as their output
+	auto setAllAndRemove = [&]() {
+		octree.setNodes(codes.begin(), codes.end(), kDepth);
+		for(const CompactMortonCode<3>& c : codes)
+			octree.removeNode(c, kDepth);
+	};
+
+	setAllAndRemove();
+	setAllAndRemove();
+	{
+		const tests::AllocationCounter counter;
+		setAllAndRemove();
+		CHECK(counter.count() == 0);
+	}
+	CHECK(octree.getNodeCount() == 1);
+
+	CHECK_THROWS_AS(BinNTree<3>(BinNTree<3>::kMaxDepth + 1), std::invalid_argument);
+}
+
+TEST_CASE("BinNTree deferred collapse", "[BinNTree]")
+{
+	constexpr uint kDepth	= 6;
+	constexpr uint kTreeDiv = 1 << (kDepth - 1);
+
+	std::mt19937 random(20);
+
+	for(uint i = 0; i < 20; ++i)
+	{
+		BinQuadtree expectedTree(kDepth);
+		BinQuadtree deferredTree(kDepth);
+		deferredTree.setCollapseDeferred(true);
+		editRandomly(random, 300, 2, expectedTree, deferredTree);
+		CHECK(deferredTree.hasPendingCollapse());
+		CHECK(deferredTree.getNodeCount() >= expectedTree.getNodeCount());
+
+		// The cells have the same state before the collapse
+		for(uint x = 0; x < kTreeDiv; ++x)
+			for(uint y = 0; y < kTreeDiv; ++y)
+			{
+				const CompactMortonCode<2> c({x, y});
+				REQUIRE(deferredTree.getNodeState(c, kDepth) == expectedTree.getNodeState(c, kDepth));
+			}
+
+		deferredTree.compact();
+		CHECK_FALSE(deferredTree.hasPendingCollapse());
+		REQUIRE(deferredTree.getNodeCount() == expectedTree.getNodeCount());
+		for(uint x = 0; x < kTreeDiv; ++x)
+			for(uint y = 0; y < kTreeDiv; ++y)
+			{
+				const CompactMortonCode<2> c({x, y});
+				for(uint d = 1; d <= kDepth; ++d)
+					REQUIRE(deferredTree.getNodeState(c, d) == expectedTree.getNodeState(c, d));
+			}
+	}
+
+	// A whole group filled one cell at a time collapses to its parent
+	BinQuadtree quadtree(3);
+	quadtree.setCollapseDeferred(true);
+	for(uint x = 0; x < 4; ++x)
+		for(uint y = 0; y < 4; ++y)
+			quadtree.setNode(CompactMortonCode<2>({x, y}), 3);
+	CHECK(quadtree.getNodeCount() == 21);
+	CHECK(quadtree.getNodeState(CompactMortonCode<2>({0, 0}), 1) == NodeState::CompositeEmpty);
+
+	quadtree.setCollapseDeferred(false);
+	CHECK(quadtree.getNodeCount() == 1);
+	CHECK(quadtree.getNodeState(CompactMortonCode<2>({0, 0}), 1) == NodeState::LeafFilled);
+}
+
+TEST_CASE("BinNTree set operations", "[BinNTree]")
+{
+	constexpr uint kDepth	= 6;
+	constexpr uint kTreeDiv = 1 << (kDepth - 1);
+
+	std::mt19937 random(21);
+
+	// Check [result] against a tree filled cell by cell
+	auto checkOperation = [&](const BinQuadtree& result, const BinQuadtree& a, const BinQuadtree& b, auto&& operation) {
+		BinQuadtree expectedTree(kDepth);
+		for(uint x = 0; x < kTreeDiv; ++x)
+			for(uint y = 0; y < kTreeDiv; ++y)
+			{
+				const CompactMortonCode<2> c({x, y});
+				const bool				   inA = a.getNodeState(c, kDepth) == NodeState::LeafFilled;
+				const bool				   inB = b.getNodeState(c, kDepth) == NodeState::LeafFilled;
+				if(operation(inA, inB))
+					expectedTree.setNode(c, kDepth);
+			}
+
+		REQUIRE(result.getNodeCount() == expectedTree.getNodeCount());
+		for(uint x = 0; x < kTreeDiv; ++x)
+			for(uint y = 0; y < kTreeDiv; ++y)
+			{
+				const CompactMortonCode<2> c({x, y});
+				for(uint d = 1; d <= kDepth; ++d)
+					REQUIRE(result.getNodeState(c, d) == expectedTree.getNodeState(c, d));
+			}
+	};
+
+	for(uint i = 0; i < 20; ++i)
+	{
+		const BinQuadtree a = makeRandomTree<2>(random, kDepth, 60);
+		const BinQuadtree b = makeRandomTree<2>(random, kDepth, 60);
+
+		BinQuadtree unionTree = a;
+		unionTree.unite(b);
+		checkOperation(unionTree, a, b, [](bool inA, bool inB) { return inA || inB; });
+
+		BinQuadtree intersectionTree = a;
+		intersectionTree.intersect(b);
+		checkOperation(intersectionTree, a, b, [](bool inA, bool inB) { return inA && inB; });
+
+		BinQuadtree differenceTree = a;
+		differenceTree.subtract(b);
+		checkOperation(differenceTree, a, b, [](bool inA, bool inB) { return inA && !inB; });
+
+		BinQuadtree symmetricDifferenceTree = a;
+		symmetricDifferenceTree.symmetricDifference(b);
+		checkOperation(symmetricDifferenceTree, a, b, [](bool inA, bool inB) { return inA != inB; });
+	}
+
+	// A tree combined with itself
+	BinQuadtree tree = makeRandomTree<2>(random, kDepth, 60);
+	const uint	nodeCount = tree.getNodeCount();
+	tree.unite(tree);
+	CHECK(tree.getNodeCount() == nodeCount);
+	tree.subtract(tree);
+	CHECK(tree.getNodeCount() == 1);
+	CHECK(tree.getNodeState(CompactMortonCode<2>({0, 0}), 1) == NodeState::LeafEmpty);
+
+	BinQuadtree deeperTree(kDepth + 1);
+	CHECK_THROWS_AS(tree.unite(deeperTree), std::invalid_argument);
+}
+
+TEST_CASE("BinNTree box queries", "[BinNTree]")
+{
+	constexpr uint kDepth	= 6;
+	constexpr uint kTreeDiv = 1 << (kDepth - 1);
+
+	std::mt19937 random(23);
+
+	for(uint i = 0; i < 20; ++i)
+	{
+		const BinQuadtree tree = makeRandomTree<2>(random, kDepth, 40);
+
+		for(uint j = 0; j < 20; ++j)
+		{
+			uint x0 = random() % kTreeDiv, x1 = random() % kTreeDiv;
+			uint y0 = random() % kTreeDiv, y1 = random() % kTreeDiv;
+			const MortonBox<2> box({std::min(x0, x1), std::min(y0, y1)}, {std::max(x0, x1), std::max(y0, y1)});
+
+			// Number of leaves covering each cell
+			std::vector<uint> coverCounts(kTreeDiv * kTreeDiv, 0);
+			uint64_t		  previousCode = 0;
+			bool			  isFirst	   = true;
+			tree.visitFilledLeaves(box, [&](const CompactMortonCode<2>& code, uint depth) {
+				REQUIRE(tree.getNodeState(code, depth) == NodeState::LeafFilled);
+				REQUIRE((isFirst || code.getCode() > previousCode));
+				previousCode = code.getCode();
+				isFirst		 = false;
+
+				const uint side	  = 1 << (kDepth - depth);
+				const auto corner = code.toPoint();
+				bool	   overlaps = false;
+				for(uint x = corner[0]; x < corner[0] + side; ++x)
+					for(uint y = corner[1]; y < corner[1] + side; ++y)
+					{
+						++coverCounts[x * kTreeDiv + y];
+						overlaps = overlaps || box.contains(CompactMortonCode<2>({x, y}).getCode());
+					}
+				REQUIRE(overlaps);
+			});
+
+			bool anyCellFilled = false;
+			for(uint x = 0; x < kTreeDiv; ++x)
+				for(uint y = 0; y < kTreeDiv; ++y)
+				{
+					const CompactMortonCode<2> c({x, y});
+					const bool				   isFilled = tree.getNodeState(c, kDepth) == NodeState::LeafFilled;
+					REQUIRE(coverCounts[x * kTreeDiv + y] <= 1);
+					if(box.contains(c.getCode()))
+					{
+						REQUIRE(coverCounts[x * kTreeDiv + y] == isFilled);
+						anyCellFilled = anyCellFilled || isFilled;
+					}
+				}
+			REQUIRE(tree.anyFilled(box) == anyCellFilled);
+		}
+	}
+
+	// A Composite node inside the box is only skipped without pending collapse
+	BinQuadtree quadtree(3);
+	quadtree.setCollapseDeferred(true);
+	quadtree.setNode(CompactMortonCode<2>({0, 0}), 3);
+	quadtree.removeNode(CompactMortonCode<2>({0, 0}), 3);
+	CHECK_FALSE(quadtree.anyFilled(MortonBox<2>({0, 0}, {3, 3})));
+	quadtree.compact();
+	CHECK_FALSE(quadtree.anyFilled(MortonBox<2>({0, 0}, {3, 3})));
+
+	CHECK_THROWS_AS(BinQuadtree(40).anyFilled(MortonBox<2>({0, 0}, {3, 3})), std::invalid_argument);
+}
+
+TEST_CASE("BinNTree filled volume", "[BinNTree]")
+{
+	constexpr uint kDepth	= 7;
+	constexpr uint kTreeDiv = 1 << (kDepth - 1);
+
+	std::mt19937 random(24);
+
+	auto countCells = [&](const BinQuadtree& tree, uint x0, uint y0, uint x1, uint y1) {
+		uint64_t count = 0;
+		for(uint x = x0; x <= x1; ++x)
+			for(uint y = y0; y <= y1; ++y)
+				count += tree.getNodeState(CompactMortonCode<2>({x, y}), kDepth) == NodeState::LeafFilled;
+		return count;
+	};
+
+	auto checkBoxes = [&](const BinQuadtree& tree) {
+		// The whole tree and its quadrants, whose volumes are in the summary
+		constexpr uint kHalf = kTreeDiv / 2;
+		REQUIRE(tree.countFilled(MortonBox<2>({0, 0}, {kTreeDiv - 1, kTreeDiv - 1})) == countCells(tree, 0, 0, kTreeDiv - 1, kTreeDiv - 1));
+		for(uint x = 0; x < kTreeDiv; x += kHalf)
+			for(uint y = 0; y < kTreeDiv; y += kHalf)
+				REQUIRE(tree.countFilled(MortonBox<2>({x, y}, {x + kHalf - 1, y + kHalf - 1})) == countCells(tree, x, y, x + kHalf - 1, y + kHalf - 1));
+
+		for(uint j = 0; j < 10; ++j)
+		{
+			uint x0 = random() % kTreeDiv, x1 = random() % kTreeDiv;
+			uint y0 = random() % kTreeDiv, y1 = random() % kTreeDiv;
+			if(x0 > x1)
+				std::swap(x0, x1);
+			if(y0 > y1)
+				std::swap(y0, y1);
+
+			REQUIRE(tree.countFilled(MortonBox<2>({x0, y0}, {x1, y1})) == countCells(tree, x0, y0, x1, y1));
+		}
+	};
+
+	for(uint i = 0; i < 10; ++i)
+	{
+		BinQuadtree summaryTree(kDepth);
+		BinQuadtree plainTree(kDepth);
+		summaryTree.setVolumeSummaryEnabled(true);
+
+		for(uint j = 0; j < 8; ++j)
+		{
+			editRandomly(random, 50, 4, summaryTree, plainTree);
+
+			const uint64_t volume = countCells(plainTree, 0, 0, kTreeDiv - 1, kTreeDiv - 1);
+			REQUIRE(summaryTree.filledVolume() == volume);
+			REQUIRE(plainTree.filledVolume() == volume);
+			checkBoxes(summaryTree);
+			checkBoxes(plainTree);
+		}
+
+		// Bulk rewrites
+		std::vector<CompactMortonCode<2>> codes;
+		for(uint j = 0; j < 50; ++j)
+			codes.push_back(CompactMortonCode<2>({static_cast<uint>(random() % kTreeDiv), static_cast<uint>(random() % kTreeDiv)}));
+		std::sort(codes.begin(), codes.end(), [](const CompactMortonCode<2>& a, const CompactMortonCode<2>& b) { return a.getCode() < b.getCode(); });
+		summaryTree.setNodes(codes.begin(), codes.end(), kDepth);
+		plainTree.setNodes(codes.begin(), codes.end(), kDepth);
+		REQUIRE(summaryTree.filledVolume() == countCells(plainTree, 0, 0, kTreeDiv - 1, kTreeDiv - 1));
+		checkBoxes(summaryTree);
+
+		summaryTree.subtract(plainTree);
+		REQUIRE(summaryTree.filledVolume() == 0);
+		CHECK(summaryTree.countFilled(MortonBox<2>({0, 0}, {kTreeDiv - 1, kTreeDiv - 1})) == 0);
+	}
+
+	// Single edits, which update the entries of the summary until the next rebuild
+	BinQuadtree summaryTree(kDepth);
+	BinQuadtree plainTree(kDepth);
+	editRandomly(random, 2000, kDepth - 2, summaryTree, plainTree);
+	summaryTree.setVolumeSummaryEnabled(true);
+
+	for(uint i = 0; i < 100; ++i)
+	{
+		editRandomly(random, 3, kDepth - 3, summaryTree, plainTree);
+		REQUIRE(summaryTree.filledVolume() == countCells(plainTree, 0, 0, kTreeDiv - 1, kTreeDiv - 1));
+		checkBoxes(summaryTree);
+	}
+
+	BinQuadtree fullTree(kDepth);
+	fullTree.setNode(CompactMortonCode<2>({0, 0}), 1);
+	CHECK(fullTree.filledVolume() == kTreeDiv * kTreeDiv);
+	CHECK(fullTree.countFilled(MortonBox<2>({1, 2}, {3, 7})) == 18);
+
+	CHECK_THROWS_AS(BinQuadtree(33).setVolumeSummaryEnabled(true), std::invalid_argument);
+	CHECK_THROWS_AS(BinQuadtree(33).filledVolume(), std::invalid_argument);
+}
+
+TEST_CASE("BinNTree ray casting", "[BinNTree]")
+{
+	constexpr uint kDepth	= 6;
+	constexpr uint kTreeDiv = 1 << (kDepth - 1);
+
+	std::mt19937						   random(25);
+	std::uniform_real_distribution<double> position(-10.0, kTreeDiv + 10.0);
+	std::uniform_real_distribution<double> direction(-1.0, 1.0);
+
+	// Distance to the first filled cell crossed by the ray, reading every cell
+	auto castOnCells = [&](const BinQuadtree& tree, const Ray<2>& ray, double& distance) {
+		const double norm = std::sqrt(ray.direction[0] * ray.direction[0] + ray.direction[1] * ray.direction[1]);
+
+		bool found = false;
+		for(uint x = 0; x < kTreeDiv; ++x)
+			for(uint y = 0; y < kTreeDiv; ++y)
+			{
+				if(tree.getNodeState(CompactMortonCode<2>({x, y}), kDepth) != NodeState::LeafFilled)
+					continue;
+
+				const std::array<uint, 2> corner{x, y};
+
+				double tEnter = 0;
+				double tExit  = ray.maxDistance;
+				for(uint axis = 0; axis < 2; ++axis)
+				{
+					const double d = ray.direction[axis] / norm;
+					if(d == 0)
+					{
+						if(ray.origin[axis] < corner[axis] || ray.origin[axis] >= corner[axis] + 1)
+							tExit = -1;
+						continue;
+					}
+					double t0 = (corner[axis] - ray.origin[axis]) / d;
+					double t1 = (corner[axis] + 1 - ray.origin[axis]) / d;
+					if(t0 > t1)
+						std::swap(t0, t1);
+					tEnter = std::max(tEnter, t0);
+					tExit  = std::min(tExit, t1);
+				}
+				if(tEnter < tExit && (!found || tEnter < distance))
+				{
+					distance = tEnter;
+					found	 = true;
+				}
+			}
+		return found;
+	};
+
+	for(uint i = 0; i < 10; ++i)
+	{
+		BinQuadtree tree(kDepth);
+		editRandomly(random, 30, 3, tree);
+
+		std::vector<Ray<2>> rays;
+		for(uint j = 0; j < 200; ++j)
+		{
+			Ray<2> ray{{position(random), position(random)}, {direction(random), direction(random)}, 20.0 + random() % 80};
+			// Some rays along the axes
+			if(j % 10 == 0)
+				ray.direction[j % 20 ? 0 : 1] = 0;
+			rays.push_back(ray);
+		}
+		rays.push_back({{-1.5, 7.5}, {1.0, 0.0}, 100.0});
+		rays.push_back({{7.5, 40.5}, {0.0, -3.0}, 100.0});
+
+		for(const Ray<2>& ray : rays)
+		{
+			RayHit<2> hit;
+			double	  distance;
+			const bool isHit = tree.castRay(ray.origin, ray.direction, ray.maxDistance, hit);
+			REQUIRE(isHit == castOnCells(tree, ray, distance));
+			if(!isHit)
+				continue;
+
+			CHECK(hit.distance == Approx(distance).margin(1e-9));
+			CHECK(tree.getNodeState(CompactMortonCode<2>::fromCode(hit.code), hit.depth) == NodeState::LeafFilled);
+
+			// The segment stops before the first Filled leaf, or crosses it
+			const double norm = std::sqrt(ray.direction[0] * ray.direction[0] + ray.direction[1] * ray.direction[1]);
+
+			auto along = [&](double t) {
+				return std::array<double, 2>{ray.origin[0] + ray.direction[0] / norm * t, ray.origin[1] + ray.direction[1] / norm * t};
+			};
+			CHECK(tree.lineOfSight(ray.origin, along(hit.distance * 0.999)));
+			CHECK(!tree.lineOfSight(ray.origin, along(std::min(ray.maxDistance, hit.distance + 0.5))));
+		}
+
+		std::vector<RayHit<2>> hits(rays.size());
+		std::vector<RayHit<2>> poolHits(rays.size());
+		ThreadPool			   pool(4);
+		tree.castRays(rays.data(), rays.size(), hits.data());
+		tree.castRays(rays.data(), rays.size(), poolHits.data(), pool);
+		for(size_t j = 0; j < rays.size(); ++j)
+		{
+			RayHit<2>  hit;
+			const bool isHit = tree.castRay(rays[j].origin, rays[j].direction, rays[j].maxDistance, hit);
+			REQUIRE(hits[j].depth == (isHit ? hit.depth : 0));
+			REQUIRE(poolHits[j].depth == hits[j].depth);
+			if(isHit)
+			{
+				CHECK(hits[j].code == hit.code);
+				CHECK(poolHits[j].code == hit.code);
+			}
+		}
+	}
+
+	// A whole Filled root, and an empty tree
+	BinQuadtree fullTree(kDepth);
+	fullTree.setNode(CompactMortonCode<2>({0, 0}), 1);
+	RayHit<2> hit;
+	REQUIRE(fullTree.castRay({-5.0, 3.0}, {1.0, 0.0}, 10.0, hit));
+	CHECK(hit.depth == 1);
+	CHECK(hit.distance == Approx(5.0));
+	CHECK(!fullTree.castRay({-5.0, 3.0}, {1.0, 0.0}, 4.0, hit));
+	CHECK(!fullTree.castRay({-5.0, 3.0}, {-1.0, 0.0}, 100.0, hit));
+	CHECK(BinQuadtree(kDepth).lineOfSight({0.5, 0.5}, {31.5, 31.5}));
+
+	// In 3D, a single cell on the diagonal
+	BinNTree<3> octree(4);
+	octree.setNode(CompactMortonCode<3>({5, 5, 5}), 4);
+	RayHit<3> octreeHit;
+	REQUIRE(octree.castRay({0.5, 0.5, 0.5}, {1.0, 1.0, 1.0}, 100.0, octreeHit));
+	CHECK(octreeHit.code == CompactMortonCode<3>({5, 5, 5}).getCode());
+	CHECK(octreeHit.depth == 4);
+	CHECK(octreeHit.distance == Approx(4.5 * std::sqrt(3.0)));
+	CHECK(!octree.castRay({0.5, 0.5, 0.5}, {1.0, 1.0, 0.0}, 100.0, octreeHit));
+
+	CHECK_THROWS_AS(fullTree.castRay({1.0, 1.0}, {0.0, 0.0}, 10.0, hit), std::invalid_argument);
+}
+
+TEST_CASE("BinNTree builder", "[BinNTree]")
+{
+	constexpr uint kDepth	= 6;
+	constexpr uint kTreeDiv = 1 << (kDepth - 1);
+
+	auto mortonLess = [](const CompactMortonCode<2>& a, const CompactMortonCode<2>& b) {
+		for(uint level = kDepth - 1; level-- > 0;)
+			if(a.decode(level) != b.decode(level))
+				return a.decode(level) < b.decode(level);
+		return false;
+	};
+
+	BinNTreeBuilder<2> builder(kDepth);
+
+	SECTION("No code")
+	{
+		const BinQuadtree quadtree = builder.build();
+		CHECK(quadtree.getNodeCount() == 1);
+		CHECK(quadtree.getNodeState(CompactMortonCode<2>({0, 0}), 1) == NodeState::LeafEmpty);
+	}
+
+	SECTION("Unsorted codes")
+	{
+		builder.add(CompactMortonCode<2>({3, 3}));
+		CHECK_THROWS_AS(builder.add(CompactMortonCode<2>({0, 0})), std::invalid_argument);
+	}
+
+	SECTION("Random codes")
+	{
+		std::mt19937 random(11);
+
+		for(uint i = 0; i < 20; ++i)
+		{
+			// From a few codes to the whole tree
+			const uint						  cellRange = 1 + random() % kTreeDiv;
+			std::vector<CompactMortonCode<2>> codes;
+			for(uint j = 0; j < 1 + random() % 1500; ++j)
+				codes.emplace_back(CompactMortonCode<2>::Point{static_cast<uint>(random() % cellRange), static_cast<uint>(random() % kTreeDiv)});
+			std::sort(codes.begin(), codes.end(), mortonLess);
+
+			BinQuadtree expectedTree(kDepth);
+			for(const CompactMortonCode<2>& c : codes)
+			{
+				expectedTree.setNode(c, kDepth);
+				builder.add(c);
+			}
+			const BinQuadtree quadtree = builder.build();
+
+			REQUIRE(quadtree.getNodeCount() == expectedTree.getNodeCount());
+			for(uint x = 0; x < kTreeDiv; ++x)
+				for(uint y = 0; y < kTreeDiv; ++y)
+				{
+					const CompactMortonCode<2> c({x, y});
+					for(uint d = 1; d <= kDepth; ++d)
+						CHECK(quadtree.getNodeState(c, d) == expectedTree.getNodeState(c, d));
+				}
+		}
+	}
+}
+
+TEST_CASE("BinNTree chunked storage", "[BinNTree]")
+{
+	constexpr uint kDepth	= 7;
+	constexpr uint kTreeDiv = 1 << (kDepth - 1);
+
+	BinQuadtree								  plainTree(kDepth);
+	BinNTree<2, internal::ChunkedBitVector<4>> chunkedTree(kDepth);
+	chunkedTree.setSubtreeIndexEnabled(GENERATE(false, true));
+
+	std::mt19937 random(17);
+	editRandomly(random, 3000, kDepth - 2, plainTree, chunkedTree);
+
+	std::vector<CompactMortonCode<2>> codes{CompactMortonCode<2>({0, 0}), CompactMortonCode<2>({5, 9}), CompactMortonCode<2>({40, 3})};
+	plainTree.setNodes(codes.begin(), codes.end(), kDepth);
+	chunkedTree.setNodes(codes.begin(), codes.end(), kDepth);
+
+	REQUIRE(chunkedTree.getNodeCount() == plainTree.getNodeCount());
+	REQUIRE(chunkedTree.getNodeCount() > 1000);
+
+	for(uint x = 0; x < kTreeDiv; ++x)
+		for(uint y = 0; y < kTreeDiv; ++y)
+		{
+			const CompactMortonCode<2> c({x, y});
+			CHECK(chunkedTree.getNodeState(c, kDepth) == plainTree.getNodeState(c, kDepth));
+		}
+}
+
+TEST_CASE("BinNTree virtual codes", "[BinNTree]")
+{
+	BinQuadtree		   quadtree(3);
+	const NTree<2>&	   tree = quadtree;
+
+	const CompactMortonCode<2> compactCode({2, 0});
+	const MortonCode<2>&	   code = compactCode;
+
+	quadtree.setNode(code, 3);
+	CHECK(tree.getNodeState(code, 3) == NodeState::LeafFilled);
+	CHECK(quadtree.getNodeState(compactCode, 3) == NodeState::LeafFilled);
+	CHECK(quadtree.getNodeState(code, 2) == NodeState::CompositeEmpty);
+
+	quadtree.removeNode(code, 3);
+	CHECK(tree.getNodeState(code, 3) == NodeState::LeafEmpty);
+	CHECK(quadtree.getNodeCount() == 1);
+}
+
+TEST_CASE("BinNTree wide codes", "[BinNTree]")
+{
+	// 26 levels under the root, more than the 21 of a 64-bit octree code
+	constexpr uint kDepth = 27;
+
+	using Code = CompactMortonCode<3, DoubleWord>;
+
+	BinNTree<3> octree(kDepth);
+
+	// Both points only differ by their highest bit, which a 64-bit code cuts
+	const Code near({5, 7, 1});
+	const Code far({5, 7, 1 | (1 << 25)});
+
+	octree.setNode(near, kDepth);
+	CHECK(octree.getNodeState(near, kDepth) == NodeState::LeafFilled);
+	CHECK(octree.getNodeState(far, kDepth) == NodeState::LeafEmpty);
+
+	octree.setNode(far, kDepth);
+	CHECK(octree.getNodeState(far, kDepth) == NodeState::LeafFilled);
+	CHECK(octree.getNodeState(far, 2) == NodeState::CompositeEmpty);
+	// The root and the 25 composite nodes of each path have 8 children
+	CHECK(octree.getNodeCount() == 1 + 8 * (1 + 2 * (kDepth - 2)));
+
+	octree.removeNode(near, kDepth);
+	octree.removeNode(far, kDepth);
+	CHECK(octree.getNodeCount() == 1);
+}
+
+} // namespace qotf
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <catch2/catch.hpp>
+
+#include <qotf/binary/BinNTree.hpp>
+#include <qotf/binary/BinNTreeExpression.hpp>
+#include <qotf/morton/CompactMortonCode.hpp>
+
+#include <random>
+#include <vector>
+
+namespace qotf
+{
+
+TEST_CASE("BinNTreeExpression evaluation", "[BinNTreeExpression]")
+{
+	using Tree		 = BinNTree<2>;
+	using Expression = BinNTreeExpression<2>;
+
+	constexpr uint kDepth	= 6;
+	constexpr uint kTreeDiv = 1 << (kDepth - 1);
+
+	std::mt19937 random(22);
+
+	auto randomTree = [&]() {
+		Tree tree(kDepth);
+		for(uint j = 0; j < 60; ++j)
+		{
+			const CompactMortonCode<2> c({static_cast<uint>(random() % kTreeDiv), static_cast<uint>(random() % kTreeDiv)});
+			const uint				   depth = 2 + random() % (kDepth - 1);
+			if(j % 3)
+				tree.setNode(c, depth);
+			else
+				tree.removeNode(c, depth);
+		}
+		return tree;
+	};
+
+	// Check [result] against a tree filled cell by cell with [formula]
+	auto checkFormula = [&](const Tree& result, const std::vector<Tree>& trees, auto&& formula) {
+		Tree expectedTree(kDepth);
+		for(uint x = 0; x < kTreeDiv; ++x)
+			for(uint y = 0; y < kTreeDiv; ++y)
+			{
+				const CompactMortonCode<2> c({x, y});
+
+				std::vector<bool> cells;
+				for(const Tree& tree : trees)
+					cells.push_back(tree.getNodeState(c, kDepth) == NodeState::LeafFilled);
+				if(formula(cells))
+					expectedTree.setNode(c, kDepth);
+			}
+
+		REQUIRE(result.getNodeCount() == expectedTree.getNodeCount());
+		for(uint x = 0; x < kTreeDiv; ++x)
+			for(uint y = 0; y < kTreeDiv; ++y)
+			{
+				const CompactMortonCode<2> c({x, y});
+				for(uint d = 1; d <= kDepth; ++d)
+					REQUIRE(result.getNodeState(c, d) == expectedTree.getNodeState(c, d));
+			}
+	};
+
+	for(uint i = 0; i < 10; ++i)
+	{
+		std::vector<Tree> trees;
+		for(uint j = 0; j < 5; ++j)
+			trees.push_back(randomTree());
+
+		const Expression a(trees[0]), b(trees[1]), c(trees[2]), d(trees[3]), e(trees[4]);
+
+		checkFormula(((a | b | c) - d).evaluate(), trees, [](const std::vector<bool>& cells) {
+			return (cells[0] || cells[1] || cells[2]) && !cells[3];
+		});
+		checkFormula((~a ^ (b & c)).evaluate(), trees, [](const std::vector<bool>& cells) {
+			return !cells[0] != (cells[1] && cells[2]);
+		});
+		checkFormula(((a & b) | (c - (d ^ e)) | ~(a | e)).evaluate(), trees, [](const std::vector<bool>& cells) {
+			return (cells[0] && cells[1]) || (cells[2] && cells[3] == cells[4]) || !(cells[0] || cells[4]);
+		});
+
+		// Same results as the pairwise operations
+		Tree pairwise = trees[0];
+		pairwise.unite(trees[1]);
+		pairwise.subtract(trees[2]);
+		checkFormula(((a | b) - c).evaluate(), {pairwise}, [](const std::vector<bool>& cells) { return cells[0]; });
+	}
+
+	// A tree used several times is a single input
+	const Tree		 tree = randomTree();
+	const Expression a(tree);
+	CHECK((a | ~a).getInputCount() == 1);
+
+	const Tree full = (a | ~a).evaluate();
+	CHECK(full.getNodeCount() == 1);
+	CHECK(full.getNodeState(CompactMortonCode<2>({0, 0}), 1) == NodeState::LeafFilled);
+
+	const Tree same = (a & a).evaluate();
+	CHECK(same.getNodeCount() == tree.getNodeCount());
+
+	const Tree deeperTree(kDepth + 1);
+	CHECK_THROWS_AS(a | Expression(deeperTree), std::invalid_argument);
+}
+
+} // namespace qotf
@@ -120,6 +120,19 @@ TEST_CASE("BitVector::setMany", "[BitVector]")
 
 TEST_CASE("BitVector::append", "[BitVector]")
 {
+	SECTION("Bits of another BitVector")
+	{
+		const BitVector source({byte{0b1011'0010}, byte{0b0111'0001}, byte{0b1100'1010}});
+
+		BitVector array(3, true);
+		array.append(source, 5, 14);
+
+		REQUIRE(17 == array.size());
+		for(size_t i = 0; i < 14; ++i)
+			CHECK(source.get(5 + i) == array.get(3 + i));
+		CHECK(array.get(0));
+		CHECK(array.get(2));
+	}
 }
 
 TEST_CASE("BitVector::insert", "[BitVector]")
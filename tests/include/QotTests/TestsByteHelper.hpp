@@ -4,6 +4,10 @@
 
 #include <qotf/internal/ByteHelper.hpp>
 
+#include <algorithm>
+#include <random>
+#include <vector>
+
 namespace qotf::internal
 {
 
@@ -640,4 +644,40 @@ TEST_CASE("ByteHelper::shiftBits", "[ByteHelper]")
 	}
 }
 
-} // namespace qotf::internal
\ No newline at end of file
+TEST_CASE("ByteHelper::copyBytes by word", "[ByteHelper]")
+{
+	std::mt19937 random(9);
+
+	for(uint i = 0; i < 2000; ++i)
+	{
+		std::vector<byte> bytes(64);
+		for(byte& b : bytes)
+			b = static_cast<byte>(random());
+		std::vector<byte> expected = bytes;
+
+		// Overlapping copies, like the ones of shiftBits
+		const size_t count		  = random() % 40;
+		const size_t srcByteIndex = 1 + random() % 10;
+		const size_t shift		  = 1 + random() % 16;
+
+		ByteHelper helper(bytes);
+		ByteHelper expectedHelper(expected);
+
+		if(random() % 2)
+		{
+			const size_t dstBitIndex = bitutils::bitIndex(srcByteIndex) - std::min(shift, bitutils::bitIndex(srcByteIndex));
+			helper.copyBytes<Direction::ToLeft>(dstBitIndex, srcByteIndex, count);
+			expectedHelper.copyBytesByByte<Direction::ToLeft>(dstBitIndex, srcByteIndex, count);
+		}
+		else
+		{
+			const size_t dstBitIndex = bitutils::bitIndex(srcByteIndex) + shift;
+			helper.copyBytes<Direction::ToRight>(dstBitIndex, srcByteIndex, count);
+			expectedHelper.copyBytesByByte<Direction::ToRight>(dstBitIndex, srcByteIndex, count);
+		}
+
+		CHECK(bytes == expected);
+	}
+}
+
+} // namespace qotf::internal
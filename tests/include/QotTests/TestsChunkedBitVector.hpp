@@ -0,0 +1,72 @@
+#pragma once
+
+#include <catch2/catch.hpp>
+
+#include <qotf/internal/BitVector.hpp>
+#include <qotf/internal/ChunkedBitVector.hpp>
+
+#include <random>
+
+namespace qotf::internal
+{
+
+TEST_CASE("ChunkedBitVector edits", "[ChunkedBitVector]")
+{
+	using Chunked = ChunkedBitVector<4>;
+
+	std::mt19937 random(5);
+
+	BitVector expected(200);
+	for(size_t i = 0; i < expected.size(); ++i)
+		expected.set(i, random() % 2 != 0);
+
+	Chunked array{BitVector(expected)};
+	REQUIRE(array.size() == expected.size());
+	REQUIRE(array.blockCount() > 1);
+
+	// Whole bytes edits (like BinNTree ones) and odd sized edits
+	const bool wholeBytes = GENERATE(true, false);
+
+	for(uint i = 0; i < 2000; ++i)
+	{
+		const size_t count = wholeBytes ? 8 * (1 + random() % 4) : 1 + random() % 20;
+
+		if(random() % 2 || expected.size() < count)
+		{
+			const size_t index = random() % (expected.size() + 1);
+			expected.insert(index, count);
+			array.insert(index, count);
+		}
+		else
+		{
+			const size_t index = random() % (expected.size() - count + 1);
+			expected.remove(index, count);
+			array.remove(index, count);
+		}
+
+		// Set a few bits so that the inserted ones are not all empty
+		const size_t index = random() % expected.size();
+		expected.set(index, true);
+		array.set(index, true);
+
+		REQUIRE(array.size() == expected.size());
+	}
+
+	for(size_t i = 0; i < expected.size(); ++i)
+		CHECK(array.get(i) == expected.get(i));
+
+	if(wholeBytes)
+		for(size_t i = 0; i < expected.size() / 8; ++i)
+			CHECK(array.byteAt(i) == expected.byteAt(i));
+
+	size_t segmentEnd = 0;
+	array.visitSegments(0, [&](const byte[], size_t offset, size_t size) {
+		CHECK(offset == segmentEnd);
+		CHECK(size <= 2 * 4 * 8);
+		segmentEnd = offset + size;
+		return true;
+	});
+	CHECK(segmentEnd == expected.size());
+}
+
+} // namespace qotf::internal
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <catch2/catch.hpp>
+
+#include <qotf/internal/ExcessScanner.hpp>
+
+#include <random>
+#include <vector>
+
+namespace qotf::internal
+{
+
+TEST_CASE("ExcessScanner::forward", "[ExcessScanner]")
+{
+	using Scanner = ExcessScanner<8>;
+
+	std::mt19937	  random(3);
+	std::vector<byte> data(1024);
+
+	std::vector<Scanner::ForwardFunction> kernels{Scanner::forwardByWord, Scanner::selectForwardFunction()};
+#if QOTF_X86_KERNELS
+	if(__builtin_cpu_supports("popcnt"))
+		kernels.push_back(Scanner::forwardByPopcntWord);
+#endif
+
+	for(uint i = 0; i < 500; ++i)
+	{
+		// One Composite node out of eight keeps the excess around zero
+		for(byte& b : data)
+		{
+			b = byte{0};
+			for(uint node = 0; node < 4; ++node)
+				if(random() % 8 == 0)
+					b |= byte{0b10} << (2 * node);
+		}
+
+		const size_t nodeLimit = data.size() * 4 - random() % 4;
+		const size_t nodeIndex = random() % 16;
+		const Excess target	   = -1 - static_cast<Excess>(random() % 8);
+
+		Excess		 nodeExcess	  = 0;
+		const size_t nodePosition = Scanner::forwardByNode(data.data(), nodeIndex, nodeLimit, nodeExcess, target);
+
+		Excess byteExcess = 0;
+		CHECK(Scanner::forwardByByte(data.data(), nodeIndex, nodeLimit, byteExcess, target) == nodePosition);
+		CHECK(byteExcess == nodeExcess);
+
+		for(Scanner::ForwardFunction kernel : kernels)
+		{
+			Excess wordExcess = 0;
+			CHECK(kernel(data.data(), nodeIndex, nodeLimit, wordExcess, target) == nodePosition);
+			CHECK(wordExcess == nodeExcess);
+		}
+	}
+}
+
+TEST_CASE("ExcessScanner::summarize", "[ExcessScanner]")
+{
+	using Scanner = ExcessScanner<4>;
+
+	// Composite, Leaf, Leaf, Leaf | Leaf, Composite, Leaf, Leaf
+	const byte data[] = {byte{0b1000'0000}, byte{0b0010'0000}};
+
+	SECTION("Whole bytes")
+	{
+		Excess		 minExcess = 100;
+		const Excess excess	   = Scanner::summarize(data, 0, 8, minExcess);
+
+		CHECK(excess == 0);
+		CHECK(minExcess == -1);
+	}
+
+	SECTION("Unaligned nodes")
+	{
+		Excess		 minExcess = 100;
+		const Excess excess	   = Scanner::summarize(data, 2, 7, minExcess);
+
+		CHECK(excess == -1);
+		CHECK(minExcess == -3);
+	}
+}
+
+TEST_CASE("ExcessScanner::allNodesEqual", "[ExcessScanner]")
+{
+	using Scanner = ExcessScanner<8>;
+
+	const byte data[] = {byte{0b1001'0101}, byte{0b0101'0101}, byte{0b0100'1000}};
+
+	CHECK(Scanner::allNodesEqual(data, 1, 8, byte{0b01}));
+	CHECK(Scanner::allNodesEqual(data, 4, 4, byte{0b01}));
+	CHECK_FALSE(Scanner::allNodesEqual(data, 0, 8, byte{0b01}));
+	CHECK_FALSE(Scanner::allNodesEqual(data, 1, 9, byte{0b01}));
+	CHECK(Scanner::allNodesEqual(data, 10, 1, byte{0b10}));
+}
+
+TEST_CASE("ExcessScanner::countNodes", "[ExcessScanner]")
+{
+	using Scanner = ExcessScanner<8>;
+
+	const byte data[] = {byte{0b1001'0101}, byte{0b0101'0101}, byte{0b0100'1000}};
+
+	CHECK(Scanner::countNodes(data, 0, 12, byte{0b01}) == 8);
+	CHECK(Scanner::countNodes(data, 2, 7, byte{0b01}) == 7);
+	CHECK(Scanner::countNodes(data, 0, 12, byte{0b00}) == 2);
+	CHECK(Scanner::countNodes(data, 0, 12, byte{0b10}) == 2);
+	CHECK(Scanner::countNodes(data, 9, 3, byte{0b00}) == 2);
+	CHECK(Scanner::countNodes(data, 5, 0, byte{0b01}) == 0);
+
+	std::mt19937	  random(3);
+	std::vector<byte> bytes(64);
+	for(byte& b : bytes)
+		b = static_cast<byte>(random());
+
+	for(uint i = 0; i < 200; ++i)
+	{
+		const size_t first	  = random() % 200;
+		const size_t count	  = random() % (256 - first);
+		const byte	 nodeBits = static_cast<byte>(random() % 4);
+
+		size_t expected = 0;
+		for(size_t node = first; node < first + count; ++node)
+			expected += ((bytes[node / 4] >> (6 - 2 * (node % 4))) & byte{0b11}) == nodeBits;
+		REQUIRE(Scanner::countNodes(bytes.data(), first, count, nodeBits) == expected);
+	}
+}
+
+} // namespace qotf::internal
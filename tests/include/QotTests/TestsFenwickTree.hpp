@@ -0,0 +1,76 @@
+#pragma once
+
+#include <catch2/catch.hpp>
+
+#include <qotf/internal/FenwickTree.hpp>
+
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace qotf::internal
+{
+
+TEST_CASE("FenwickTree sums and search", "[FenwickTree]")
+{
+	std::mt19937 random(11);
+
+	// Sizes around the powers of two, with some empty elements
+	const size_t size = GENERATE(1, 2, 7, 8, 9, 100);
+
+	std::vector<size_t> expected(size);
+	for(size_t& value : expected)
+		value = random() % 4 ? random() % 50 : 0;
+
+	FenwickTree<size_t> tree;
+	tree.assign(expected);
+	REQUIRE(tree.size() == size);
+
+	for(uint i = 0; i < 200; ++i)
+	{
+		const size_t index = random() % size;
+		if(i % 2)
+		{
+			const size_t value = random() % 50;
+			expected[index] += value;
+			tree.add(index, value);
+		}
+		else
+		{
+			expected[index] = random() % 50;
+			tree.set(index, expected[index]);
+		}
+
+		for(size_t j = 0; j <= size; ++j)
+			REQUIRE(tree.prefixSum(j) == std::accumulate(expected.begin(), expected.begin() + j, size_t{0}));
+		for(size_t j = 0; j < size; ++j)
+			REQUIRE(tree.at(j) == expected[j]);
+	}
+
+	const size_t total = tree.prefixSum(size);
+	for(size_t value = 0; value <= total; ++value)
+	{
+		size_t		 left	 = value;
+		const size_t element = tree.find(left);
+
+		if(value == total)
+		{
+			CHECK(element == size);
+			continue;
+		}
+
+		// The element holding the value is the first non-empty one whose sum passes it
+		REQUIRE(element < size);
+		CHECK(tree.prefixSum(element) <= value);
+		CHECK(value < tree.prefixSum(element + 1));
+		CHECK(left == value - tree.prefixSum(element));
+	}
+
+	FenwickTree<size_t> empty;
+	empty.assign({});
+	size_t value = 0;
+	CHECK(empty.find(value) == 0);
+	CHECK(empty.prefixSum(0) == 0);
+}
+
+} // namespace qotf::internal
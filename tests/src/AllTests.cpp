@@ -5,8 +5,22 @@
 
 #include <QotTests/MortonCode/CompactTests.hpp>
 
+#include <QotTests/MortonCode/HilbertTests.hpp>
+
+#include <QotTests/MortonCode/MortonBoxTests.hpp>
+
+#include <QotTests/MortonCode/MortonBatchTests.hpp>
+
 #include <QotTests/TestsByteHelper.hpp>
 
 #include <QotTests/TestsBitVector.hpp>
 
-//#include <QotTests/TestsBinNTree.hpp>
\ No newline at end of file
+#include <QotTests/TestsFenwickTree.hpp>
+
+#include <QotTests/TestsChunkedBitVector.hpp>
+
+#include <QotTests/TestsExcessScanner.hpp>
+
+#include <QotTests/TestsBinNTree.hpp>
+
+#include <QotTests/TestsBinNTreeExpression.hpp>
\ No newline at end of file
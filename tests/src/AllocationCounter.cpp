@@ -0,0 +1,145 @@
+#include <QotTests/AllocationCounter.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+/**
+ * Replacements of the global operators new and delete, counting the allocations
+ * The aligned forms keep the pointer given by std::malloc right before the aligned block,
+ * as std::aligned_alloc is not available everywhere
+ */
+namespace
+{
+
+void* allocate(std::size_t size) noexcept
+{
+	++qotf::tests::allocationCount;
+	return std::malloc(size ? size : 1);
+}
+
+void* allocateAligned(std::size_t size, std::align_val_t alignment) noexcept
+{
+	const std::size_t alignmentSize = static_cast<std::size_t>(alignment);
+
+	void* block = allocate(size + alignmentSize + sizeof(void*));
+	if(!block)
+		return nullptr;
+
+	const std::uintptr_t address = (reinterpret_cast<std::uintptr_t>(block) + sizeof(void*) + alignmentSize - 1) & ~(alignmentSize - 1);
+	void*				 pointer = reinterpret_cast<void*>(address);
+	static_cast<void**>(pointer)[-1] = block;
+	return pointer;
+}
+
+void deallocateAligned(void* pointer) noexcept
+{
+	if(pointer)
+		std::free(static_cast<void**>(pointer)[-1]);
+}
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+	if(void* pointer = allocate(size))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+	return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	if(void* pointer = allocateAligned(size, alignment))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return ::operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocateAligned(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+	deallocateAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+	deallocateAligned(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+	deallocateAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept
+{
+	deallocateAligned(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	deallocateAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	deallocateAligned(pointer);
+}